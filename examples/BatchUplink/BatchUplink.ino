@@ -0,0 +1,53 @@
+#include <NovaSDS011.h>
+#include <SDS011BatchCodec.h>
+
+#define SDS_PIN_RX 2
+#define SDS_PIN_TX 3
+
+// LoRa payload limit of slowest data rate
+#define PAYLOAD_SIZE 51
+
+NovaSDS011 sds011;
+uint8_t payload[PAYLOAD_SIZE];
+SDS011BatchEncoder encoder(payload, sizeof(payload));
+uint32_t encodeMicros = 0;
+
+void send(const uint8_t *data, size_t size)
+{
+  // Hand payload to radio here
+  Serial.println("Batch of " + String(encoder.count()) + " samples in " + String(size) + " bytes, encode " +
+                 String(encodeMicros / encoder.count()) + "us/sample");
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  sds011.begin(SDS_PIN_RX, SDS_PIN_TX);
+  sds011.setDataReportingMode(DataReportingMode::query);
+  sds011.setWorkingMode(WorkingMode::mode_work);
+}
+
+void loop()
+{
+  uint16_t p25, p10;
+  if (sds011.queryData(p25, p10) == QuerryError::no_error)
+  {
+    uint32_t timestamp = millis() / 1000;
+
+    uint32_t start = micros();
+    bool added = encoder.add(timestamp, p25, p10);
+    encodeMicros += micros() - start;
+
+    if (!added)
+    {
+      send(payload, encoder.finish());
+      encoder.reset();
+      encodeMicros = 0;
+
+      start = micros();
+      encoder.add(timestamp, p25, p10);
+      encodeMicros += micros() - start;
+    }
+  }
+  delay(60000);
+}
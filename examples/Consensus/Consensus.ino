@@ -0,0 +1,84 @@
+#include <NovaSDS011.h>
+#include <SDS011Fusion.h>
+
+#define SDS_PIN_RX 2
+#define SDS_PIN_TX 3
+#define QUERY_INTERVAL 3000
+
+// Three sensors on one bus, replace with ids printed by discover()
+const uint16_t SENSORS[] = {0x1A2B, 0x1A2C, 0x1A2D};
+const uint8_t SENSOR_COUNT = sizeof(SENSORS) / sizeof(SENSORS[0]);
+
+NovaSDS011 sds011;
+SDS011Fusion fusion;
+uint8_t nextSensor = 0;
+bool reported = false;
+uint32_t lastRound = 0;
+
+void onSample(void *context, uint16_t device_id, uint16_t pm25, uint16_t pm10, uint32_t timestamp)
+{
+  fusion.update(device_id, pm25, pm10, timestamp);
+}
+
+void report()
+{
+  SDS011FusionResult result = fusion.fuse(millis());
+  if (result.valid)
+  {
+    Serial.println("PM2.5=" + String(result.pm25 / 10.0) + ", PM10=" + String(result.pm10 / 10.0) +
+                   " from " + String(result.used) + " sensors");
+  }
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++)
+  {
+    if (fusion.isDiverging(SENSORS[i]))
+    {
+      Serial.println("Sensor " + String(SENSORS[i], HEX) + " disagrees with others, check it");
+    }
+  }
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  sds011.begin(SDS_PIN_RX, SDS_PIN_TX);
+  sds011.onSample(onSample);
+  sds011.broadcastWorkingMode(WorkingMode::mode_work);
+  sds011.broadcastDataReportingMode(DataReportingMode::query);
+
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++)
+  {
+    fusion.addSensor(SENSORS[i]);
+  }
+}
+
+void loop()
+{
+  // queryData() allows one query per 3 s, non blocking requests go to sensors one after another
+  sds011.service();
+  if (sds011.requestState() == RequestState::request_pending)
+  {
+    return;
+  }
+
+  if (nextSensor < SENSOR_COUNT)
+  {
+    if (sds011.requestData(SENSORS[nextSensor]))
+    {
+      nextSensor++;
+    }
+    return;
+  }
+
+  // Replies or timeouts of all sensors are in, fuse them once per round
+  if (!reported)
+  {
+    report();
+    reported = true;
+  }
+  if ((millis() - lastRound) >= QUERY_INTERVAL)
+  {
+    lastRound = millis();
+    nextSensor = 0;
+    reported = false;
+  }
+}
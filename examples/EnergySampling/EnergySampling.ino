@@ -0,0 +1,42 @@
+#include <NovaSDS011.h>
+#include <SDS011Sampler.h>
+
+#define SDS_PIN_RX 2
+#define SDS_PIN_TX 3
+
+NovaSDS011 sds011;
+SDS011Sampler sampler(sds011);
+
+void setup()
+{
+  Serial.begin(115200);
+  sds011.begin(SDS_PIN_RX, SDS_PIN_TX);
+
+  SDS011SamplerConfig config;
+  config.warmupTime = 20000;
+  config.minCycleInterval = 2UL * 60UL * 1000UL;
+  config.maxCycleInterval = 30UL * 60UL * 1000UL;
+  config.supplyVoltage = 5000;
+
+  if (!sampler.begin(config))
+  {
+    Serial.println("FAIL: Unable to set query reporting mode");
+  }
+}
+
+void loop()
+{
+  if (sampler.update())
+  {
+    SDS011SamplerResult result = sampler.result();
+    SDS011SamplerStats stats = sampler.stats();
+
+    if (result.valid)
+    {
+      Serial.println(String(result.timestamp / 1000) + "s:PM2.5=" + String(result.pm25 / 10.0) +
+                     ", PM10=" + String(result.pm10 / 10.0) + " from " + String(result.samples) + " samples");
+    }
+    Serial.println("Next cycle in " + String(sampler.cycleInterval() / 1000) + "s, duty cycle " +
+                   String(stats.dutyCyclePermille / 10.0) + "%, " + String(stats.milliJoulesPerSample) + "mJ/sample");
+  }
+}
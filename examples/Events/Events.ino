@@ -0,0 +1,52 @@
+#include <NovaSDS011.h>
+
+#define SDS_PIN_RX 2
+#define SDS_PIN_TX 3
+#define QUERY_INTERVAL 5000
+
+NovaSDS011 sds011;
+uint32_t lastRequest = 0;
+uint32_t samples = 0;
+
+void onSample(void *context, uint16_t device_id, uint16_t pm25, uint16_t pm10, uint32_t timestamp)
+{
+  uint32_t *count = (uint32_t *)context;
+  (*count)++;
+  Serial.println(String(timestamp / 1000) + "s:" + String(device_id, HEX) + " PM2.5=" + String(pm25 / 10.0) +
+                 ", PM10=" + String(pm10 / 10.0));
+}
+
+void onError(void *context, uint16_t device_id, QuerryError error)
+{
+  Serial.println("Error " + String(error) + " from " + String(device_id, HEX));
+}
+
+void onStateChange(void *context, uint16_t device_id, WorkingMode mode)
+{
+  Serial.println(String(device_id, HEX) + (mode == WorkingMode::mode_work ? " is working" : " is sleeping"));
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  sds011.begin(SDS_PIN_RX, SDS_PIN_TX);
+
+  sds011.onSample(onSample, &samples);
+  sds011.onError(onError);
+  sds011.onStateChange(onStateChange);
+
+  sds011.setWorkingMode(WorkingMode::mode_work);
+  sds011.setDataReportingMode(DataReportingMode::query);
+}
+
+void loop()
+{
+  // Handlers run from here, loop is free for other work while reply is on the way
+  sds011.service();
+
+  if ((millis() - lastRequest) >= QUERY_INTERVAL)
+  {
+    lastRequest = millis();
+    sds011.requestData();
+  }
+}
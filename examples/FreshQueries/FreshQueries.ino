@@ -0,0 +1,36 @@
+#include <NovaSDS011.h>
+#include <SDS011QueryPlanner.h>
+
+#define SDS_PIN_RX 2
+#define SDS_PIN_TX 3
+
+NovaSDS011 sds011;
+SDS011QueryPlanner planner(sds011);
+
+void onSample(void *context, uint16_t device_id, uint16_t pm25, uint16_t pm10, uint32_t timestamp)
+{
+  SDS011PlannerStats stats = planner.stats(device_id);
+
+  Serial.println(String(timestamp / 1000) + "s:PM2.5=" + String(pm25 / 10.0) + ", PM10=" + String(pm10 / 10.0) +
+                 (stats.locked ? ", age ~" + String(stats.meanAge) + "ms" : ", learning refresh phase"));
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  sds011.begin(SDS_PIN_RX, SDS_PIN_TX);
+  sds011.setWorkingMode(WorkingMode::mode_work);
+
+  // Reading every 5 s from sensor refreshing every second
+  planner.addDevice(0xFFFF, 5000, 1000);
+  planner.onSample(onSample);
+  if (!planner.begin())
+  {
+    Serial.println("FAIL: Unable to set query reporting mode");
+  }
+}
+
+void loop()
+{
+  planner.update();
+}
@@ -0,0 +1,51 @@
+#include <NovaSDS011.h>
+#include <SDS011Payload.h>
+
+#define SDS_PIN_RX 2
+#define SDS_PIN_TX 3
+#define SDS_DEVICE_ID 0xFFFF
+#define BATCH_SIZE 4
+
+NovaSDS011 sds011;
+char payload[BATCH_SIZE * 48];
+SDS011PayloadEncoder encoder(payload, sizeof(payload));
+uint16_t deviceId;
+
+void setup()
+{
+  Serial.begin(115200);
+  sds011.begin(SDS_PIN_RX, SDS_PIN_TX);
+  sds011.setWorkingMode(WorkingMode::mode_work);
+  sds011.setDataReportingMode(DataReportingMode::query);
+  deviceId = sds011.getDeviceID(SDS_DEVICE_ID);
+
+  // Metadata record goes out with first batch
+  SDS011Version version = sds011.getVersionDate(SDS_DEVICE_ID);
+  if (version.valid)
+  {
+    encoder.addVersion(deviceId, version.year, version.month, version.day);
+  }
+}
+
+void loop()
+{
+  uint16_t pm25;
+  uint16_t pm10;
+  if (sds011.queryData(pm25, pm10, SDS_DEVICE_ID) == QuerryError::no_error)
+  {
+    // Without timestamp InfluxDB uses time of arrival, pass epoch seconds if clock is synchronized
+    bool added = encoder.addReading(deviceId, pm25, pm10);
+    if (!added || (encoder.count() >= BATCH_SIZE))
+    {
+      // Publish with MQTT or HTTP client instead
+      Serial.print(encoder.finish());
+      encoder.reset();
+    }
+    if (!added)
+    {
+      // Reading did not fit into full buffer, it starts next batch
+      encoder.addReading(deviceId, pm25, pm10);
+    }
+  }
+  delay(3000);
+}
@@ -0,0 +1,45 @@
+#include <NovaSDS011.h>
+#include <SDS011Quantiles.h>
+
+#define SDS_PIN_RX 2
+#define SDS_PIN_TX 3
+
+#define REPORT_INTERVAL (60UL * 60UL * 1000UL)
+
+NovaSDS011 sds011;
+SDS011QuantileSketch pm25Sketch;
+uint32_t lastReport = 0;
+
+void setup()
+{
+  Serial.begin(115200);
+  sds011.begin(SDS_PIN_RX, SDS_PIN_TX);
+  sds011.setDataReportingMode(DataReportingMode::query);
+  sds011.setWorkingMode(WorkingMode::mode_work);
+}
+
+void loop()
+{
+  uint16_t p25, p10;
+  if (sds011.queryData(p25, p10) == QuerryError::no_error)
+  {
+    pm25Sketch.add(p25);
+  }
+
+  if (millis() - lastReport >= REPORT_INTERVAL)
+  {
+    lastReport = millis();
+
+    Serial.println("PM2.5 samples=" + String(pm25Sketch.count()) +
+                   " P50=" + String(pm25Sketch.quantile(500) / 10.0) +
+                   " P95=" + String(pm25Sketch.quantile(950) / 10.0) +
+                   " P98=" + String(pm25Sketch.quantile(980) / 10.0));
+
+    uint8_t payload[SDS011QuantileSketch::MAX_SERIALIZED_SIZE];
+    size_t size = pm25Sketch.serialize(payload, sizeof(payload));
+    Serial.println("Sketch size " + String(size) + " bytes");
+
+    pm25Sketch.reset();
+  }
+  delay(1000);
+}
@@ -0,0 +1,47 @@
+#include <NovaSDS011.h>
+#include <SDS011HealthMonitor.h>
+
+#define SDS_PIN_RX 2
+#define SDS_PIN_TX 3
+#define SDS_DEVICE_ID 0xFFFF
+
+NovaSDS011 sds011;
+SDS011HealthMonitor health(sds011);
+HealthState lastState = HealthState::health_ok;
+
+void setup()
+{
+  Serial.begin(115200);
+  sds011.begin(SDS_PIN_RX, SDS_PIN_TX);
+  sds011.setWorkingMode(WorkingMode::mode_work);
+  sds011.setDataReportingMode(DataReportingMode::query);
+
+  health.begin();
+  health.addDevice(SDS_DEVICE_ID);
+}
+
+void loop()
+{
+  if (health.update())
+  {
+    SDS011HealthStats stats = health.stats(SDS_DEVICE_ID);
+    Serial.println("Sensor recovered after " + String(stats.lastOutage / 1000) + "s, " +
+                   String(stats.recoveryAttempts) + " recovery attempts so far");
+  }
+
+  // Failed sensor is not queried, no time is lost on timeouts
+  uint16_t pm25;
+  uint16_t pm10;
+  if (health.queryData(pm25, pm10, SDS_DEVICE_ID) == QuerryError::no_error)
+  {
+    Serial.println("PM2.5=" + String(pm25 / 10.0) + ", PM10=" + String(pm10 / 10.0));
+  }
+
+  HealthState state = health.state(SDS_DEVICE_ID);
+  if (state != lastState)
+  {
+    lastState = state;
+    Serial.println("Sensor health " + String(state));
+  }
+  delay(3000);
+}
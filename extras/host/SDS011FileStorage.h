@@ -0,0 +1,69 @@
+/**
+ * @file SDS011FileStorage.h
+ * @brief Plain file backend of SDS011Storage for Linux.
+ *
+ * Used to read logs copied from devices and to exercise SDS011SampleLog
+ * on host.
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include "../../src/SDS011Storage.h"
+
+class SDS011FileStorage : public SDS011Storage
+{
+public:
+	/**
+		* Constructor, file is created if it does not exist.
+		* @param path file name
+		* @param page_size size of page in bytes
+		* @param page_count number of pages
+		*/
+	SDS011FileStorage(const char *path, uint16_t page_size, uint16_t page_count)
+		: _pageSize(page_size), _pageCount(page_count)
+	{
+		_file = fopen(path, "r+b");
+		if (_file == NULL)
+		{
+			_file = fopen(path, "w+b");
+		}
+	}
+
+	~SDS011FileStorage()
+	{
+		if (_file != NULL)
+		{
+			fclose(_file);
+		}
+	}
+
+	bool isOpen() const { return _file != NULL; }
+
+	uint16_t pageSize() const { return _pageSize; }
+	uint16_t pageCount() const { return _pageCount; }
+
+	bool readPage(uint16_t page, uint8_t *data)
+	{
+		if ((_file == NULL) || (fseek(_file, (long)page * _pageSize, SEEK_SET) != 0))
+		{
+			return false;
+		}
+		return fread(data, 1, _pageSize, _file) == _pageSize;
+	}
+
+	bool writePage(uint16_t page, const uint8_t *data)
+	{
+		if ((_file == NULL) || (fseek(_file, (long)page * _pageSize, SEEK_SET) != 0))
+		{
+			return false;
+		}
+		bool ok = fwrite(data, 1, _pageSize, _file) == _pageSize;
+		return ok && (fflush(_file) == 0);
+	}
+
+private:
+	FILE *_file;
+	uint16_t _pageSize;
+	uint16_t _pageCount;
+};
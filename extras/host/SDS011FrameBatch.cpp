@@ -0,0 +1,196 @@
+/**
+ * @file SDS011FrameBatch.cpp
+ * @brief Batch validation of concatenated sds011 data frames for ingestion servers.
+ */
+
+#include "SDS011FrameBatch.h"
+#include "../../src/SDS011Frame.h"
+
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define FRAME_SIZE 10
+
+// --------------------------------------------------------
+// Unaligned little endian loads
+// --------------------------------------------------------
+// Bytes 0-7 of frame
+static inline uint64_t loadHead(const uint8_t *frame)
+{
+  uint64_t word;
+  memcpy(&word, frame, sizeof(word));
+  return word;
+}
+
+// Bytes 8-9 of frame, checksum and tail
+static inline uint16_t loadTail(const uint8_t *frame)
+{
+  uint16_t word;
+  memcpy(&word, frame + 8, sizeof(word));
+  return word;
+}
+
+// --------------------------------------------------------
+// Scalar validation of frames first..count-1
+// --------------------------------------------------------
+static size_t decodeScalar(const uint8_t *frames, size_t first, size_t count, const SDS011FrameColumns &columns)
+{
+  size_t valid = 0;
+
+  for (size_t i = first; i < count; i++)
+  {
+    const uint8_t *frame = frames + i * FRAME_SIZE;
+    uint64_t head = loadHead(frame);
+    uint16_t tail = loadTail(frame);
+
+    // Sum bytes 2-7 in parallel, each 16-bit lane holds sum of two bytes
+    uint64_t data = head >> 16;
+    uint64_t pairs = (data & 0x00FF00FF00FFULL) + ((data >> 8) & 0x00FF00FF00FFULL);
+    uint8_t checksum = (uint8_t)(pairs + (pairs >> 16) + (pairs >> 32));
+
+    bool ok = ((head & 0xFFFF) == (SDS011_HEAD | (SDS011_REPLY_DATA << 8))) &&
+              (tail == (checksum | (SDS011_TAIL << 8)));
+
+    // Branch free, bad frames are rare but not predictable
+    columns.pm25[i] = (uint16_t)(head >> 16);
+    columns.pm10[i] = (uint16_t)(head >> 32);
+    columns.deviceId[i] = (uint16_t)(head >> 48);
+    columns.valid[i] = ok;
+    valid += ok;
+  }
+  return valid;
+}
+
+// --------------------------------------------------------
+// SDS011FrameBatch:validateScalar
+// --------------------------------------------------------
+size_t SDS011FrameBatch::validateScalar(const uint8_t *frames, size_t count, const SDS011FrameColumns &columns)
+{
+  return decodeScalar(frames, 0, count, columns);
+}
+
+#if defined(__AVX2__)
+
+// --------------------------------------------------------
+// SDS011FrameBatch:validate (4 frames per iteration)
+// --------------------------------------------------------
+size_t SDS011FrameBatch::validate(const uint8_t *frames, size_t count, const SDS011FrameColumns &columns)
+{
+  const __m256i expected = _mm256_set1_epi64x(SDS011_HEAD | (SDS011_REPLY_DATA << 8));
+  const __m256i headMask = _mm256_set1_epi64x(0xFFFF);
+  const __m256i tailMark = _mm256_set1_epi64x(SDS011_TAIL << 8);
+  const __m256i byteMask = _mm256_set1_epi64x(0xFF);
+  const __m256i zero = _mm256_setzero_si256();
+  // In each 128-bit lane gather PM2.5, PM10 and device id words of both frames
+  const __m256i gather = _mm256_setr_epi8(2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15, -1, -1, -1, -1,
+                                          2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15, -1, -1, -1, -1);
+  const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+  size_t valid = 0;
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4)
+  {
+    const uint8_t *frame = frames + i * FRAME_SIZE;
+    __m256i head = _mm256_set_epi64x(loadHead(frame + 30), loadHead(frame + 20),
+                                     loadHead(frame + 10), loadHead(frame));
+    __m256i tail = _mm256_set_epi64x(loadTail(frame + 30), loadTail(frame + 20),
+                                     loadTail(frame + 10), loadTail(frame));
+
+    // Sum of absolute differences against zero adds bytes 2-7 of each frame
+    __m256i sums = _mm256_sad_epu8(_mm256_andnot_si256(headMask, head), zero);
+    __m256i ok = _mm256_and_si256(
+        _mm256_cmpeq_epi64(_mm256_and_si256(head, headMask), expected),
+        _mm256_cmpeq_epi64(tail, _mm256_or_si256(_mm256_and_si256(sums, byteMask), tailMark)));
+
+    int mask = _mm256_movemask_pd(_mm256_castsi256_pd(ok));
+    columns.valid[i] = mask & 1;
+    columns.valid[i + 1] = (mask >> 1) & 1;
+    columns.valid[i + 2] = (mask >> 2) & 1;
+    columns.valid[i + 3] = (mask >> 3) & 1;
+    valid += __builtin_popcount(mask);
+
+    // Transpose to columns: pm25 x4 | pm10 x4 | device id x4
+    __m256i fields = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(head, gather), order);
+    __m128i low = _mm256_castsi256_si128(fields);
+    _mm_storel_epi64((__m128i *)(columns.pm25 + i), low);
+    _mm_storel_epi64((__m128i *)(columns.pm10 + i), _mm_unpackhi_epi64(low, low));
+    _mm_storel_epi64((__m128i *)(columns.deviceId + i), _mm256_extracti128_si256(fields, 1));
+  }
+  return valid + decodeScalar(frames, i, count, columns);
+}
+
+const char *SDS011FrameBatch::implementation()
+{
+  return "avx2";
+}
+
+#elif defined(__SSE2__)
+
+// --------------------------------------------------------
+// SDS011FrameBatch:validate (2 frames per iteration)
+// --------------------------------------------------------
+size_t SDS011FrameBatch::validate(const uint8_t *frames, size_t count, const SDS011FrameColumns &columns)
+{
+  const __m128i expected = _mm_set1_epi16(SDS011_HEAD | (SDS011_REPLY_DATA << 8));
+  const __m128i dataMask = _mm_set_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+  const __m128i zero = _mm_setzero_si128();
+
+  size_t valid = 0;
+  size_t i = 0;
+  for (; i + 2 <= count; i += 2)
+  {
+    const uint8_t *frame = frames + i * FRAME_SIZE;
+    __m128i head = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)frame),
+                                      _mm_loadl_epi64((const __m128i *)(frame + 10)));
+
+    // Sum of absolute differences against zero adds bytes 2-7 of each frame
+    __m128i sums = _mm_sad_epu8(_mm_and_si128(head, dataMask), zero);
+    int heads = _mm_movemask_epi8(_mm_cmpeq_epi16(head, expected));
+
+    uint16_t tail0 = loadTail(frame);
+    uint16_t tail1 = loadTail(frame + 10);
+    uint8_t ok0 = ((heads & 0x0003) == 0x0003) &&
+                  (tail0 == ((_mm_cvtsi128_si32(sums) & 0xFF) | (SDS011_TAIL << 8)));
+    uint8_t ok1 = ((heads & 0x0300) == 0x0300) &&
+                  (tail1 == ((_mm_extract_epi16(sums, 4) & 0xFF) | (SDS011_TAIL << 8)));
+
+    columns.valid[i] = ok0;
+    columns.valid[i + 1] = ok1;
+    valid += ok0 + ok1;
+
+    columns.pm25[i] = _mm_extract_epi16(head, 1);
+    columns.pm10[i] = _mm_extract_epi16(head, 2);
+    columns.deviceId[i] = _mm_extract_epi16(head, 3);
+    columns.pm25[i + 1] = _mm_extract_epi16(head, 5);
+    columns.pm10[i + 1] = _mm_extract_epi16(head, 6);
+    columns.deviceId[i + 1] = _mm_extract_epi16(head, 7);
+  }
+  return valid + decodeScalar(frames, i, count, columns);
+}
+
+const char *SDS011FrameBatch::implementation()
+{
+  return "sse2";
+}
+
+#else
+
+// --------------------------------------------------------
+// SDS011FrameBatch:validate
+// --------------------------------------------------------
+size_t SDS011FrameBatch::validate(const uint8_t *frames, size_t count, const SDS011FrameColumns &columns)
+{
+  return decodeScalar(frames, 0, count, columns);
+}
+
+const char *SDS011FrameBatch::implementation()
+{
+  return "scalar";
+}
+
+#endif
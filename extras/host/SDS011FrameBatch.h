@@ -0,0 +1,47 @@
+/**
+ * @file SDS011FrameBatch.h
+ * @brief Batch validation of concatenated sds011 data frames for ingestion servers.
+ *
+ * Input is buffer of back-to-back 10-byte replies as forwarded by nodes.
+ * Every frame is checked for head, SDS011_REPLY_DATA command id, checksum
+ * and tail; values are written column by column (structure of arrays) so
+ * they can be appended to columnar storage without another pass.
+ * Uses AVX2 or SSE2 when compiler targets them, scalar code otherwise.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct SDS011FrameColumns
+{
+	uint16_t *pm25;     // PM2.5 in tenths of μg/m3
+	uint16_t *pm10;     // PM10 in tenths of μg/m3
+	uint16_t *deviceId; // device id from frame
+	uint8_t *valid;     // 1 if frame is valid data frame, 0 otherwise
+};
+
+class SDS011FrameBatch
+{
+public:
+	/**
+		* Validate and decode frames, fastest implementation available.
+		* Values of invalid frames are decoded as well, check valid column.
+		* @param frames count * 10 bytes
+		* @param count number of frames
+		* @param columns output arrays, count elements each
+		* @return number of valid frames
+		*/
+	static size_t validate(const uint8_t *frames, size_t count, const SDS011FrameColumns &columns);
+
+	/**
+		* Same as validate() without SIMD, reference for tests and benchmarks.
+		*/
+	static size_t validateScalar(const uint8_t *frames, size_t count, const SDS011FrameColumns &columns);
+
+	/**
+		* Name of implementation used by validate(): "avx2", "sse2" or "scalar".
+		*/
+	static const char *implementation();
+};
@@ -0,0 +1,194 @@
+/**
+ * @file SDS011PosixSerial.cpp
+ * @brief Serial port or pty as Arduino Stream on Linux.
+ */
+
+#include "SDS011PosixSerial.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+// --------------------------------------------------------
+// Baud rate constant of termios
+// --------------------------------------------------------
+static speed_t baudConstant(unsigned long baud)
+{
+  switch (baud)
+  {
+  case 1200:
+    return B1200;
+  case 2400:
+    return B2400;
+  case 4800:
+    return B4800;
+  case 19200:
+    return B19200;
+  case 38400:
+    return B38400;
+  case 57600:
+    return B57600;
+  case 115200:
+    return B115200;
+  default:
+    return B9600;
+  }
+}
+
+// --------------------------------------------------------
+// SDS011PosixSerial:open
+// --------------------------------------------------------
+bool SDS011PosixSerial::open(const char *path, unsigned long baud)
+{
+  close();
+  _fd = ::open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (_fd < 0)
+  {
+    return false;
+  }
+
+  termios options;
+  if (tcgetattr(_fd, &options) != 0)
+  {
+    close();
+    return false;
+  }
+  cfmakeraw(&options);
+  options.c_cflag |= CLOCAL | CREAD;
+  options.c_cflag &= ~(CSTOPB | PARENB | CRTSCTS);
+  cfsetispeed(&options, baudConstant(baud));
+  cfsetospeed(&options, baudConstant(baud));
+  if (tcsetattr(_fd, TCSANOW, &options) != 0)
+  {
+    close();
+    return false;
+  }
+
+  tcflush(_fd, TCIOFLUSH);
+  return true;
+}
+
+// --------------------------------------------------------
+// SDS011PosixSerial:close
+// --------------------------------------------------------
+void SDS011PosixSerial::close()
+{
+  if (_fd >= 0)
+  {
+    ::close(_fd);
+  }
+  _fd = -1;
+  _pos = 0;
+  _length = 0;
+}
+
+// --------------------------------------------------------
+// SDS011PosixSerial:fill
+// --------------------------------------------------------
+bool SDS011PosixSerial::fill()
+{
+  if (_pos < _length)
+  {
+    return true;
+  }
+  if (_fd < 0)
+  {
+    return false;
+  }
+
+  ssize_t size = ::read(_fd, _buffer, sizeof(_buffer));
+  _pos = 0;
+  _length = (size > 0) ? size : 0;
+  return _length > 0;
+}
+
+// --------------------------------------------------------
+// SDS011PosixSerial:waitReadable
+// --------------------------------------------------------
+bool SDS011PosixSerial::waitReadable(uint32_t timeout)
+{
+  if ((_pos < _length) || (_fd < 0))
+  {
+    return _pos < _length;
+  }
+
+  pollfd request = {_fd, POLLIN, 0};
+  return (poll(&request, 1, timeout) > 0) && fill();
+}
+
+// --------------------------------------------------------
+// SDS011PosixSerial:available
+// --------------------------------------------------------
+int SDS011PosixSerial::available()
+{
+  int pending = 0;
+  if ((_fd >= 0) && (ioctl(_fd, FIONREAD, &pending) != 0))
+  {
+    pending = 0;
+  }
+  return (_length - _pos) + pending;
+}
+
+// --------------------------------------------------------
+// SDS011PosixSerial:read
+// --------------------------------------------------------
+int SDS011PosixSerial::read()
+{
+  return fill() ? _buffer[_pos++] : -1;
+}
+
+// --------------------------------------------------------
+// SDS011PosixSerial:peek
+// --------------------------------------------------------
+int SDS011PosixSerial::peek()
+{
+  return fill() ? _buffer[_pos] : -1;
+}
+
+// --------------------------------------------------------
+// SDS011PosixSerial:write
+// --------------------------------------------------------
+size_t SDS011PosixSerial::write(uint8_t byte)
+{
+  return write(&byte, 1);
+}
+
+// --------------------------------------------------------
+// SDS011PosixSerial:write
+// --------------------------------------------------------
+size_t SDS011PosixSerial::write(const uint8_t *buffer, size_t size)
+{
+  size_t written = 0;
+  while ((_fd >= 0) && (written < size))
+  {
+    ssize_t result = ::write(_fd, buffer + written, size - written);
+    if (result > 0)
+    {
+      written += result;
+    }
+    else if ((result < 0) && (errno == EAGAIN))
+    {
+      pollfd request = {_fd, POLLOUT, 0};
+      poll(&request, 1, 100);
+    }
+    else
+    {
+      break;
+    }
+  }
+  return written;
+}
+
+// --------------------------------------------------------
+// SDS011PosixSerial:flush
+// --------------------------------------------------------
+void SDS011PosixSerial::flush()
+{
+  if (_fd >= 0)
+  {
+    tcdrain(_fd);
+  }
+}
@@ -0,0 +1,54 @@
+/**
+ * @file SDS011PosixSerial.h
+ * @brief Serial port or pty as Arduino Stream on Linux.
+ *
+ * Opens /dev/ttyUSB* adapter (or pty of sds011_sim) in raw 8N1 mode so
+ * NovaSDS011::begin(Stream&) can drive a sensor from host. Needs Arduino
+ * shim from arduino/ directory.
+ */
+
+#pragma once
+
+#include "Arduino.h"
+
+class SDS011PosixSerial : public Stream
+{
+public:
+	SDS011PosixSerial() : _fd(-1), _pos(0), _length(0) {}
+	~SDS011PosixSerial() { close(); }
+
+	/**
+		* Open port in raw mode.
+		* @param path device, e.g. /dev/ttyUSB0
+		* @param baud baud rate, sensor uses 9600
+		* @return false if port can not be opened or configured
+		*/
+	bool open(const char *path, unsigned long baud = 9600);
+
+	/**
+		* Close port.
+		*/
+	void close();
+
+	/**
+		* Wait until byte arrives.
+		* @param timeout time in ms
+		* @return true if byte is available
+		*/
+	bool waitReadable(uint32_t timeout);
+
+	int available();
+	int read();
+	int peek();
+	size_t write(uint8_t byte);
+	size_t write(const uint8_t *buffer, size_t size);
+	void flush();
+
+private:
+	bool fill();
+
+	int _fd;
+	uint8_t _buffer[256];
+	size_t _pos;
+	size_t _length;
+};
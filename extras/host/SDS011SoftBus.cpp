@@ -0,0 +1,160 @@
+/**
+ * @file SDS011SoftBus.cpp
+ * @brief Serial bus of software sensors on virtual clock for host checks.
+ */
+
+#include "SDS011SoftBus.h"
+
+#include "../../src/SDS011Clock.h"
+
+uint32_t SDS011SoftBus::_millis = 0;
+uint32_t SDS011SoftBus::_rest = 0;
+
+// --------------------------------------------------------
+// SDS011SoftBus:start
+// --------------------------------------------------------
+void SDS011SoftBus::start(uint32_t time)
+{
+  _millis = time;
+  _rest = 0;
+  SDS011Clock::setSource(millis, micros);
+  setSleepHook(sleep);
+}
+
+// --------------------------------------------------------
+// SDS011SoftBus:stop
+// --------------------------------------------------------
+void SDS011SoftBus::stop()
+{
+  SDS011Clock::setSource(NULL);
+  setSleepHook(NULL);
+}
+
+// --------------------------------------------------------
+// SDS011SoftBus:sleep
+// --------------------------------------------------------
+void SDS011SoftBus::sleep(unsigned long duration)
+{
+  _rest += duration;
+  _millis += _rest / 1000;
+  _rest %= 1000;
+}
+
+// --------------------------------------------------------
+// SDS011SoftBus:attach
+// --------------------------------------------------------
+void SDS011SoftBus::attach(SDS011SoftSensor *sensor)
+{
+  if (_count < SDS011_SOFT_BUS_DEVICES)
+  {
+    _sensors[_count++] = sensor;
+  }
+}
+
+// --------------------------------------------------------
+// SDS011SoftBus:sendAfterCommand
+// --------------------------------------------------------
+void SDS011SoftBus::sendAfterCommand(const uint8_t *bytes, size_t size)
+{
+  _pendingInjection.insert(_pendingInjection.end(), bytes, bytes + size);
+}
+
+// --------------------------------------------------------
+// SDS011SoftBus:advance
+// --------------------------------------------------------
+void SDS011SoftBus::advance(uint32_t duration)
+{
+  // Step by ms so overlapping replies collide like when driver polls
+  for (uint32_t i = 0; i < duration; i++)
+  {
+    _millis++;
+    pull();
+  }
+}
+
+// --------------------------------------------------------
+// SDS011SoftBus:write
+// --------------------------------------------------------
+size_t SDS011SoftBus::write(uint8_t byte)
+{
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    _sensors[i]->receive(byte, _millis);
+  }
+
+  // Driver writes whole command frames
+  if (++_written == 19)
+  {
+    _written = 0;
+    _injected.insert(_injected.end(), _pendingInjection.begin(), _pendingInjection.end());
+    _pendingInjection.clear();
+    _injectAt = _millis + 1;
+  }
+  return 1;
+}
+
+// --------------------------------------------------------
+// SDS011SoftBus:available
+// --------------------------------------------------------
+int SDS011SoftBus::available()
+{
+  pull();
+  return _input.size();
+}
+
+// --------------------------------------------------------
+// SDS011SoftBus:read
+// --------------------------------------------------------
+int SDS011SoftBus::read()
+{
+  pull();
+  if (_input.empty())
+  {
+    return -1;
+  }
+  uint8_t byte = _input.front();
+  _input.pop_front();
+  return byte;
+}
+
+// --------------------------------------------------------
+// SDS011SoftBus:peek
+// --------------------------------------------------------
+int SDS011SoftBus::peek()
+{
+  pull();
+  return _input.empty() ? -1 : _input.front();
+}
+
+// --------------------------------------------------------
+// SDS011SoftBus:pull
+// --------------------------------------------------------
+void SDS011SoftBus::pull()
+{
+  if (!_injected.empty() && SDS011Clock::reached(_millis, _injectAt))
+  {
+    _input.insert(_input.end(), _injected.begin(), _injected.end());
+    _injected.clear();
+  }
+
+  // Byte of each sensor due in this ms, sent at once they mix on the line
+  uint8_t bytes[SDS011_SOFT_BUS_DEVICES][32];
+  size_t sizes[SDS011_SOFT_BUS_DEVICES];
+  size_t longest = 0;
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    _sensors[i]->update(_millis);
+    sizes[i] = _sensors[i]->transmit(bytes[i], sizeof(bytes[i]), _millis);
+    longest = (sizes[i] > longest) ? sizes[i] : longest;
+  }
+  for (size_t pos = 0; pos < longest; pos++)
+  {
+    for (uint8_t i = 0; i < _count; i++)
+    {
+      if (pos < sizes[i])
+      {
+        _input.push_back(bytes[i][pos]);
+      }
+    }
+  }
+}
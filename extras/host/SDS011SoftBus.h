@@ -0,0 +1,81 @@
+/**
+ * @file SDS011SoftBus.h
+ * @brief Serial bus of software sensors on virtual clock for host checks.
+ *
+ * Bytes written by driver go to every attached SDS011SoftSensor. Time is
+ * virtual and moves only when driver sleeps in delay() or yield() (see
+ * start()), so blocking calls take their real timeouts without waiting and
+ * runs are repeatable. Bytes which several sensors send in same ms are
+ * interleaved like colliding frames on real bus.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <deque>
+
+#include "SDS011SoftSensor.h"
+
+#define SDS011_SOFT_BUS_DEVICES 4
+
+class SDS011SoftBus : public Stream
+{
+public:
+	SDS011SoftBus() : _count(0), _written(0), _injectAt(0) {}
+
+	/**
+		* Switch SDS011Clock, delay() and yield() to virtual time of bus.
+		* @param time start time in ms
+		*/
+	static void start(uint32_t time = 0);
+
+	/**
+		* Restore real time.
+		*/
+	static void stop();
+
+	/**
+		* Connect sensor to bus.
+		* @param sensor sensor, must outlive bus
+		*/
+	void attach(SDS011SoftSensor *sensor);
+
+	/**
+		* Send bytes 1 ms after next complete command frame, ahead of sensor replies.
+		* @param bytes e.g. noise or frames of other devices
+		* @param size number of bytes
+		*/
+	void sendAfterCommand(const uint8_t *bytes, size_t size);
+
+	/**
+		* Move virtual time forward, bytes sent meanwhile wait in input buffer.
+		* @param duration time in ms
+		*/
+	void advance(uint32_t duration);
+
+	/**
+		* Current virtual time in ms.
+		*/
+	static uint32_t millis() { return _millis; }
+	static uint32_t micros() { return _millis * 1000 + _rest; }
+
+	size_t write(uint8_t byte) override;
+	int available() override;
+	int read() override;
+	int peek() override;
+
+private:
+	static void sleep(unsigned long duration);
+	void pull();
+
+	static uint32_t _millis;
+	static uint32_t _rest;  // μs not yet counted in _millis
+
+	SDS011SoftSensor *_sensors[SDS011_SOFT_BUS_DEVICES];
+	uint8_t _count;
+	uint8_t _written;
+	uint32_t _injectAt;
+	std::deque<uint8_t> _input;
+	std::deque<uint8_t> _injected;
+	std::deque<uint8_t> _pendingInjection;
+};
@@ -0,0 +1,232 @@
+/**
+ * @file SDS011SoftSensor.cpp
+ * @brief Software stand-in of sds011 sensor for host tests.
+ */
+
+#include "SDS011SoftSensor.h"
+
+#include "../../src/SDS011Frame.h"
+
+// Time to send one byte at 9600 baud is ~1 ms
+#define BYTE_TIME 1
+
+// --------------------------------------------------------
+// SDS011SoftSensor:constructor
+// --------------------------------------------------------
+SDS011SoftSensor::SDS011SoftSensor(uint16_t device_id)
+    : _deviceId(device_id), _active(true), _working(true), _dutyCycle(0), _pm25(120), _pm10(250),
+      _nextData(0), _pos(0), _dropPercent(0), _corruptPercent(0), _noisePercent(0), _replyDelay(5),
+      _random(device_id), _stats()
+{
+}
+
+// --------------------------------------------------------
+// SDS011SoftSensor:setFaults
+// --------------------------------------------------------
+void SDS011SoftSensor::setFaults(uint8_t drop_percent, uint8_t corrupt_percent, uint8_t noise_percent)
+{
+  _dropPercent = drop_percent;
+  _corruptPercent = corrupt_percent;
+  _noisePercent = noise_percent;
+}
+
+// --------------------------------------------------------
+// SDS011SoftSensor:random
+// --------------------------------------------------------
+uint32_t SDS011SoftSensor::random()
+{
+  // Low bits of LCG repeat with short period, use high ones
+  _random = _random * 1103515245 + 12345;
+  return _random >> 16;
+}
+
+// --------------------------------------------------------
+// SDS011SoftSensor:receive
+// --------------------------------------------------------
+void SDS011SoftSensor::receive(uint8_t byte, uint32_t now)
+{
+  if (((_pos == 0) && (byte != SDS011_HEAD)) || ((_pos == 1) && (byte != SDS011_COMMAND)))
+  {
+    _pos = (byte == SDS011_HEAD) ? 1 : 0;
+    _command[0] = byte;
+    return;
+  }
+
+  _command[_pos++] = byte;
+  if (_pos < sizeof(CommandType))
+  {
+    return;
+  }
+  _pos = 0;
+
+  uint8_t sum = 0;
+  for (uint8_t i = 2; i <= 16; i++)
+  {
+    sum += _command[i];
+  }
+  if ((_command[17] == sum) && (_command[18] == SDS011_TAIL))
+  {
+    handleCommand(now);
+  }
+}
+
+// --------------------------------------------------------
+// SDS011SoftSensor:handleCommand
+// --------------------------------------------------------
+void SDS011SoftSensor::handleCommand(uint32_t now)
+{
+  uint16_t target = _command[15] | (_command[16] << 8);
+  uint8_t sub = _command[2];
+  bool set = (_command[3] == 0x01);
+
+  // Sleeping sensor only listens to working mode command
+  if (((target != 0xFFFF) && (target != _deviceId)) || (!_working && (sub != SDS011_WORKING_MODE)))
+  {
+    _stats.ignored++;
+    return;
+  }
+  _stats.commands++;
+
+  uint8_t data[4] = {sub, _command[3], 0, 0};
+  switch (sub)
+  {
+  case SDS011_REPORTING_MODE:
+    if (set)
+    {
+      _active = (_command[4] == 0);
+    }
+    data[2] = _active ? 0 : 1;
+    break;
+
+  case SDS011_QUERY_DATA:
+    sendData(now);
+    return;
+
+  case SDS011_SET_DEVICE_ID:
+    _deviceId = _command[13] | (_command[14] << 8);
+    data[1] = 0;
+    break;
+
+  case SDS011_WORKING_MODE:
+    if (set)
+    {
+      _working = (_command[4] == 1);
+      _nextData = now + 1000;
+    }
+    data[2] = _working ? 1 : 0;
+    break;
+
+  case SDS011_VERSION:
+    data[1] = 18;
+    data[2] = 11;
+    data[3] = 16;
+    break;
+
+  case SDS011_DUTY_CYCLE:
+    if (set && (_command[4] <= 30))
+    {
+      _dutyCycle = _command[4];
+    }
+    data[2] = _dutyCycle;
+    break;
+
+  default:
+    return;
+  }
+  sendReply(SDS011_REPLY_COMMAND, data, now);
+}
+
+// --------------------------------------------------------
+// SDS011SoftSensor:sendData
+// --------------------------------------------------------
+void SDS011SoftSensor::sendData(uint32_t now)
+{
+  // PM as random walk
+  _pm25 += (int32_t)(random() % 7) - 3;
+  _pm10 += (int32_t)(random() % 11) - 5;
+  _pm25 = (_pm25 < 0) ? 0 : ((_pm25 > 9999) ? 9999 : _pm25);
+  _pm10 = (_pm10 < _pm25) ? _pm25 : ((_pm10 > 9999) ? 9999 : _pm10);
+
+  uint8_t data[4] = {(uint8_t)(_pm25 & 0xFF), (uint8_t)(_pm25 >> 8), (uint8_t)(_pm10 & 0xFF),
+                     (uint8_t)(_pm10 >> 8)};
+  sendReply(SDS011_REPLY_DATA, data, now);
+}
+
+// --------------------------------------------------------
+// SDS011SoftSensor:sendReply
+// --------------------------------------------------------
+void SDS011SoftSensor::sendReply(uint8_t command, const uint8_t data[4], uint32_t now)
+{
+  if ((random() % 100) < _dropPercent)
+  {
+    _stats.dropped++;
+    return;
+  }
+
+  ReplyType frame = {SDS011_HEAD, command, data[0], data[1], data[2], data[3],
+                     (uint8_t)(_deviceId & 0xFF), (uint8_t)(_deviceId >> 8), 0, SDS011_TAIL};
+  for (uint8_t i = 2; i < 8; i++)
+  {
+    frame[8] += frame[i];
+  }
+  if ((random() % 100) < _corruptPercent)
+  {
+    frame[2 + random() % 8] ^= 1 << (random() % 8);
+    _stats.corrupted++;
+  }
+
+  // Bytes follow previous reply, if any, at serial speed
+  uint32_t time = now + _replyDelay;
+  if (!_outputTime.empty() && ((int32_t)(_outputTime.back() + BYTE_TIME - time) > 0))
+  {
+    time = _outputTime.back() + BYTE_TIME;
+  }
+  if ((random() % 100) < _noisePercent)
+  {
+    uint8_t count = 1 + random() % 4;
+    for (uint8_t i = 0; i < count; i++)
+    {
+      _output.push_back((i == 0) ? SDS011_HEAD : (uint8_t)random());
+      _outputTime.push_back(time);
+      time += BYTE_TIME;
+    }
+    _stats.noise += count;
+  }
+  for (uint8_t i = 0; i < sizeof(ReplyType); i++)
+  {
+    _output.push_back(frame[i]);
+    _outputTime.push_back(time);
+    time += BYTE_TIME;
+  }
+  _stats.replies++;
+}
+
+// --------------------------------------------------------
+// SDS011SoftSensor:update
+// --------------------------------------------------------
+void SDS011SoftSensor::update(uint32_t now)
+{
+  if (!_working || !_active || ((int32_t)(now - _nextData) < 0))
+  {
+    return;
+  }
+
+  // Duty cycle in minutes, 0 is continuous mode with data every second
+  _nextData = now + ((_dutyCycle == 0) ? 1000 : (uint32_t)_dutyCycle * 60000);
+  sendData(now);
+}
+
+// --------------------------------------------------------
+// SDS011SoftSensor:transmit
+// --------------------------------------------------------
+size_t SDS011SoftSensor::transmit(uint8_t *buffer, size_t size, uint32_t now)
+{
+  size_t count = 0;
+  while ((count < size) && !_output.empty() && ((int32_t)(now - _outputTime.front()) >= 0))
+  {
+    buffer[count++] = _output.front();
+    _output.pop_front();
+    _outputTime.pop_front();
+  }
+  return count;
+}
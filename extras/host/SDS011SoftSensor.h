@@ -0,0 +1,109 @@
+/**
+ * @file SDS011SoftSensor.h
+ * @brief Software stand-in of sds011 sensor for host tests.
+ *
+ * Answers command frames like real sensor: reporting mode, query data,
+ * device id, working mode (sleeping sensor answers only wake up), firmware
+ * version and duty cycle; sends data frames in active mode. Replies are
+ * delayed and can be dropped, corrupted or preceded by noise, so driver
+ * timeout and resync paths are exercised without hardware.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+
+struct SDS011SoftSensorStats
+{
+	uint32_t commands;   // valid command frames
+	uint32_t ignored;    // commands for other device or while sleeping
+	uint32_t replies;    // frames sent, including active mode data
+	uint32_t dropped;    // replies not sent on purpose
+	uint32_t corrupted;  // replies sent with flipped bit
+	uint32_t noise;      // junk bytes sent
+};
+
+class SDS011SoftSensor
+{
+public:
+	/**
+		* Constructor, sensor is working in active reporting mode like after power on.
+		* @param device_id device id
+		*/
+	SDS011SoftSensor(uint16_t device_id = 0x1A2B);
+
+	/**
+		* Set fault injection.
+		* @param drop_percent replies which are not sent
+		* @param corrupt_percent replies with one bit flipped
+		* @param noise_percent replies preceded by junk bytes
+		*/
+	void setFaults(uint8_t drop_percent, uint8_t corrupt_percent, uint8_t noise_percent);
+
+	/**
+		* Set time from command to first byte of reply.
+		* @param delay time in ms
+		*/
+	void setReplyDelay(uint32_t delay) { _replyDelay = delay; }
+
+	/**
+		* Feed byte sent by host.
+		* @param byte received byte
+		* @param now current time in ms
+		*/
+	void receive(uint8_t byte, uint32_t now);
+
+	/**
+		* Send active mode data when due.
+		* @param now current time in ms
+		*/
+	void update(uint32_t now);
+
+	/**
+		* Take bytes which are due to be sent.
+		* @param [out] buffer output buffer
+		* @param size size of buffer
+		* @param now current time in ms
+		* @return number of bytes
+		*/
+	size_t transmit(uint8_t *buffer, size_t size, uint32_t now);
+
+	/**
+		* Get device id.
+		*/
+	uint16_t deviceId() const { return _deviceId; }
+
+	/**
+		* Get counters.
+		*/
+	SDS011SoftSensorStats stats() const { return _stats; }
+
+private:
+	void handleCommand(uint32_t now);
+	void sendReply(uint8_t command, const uint8_t data[4], uint32_t now);
+	void sendData(uint32_t now);
+	uint32_t random();
+
+	uint16_t _deviceId;
+	bool _active;
+	bool _working;
+	uint8_t _dutyCycle;
+	int32_t _pm25;
+	int32_t _pm10;
+	uint32_t _nextData;
+
+	uint8_t _command[19];
+	uint8_t _pos;
+
+	uint8_t _dropPercent;
+	uint8_t _corruptPercent;
+	uint8_t _noisePercent;
+	uint32_t _replyDelay;
+	uint32_t _random;
+
+	std::deque<uint8_t> _output;
+	std::deque<uint32_t> _outputTime;
+	SDS011SoftSensorStats _stats;
+};
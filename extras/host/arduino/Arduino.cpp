@@ -0,0 +1,112 @@
+/**
+ * @file Arduino.cpp
+ * @brief Minimal Arduino API for building the driver on Linux.
+ */
+
+#include "Arduino.h"
+
+#include <stdio.h>
+#include <time.h>
+
+HardwareSerial Serial;
+
+static void (*sleepHook)(unsigned long duration) = NULL;
+
+// --------------------------------------------------------
+// Monotonic time in μs since first call
+// --------------------------------------------------------
+static uint64_t monotonicMicros()
+{
+  static uint64_t start = 0;
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  uint64_t value = (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+  if (start == 0)
+  {
+    start = value;
+  }
+  return value - start;
+}
+
+// --------------------------------------------------------
+// Sleep in μs
+// --------------------------------------------------------
+static void sleepMicros(uint64_t duration)
+{
+  timespec request = {(time_t)(duration / 1000000), (long)(duration % 1000000) * 1000};
+  while (nanosleep(&request, &request) != 0)
+  {
+  }
+}
+
+unsigned long millis()
+{
+  // 32 bit like on MCU, so wraparound behaves the same
+  return (uint32_t)(monotonicMicros() / 1000);
+}
+
+unsigned long micros()
+{
+  return (uint32_t)monotonicMicros();
+}
+
+void delay(unsigned long ms)
+{
+  if (sleepHook != NULL)
+  {
+    sleepHook(ms * 1000);
+    return;
+  }
+  sleepMicros((uint64_t)ms * 1000);
+}
+
+void yield()
+{
+  if (sleepHook != NULL)
+  {
+    sleepHook(100);
+    return;
+  }
+  sleepMicros(100);
+}
+
+void setSleepHook(void (*hook)(unsigned long duration))
+{
+  sleepHook = hook;
+}
+
+// --------------------------------------------------------
+// String:constructor
+// --------------------------------------------------------
+String::String(double value, unsigned char decimals)
+{
+  char text[32];
+  snprintf(text, sizeof(text), "%.*f", decimals, value);
+  _text = text;
+}
+
+// --------------------------------------------------------
+// String:format
+// --------------------------------------------------------
+std::string String::format(long long value, unsigned char base)
+{
+  char text[32];
+  snprintf(text, sizeof(text), (base == HEX) ? "%llx" : "%lld", value);
+  return text;
+}
+
+// --------------------------------------------------------
+// HardwareSerial:write
+// --------------------------------------------------------
+size_t HardwareSerial::write(uint8_t byte)
+{
+  return (fputc(byte, stdout) == EOF) ? 0 : 1;
+}
+
+// --------------------------------------------------------
+// HardwareSerial:flush
+// --------------------------------------------------------
+void HardwareSerial::flush()
+{
+  fflush(stdout);
+}
@@ -0,0 +1,114 @@
+/**
+ * @file Arduino.h
+ * @brief Minimal Arduino API for building the driver on Linux.
+ *
+ * Only what the library uses: time functions, String for traces,
+ * Print/Stream and Serial printing to stdout. Build with -DARDUINO=10800
+ * and this directory on include path.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+#define HEX 16
+#define DEC 10
+
+typedef bool boolean;
+
+/**
+	* Time since program start, CLOCK_MONOTONIC based.
+	*/
+unsigned long millis();
+unsigned long micros();
+
+/**
+	* Sleep, unlike on MCU other threads and processes keep running.
+	*/
+void delay(unsigned long ms);
+
+/**
+	* Sleeps briefly so driver wait loops do not burn whole core.
+	*/
+void yield();
+
+/**
+	* Replace sleeping of delay() and yield(), e.g. to move virtual time in checks.
+	* @param hook function taking time in μs, NULL restores real sleep
+	*/
+void setSleepHook(void (*hook)(unsigned long duration));
+
+class String
+{
+public:
+	String(const char *text = "") : _text(text) {}
+	String(const std::string &text) : _text(text) {}
+	String(char c) : _text(1, c) {}
+	String(int value, unsigned char base = DEC) : _text(format(value, base)) {}
+	String(unsigned int value, unsigned char base = DEC) : _text(format(value, base)) {}
+	String(long value, unsigned char base = DEC) : _text(format(value, base)) {}
+	String(unsigned long value, unsigned char base = DEC) : _text(format(value, base)) {}
+	String(double value, unsigned char decimals = 2);
+
+	String operator+(const String &other) const { return String(_text + other._text); }
+	friend String operator+(const char *left, const String &right) { return String(left + right._text); }
+	String &operator+=(const String &other)
+	{
+		_text += other._text;
+		return *this;
+	}
+
+	const char *c_str() const { return _text.c_str(); }
+	unsigned int length() const { return _text.size(); }
+
+private:
+	static std::string format(long long value, unsigned char base);
+
+	std::string _text;
+};
+
+class Print
+{
+public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t byte) = 0;
+	virtual size_t write(const uint8_t *buffer, size_t size)
+	{
+		size_t written = 0;
+		while (size--)
+		{
+			written += write(*buffer++);
+		}
+		return written;
+	}
+	virtual void flush() {}
+
+	size_t print(const String &text) { return write((const uint8_t *)text.c_str(), text.length()); }
+	size_t println(const String &text) { return print(text) + print("\n"); }
+};
+
+class Stream : public Print
+{
+public:
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+};
+
+class HardwareSerial : public Stream
+{
+public:
+	void begin(unsigned long) {}
+	int available() { return 0; }
+	int read() { return -1; }
+	int peek() { return -1; }
+	size_t write(uint8_t byte);
+	void flush();
+};
+
+/**
+	* Writes to stdout.
+	*/
+extern HardwareSerial Serial;
@@ -0,0 +1,22 @@
+/**
+ * @file SoftwareSerial.h
+ * @brief Placeholder of SoftwareSerial, there are no pins on Linux.
+ *
+ * Only lets pin based NovaSDS011::begin() compile, use begin(Stream&)
+ * with SDS011PosixSerial instead.
+ */
+
+#pragma once
+
+#include "Arduino.h"
+
+class SoftwareSerial : public Stream
+{
+public:
+	SoftwareSerial(uint8_t, uint8_t) {}
+	void begin(long) {}
+	int available() { return 0; }
+	int read() { return -1; }
+	int peek() { return -1; }
+	size_t write(uint8_t) { return 1; }
+};
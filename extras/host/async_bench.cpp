@@ -0,0 +1,198 @@
+/**
+ * @file async_bench.cpp
+ * @brief Runs sampling coroutines for many software sensors in one thread.
+ *
+ * Every bus is in memory link to SDS011SoftSensor devices with own driver.
+ * Each device runs script written with SDS011Async.h: set query mode, wake,
+ * warm up, take samples, go to sleep. Prints completed queries, time,
+ * CPU usage and peak memory.
+ *
+ * Build: g++ -O2 -std=c++20 -DARDUINO=10800 -Iarduino -I../../src -o async_bench async_bench.cpp SDS011SoftSensor.cpp
+ *        arduino/Arduino.cpp ../../src/NovaSDS011.cpp ../../src/SDS011Clock.cpp ../../src/SDS011DeviceCache.cpp
+ *        ../../src/SDS011Frame.cpp
+ * Usage: async_bench [buses] [devices per bus] [samples]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <vector>
+
+#include "SDS011Async.h"
+#include "SDS011SoftSensor.h"
+
+#define MAX_BUS_DEVICES 4
+#define WARMUP_TIME 2000
+#define SAMPLE_INTERVAL 1000
+
+// --------------------------------------------------------
+// Serial bus shared by software sensors
+// --------------------------------------------------------
+class SoftBus : public Stream
+{
+public:
+  SoftBus() : _count(0), _pos(0), _size(0) {}
+
+  void attach(SDS011SoftSensor *sensor)
+  {
+    _sensors[_count++] = sensor;
+  }
+
+  size_t write(uint8_t byte) override
+  {
+    for (uint8_t i = 0; i < _count; i++)
+    {
+      _sensors[i]->receive(byte, millis());
+    }
+    return 1;
+  }
+
+  int available() override
+  {
+    pull();
+    return _size - _pos;
+  }
+
+  int read() override
+  {
+    pull();
+    return (_pos < _size) ? _buffer[_pos++] : -1;
+  }
+
+  int peek() override
+  {
+    pull();
+    return (_pos < _size) ? _buffer[_pos] : -1;
+  }
+
+private:
+  void pull()
+  {
+    if (_pos < _size)
+    {
+      return;
+    }
+    // Devices talking at once collide like on real bus
+    uint32_t now = millis();
+    _pos = 0;
+    _size = 0;
+    for (uint8_t i = 0; i < _count; i++)
+    {
+      _sensors[i]->update(now);
+      _size += _sensors[i]->transmit(_buffer + _size, sizeof(_buffer) - _size, now);
+    }
+  }
+
+  SDS011SoftSensor *_sensors[MAX_BUS_DEVICES];
+  uint8_t _count;
+  uint8_t _buffer[256];
+  size_t _pos;
+  size_t _size;
+};
+
+struct BenchStats
+{
+  uint32_t scripts;
+  uint32_t queries;
+  uint32_t failed;
+  uint32_t setErrors;
+};
+
+static SDS011Task warmUp(SDS011AsyncSensor &sds, uint16_t id, BenchStats &stats)
+{
+  bool reporting = co_await sds.setDataReportingMode(DataReportingMode::query, id);
+  bool working = co_await sds.setWorkingMode(WorkingMode::mode_work, id);
+  if (!reporting || !working)
+  {
+    stats.setErrors++;
+  }
+  co_await SDS011Scheduler::sleepFor(WARMUP_TIME);
+}
+
+static SDS011Task sampleCycle(SDS011AsyncSensor &sds, uint16_t id, uint8_t samples, BenchStats &stats)
+{
+  co_await warmUp(sds, id, stats);
+
+  for (uint8_t i = 0; i < samples; i++)
+  {
+    SDS011QueryResult result = co_await sds.query(id);
+    if (result.valid && (result.deviceId == id))
+    {
+      stats.queries++;
+    }
+    else
+    {
+      stats.failed++;
+    }
+    co_await SDS011Scheduler::sleepFor(SAMPLE_INTERVAL);
+  }
+
+  bool sleeping = co_await sds.setWorkingMode(WorkingMode::mode_sleep, id);
+  if (!sleeping)
+  {
+    stats.setErrors++;
+  }
+  stats.scripts++;
+}
+
+static double cpuSeconds()
+{
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t buses = (argc > 1) ? strtoul(argv[1], NULL, 10) : 100;
+  uint32_t perBus = (argc > 2) ? strtoul(argv[2], NULL, 10) : 2;
+  uint8_t samples = (argc > 3) ? strtoul(argv[3], NULL, 10) : 3;
+  if ((perBus == 0) || (perBus > MAX_BUS_DEVICES))
+  {
+    fprintf(stderr, "Usage: async_bench [buses] [devices per bus (1-%d)] [samples]\n", MAX_BUS_DEVICES);
+    return 2;
+  }
+
+  std::vector<SoftBus> links(buses);
+  std::vector<NovaSDS011> drivers(buses);
+  std::vector<SDS011SoftSensor> sensors;
+  sensors.reserve(buses * perBus);
+
+  SDS011Scheduler scheduler;
+  std::vector<SDS011AsyncSensor> async;
+  async.reserve(buses);
+  BenchStats stats = {0, 0, 0, 0};
+
+  uint32_t start = millis();
+  double cpuStart = cpuSeconds();
+  for (uint32_t bus = 0; bus < buses; bus++)
+  {
+    drivers[bus].begin(links[bus], 200);
+    async.emplace_back(scheduler, drivers[bus]);
+    for (uint32_t i = 0; i < perBus; i++)
+    {
+      uint16_t id = 0x1000 + bus * MAX_BUS_DEVICES + i;
+      sensors.emplace_back(id);
+      links[bus].attach(&sensors.back());
+      scheduler.spawn(sampleCycle(async.back(), id, samples, stats));
+    }
+  }
+
+  scheduler.run();
+
+  double seconds = (millis() - start) / 1000.0;
+  double cpu = cpuSeconds() - cpuStart;
+  uint32_t checksumErrors = 0;
+  for (uint32_t bus = 0; bus < buses; bus++)
+  {
+    checksumErrors += drivers[bus].decoder().checksumErrors();
+  }
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  printf("%u devices on %u buses: %u scripts done, %u queries ok, %u failed, %u set errors, %u checksum errors\n",
+         buses * perBus, buses, stats.scripts, stats.queries, stats.failed, stats.setErrors, checksumErrors);
+  printf("%.1f s, cpu %.2f s (%.1f%%), max rss %ld kB\n", seconds, cpu, cpu * 100 / seconds, usage.ru_maxrss);
+  return (stats.scripts == buses * perBus) ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+/**
+ * @file batch_bench.cpp
+ * @brief Compression ratio and speed of SDS011BatchCodec on host.
+ *
+ * Build: g++ -O2 -std=c++11 -o batch_bench batch_bench.cpp ../../src/SDS011BatchCodec.cpp
+ * Usage: batch_bench [samples per batch] [batches]
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "../../src/SDS011BatchCodec.h"
+
+struct Sample
+{
+  uint32_t timestamp;
+  uint16_t pm25;
+  uint16_t pm10;
+};
+
+// Reading every minute with occasional jitter, PM as random walk with rare spikes
+static std::vector<Sample> generate(size_t count, uint32_t seed)
+{
+  std::vector<Sample> samples(count);
+  uint32_t state = seed;
+  uint32_t timestamp = 1700000000;
+  int32_t pm25 = 120;
+  int32_t pm10 = 250;
+
+  for (size_t i = 0; i < count; i++)
+  {
+    state = state * 1103515245 + 12345;
+    uint32_t random = state >> 8;
+
+    timestamp += 60 + (((random & 0x1F) == 0) ? 1 : 0);
+    pm25 += (int32_t)((random >> 5) % 7) - 3;
+    pm10 += (int32_t)((random >> 8) % 11) - 5;
+    if (((random >> 12) & 0xFF) == 0)
+    {
+      pm25 += 300;
+      pm10 += 500;
+    }
+    pm25 = (pm25 < 0) ? 0 : ((pm25 > 9999) ? 9999 : pm25);
+    pm10 = (pm10 < pm25) ? pm25 : ((pm10 > 9999) ? 9999 : pm10);
+
+    samples[i] = {timestamp, (uint16_t)pm25, (uint16_t)pm10};
+  }
+  return samples;
+}
+
+int main(int argc, char **argv)
+{
+  size_t batchSize = (argc > 1) ? strtoul(argv[1], NULL, 10) : 64;
+  size_t batches = (argc > 2) ? strtoul(argv[2], NULL, 10) : 20000;
+
+  std::vector<Sample> samples = generate(batchSize * batches, 1);
+  std::vector<uint8_t> buffer(SDS011_BATCH_HEADER_SIZE + batchSize * 12);
+  size_t encodedBytes = 0;
+  double encodeSeconds = 0;
+  double decodeSeconds = 0;
+
+  for (size_t b = 0; b < batches; b++)
+  {
+    const Sample *batch = &samples[b * batchSize];
+
+    auto start = std::chrono::steady_clock::now();
+    SDS011BatchEncoder encoder(buffer.data(), buffer.size());
+    for (size_t i = 0; i < batchSize; i++)
+    {
+      encoder.add(batch[i].timestamp, batch[i].pm25, batch[i].pm10);
+    }
+    size_t size = encoder.finish();
+    auto encoded = std::chrono::steady_clock::now();
+
+    SDS011BatchDecoder decoder(buffer.data(), size);
+    uint32_t timestamp;
+    uint16_t pm25, pm10;
+    size_t i = 0;
+    while (decoder.next(timestamp, pm25, pm10))
+    {
+      if ((i >= batchSize) || (timestamp != batch[i].timestamp) || (pm25 != batch[i].pm25) ||
+          (pm10 != batch[i].pm10))
+      {
+        fprintf(stderr, "Round trip mismatch in batch %zu sample %zu\n", b, i);
+        return 1;
+      }
+      i++;
+    }
+    auto decoded = std::chrono::steady_clock::now();
+
+    if (i != batchSize)
+    {
+      fprintf(stderr, "Batch %zu decoded %zu of %zu samples\n", b, i, batchSize);
+      return 1;
+    }
+
+    encodedBytes += size;
+    encodeSeconds += std::chrono::duration<double>(encoded - start).count();
+    decodeSeconds += std::chrono::duration<double>(decoded - encoded).count();
+  }
+
+  size_t total = batchSize * batches;
+  printf("samples:            %zu in batches of %zu\n", total, batchSize);
+  printf("bytes per sample:   %.2f (%.2f bits)\n", (double)encodedBytes / total, 8.0 * encodedBytes / total);
+  printf("ratio vs binary:    %.1fx (uint32 time + 2x uint16 = 8 bytes)\n", 8.0 * total / encodedBytes);
+  printf("ratio vs floats:    %.1fx (uint32 time + 2x float = 12 bytes)\n", 12.0 * total / encodedBytes);
+  printf("encode:             %.1f ns/sample\n", 1e9 * encodeSeconds / total);
+  printf("decode:             %.1f ns/sample\n", 1e9 * decodeSeconds / total);
+  return 0;
+}
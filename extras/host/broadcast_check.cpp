@@ -0,0 +1,106 @@
+/**
+ * @file broadcast_check.cpp
+ * @brief Checks of discover() and broadcast set commands with several sensors on one bus.
+ *
+ * Three SDS011SoftSensor devices share SDS011SoftBus. Replies with different
+ * delay follow each other, replies with same delay collide. Checks that
+ * discover() finds sleeping device, which devices are acked by broadcast
+ * and by unicast retry, which are reported missing and that out of range
+ * duty cycle is not sent. Exits 1 on failure.
+ *
+ * Build: g++ -O2 -std=c++11 -DARDUINO=10800 -Iarduino -I../../src -o broadcast_check broadcast_check.cpp
+ *        SDS011SoftBus.cpp SDS011SoftSensor.cpp arduino/Arduino.cpp ../../src/NovaSDS011.cpp ../../src/SDS011Clock.cpp
+ *        ../../src/SDS011DeviceCache.cpp ../../src/SDS011Frame.cpp
+ */
+
+#include <stdio.h>
+
+#include "NovaSDS011.h"
+#include "SDS011SoftBus.h"
+
+#define WAIT_WRITE_READ 200
+
+static int failures = 0;
+
+static void check(bool ok, const char *name, uint32_t value)
+{
+  printf("%-48s %-4s (%u)\n", name, ok ? "ok" : "FAIL", value);
+  if (!ok)
+  {
+    failures++;
+  }
+}
+
+// Commands for this device, including broadcast
+static uint32_t commands(const SDS011SoftSensor &sensor)
+{
+  return sensor.stats().commands;
+}
+
+int main()
+{
+  SDS011SoftBus::start();
+  SDS011SoftBus bus;
+  SDS011SoftSensor a(0x1001);
+  SDS011SoftSensor b(0x1002);
+  SDS011SoftSensor c(0x1003);
+  bus.attach(&a);
+  bus.attach(&b);
+  bus.attach(&c);
+  a.setReplyDelay(5);
+  b.setReplyDelay(25);
+  c.setReplyDelay(45);
+
+  NovaSDS011 sds;
+  sds.begin(bus, WAIT_WRITE_READ);
+
+  // Stop active mode data, then send one device to sleep
+  sds.broadcastDataReportingMode(DataReportingMode::query, false);
+  bus.advance(100);
+  check(sds.setWorkingMode(WorkingMode::mode_sleep, 0x1002), "setup: device 1002 sleeping", 0);
+
+  // Sleeping device answers only working mode command
+  uint8_t found = sds.discover();
+  uint8_t mode = 0xFF;
+  bool known = sds.devices().get(0x1002, cache_working_mode, mode);
+  check(found == 3, "discover: all devices found", found);
+  check(known && (mode == WorkingMode::mode_sleep), "discover: sleeping device has its mode", mode);
+
+  SDS011AckSet acks = sds.broadcastWorkingMode(WorkingMode::mode_work);
+  check((acks.count == 3) && (acks.missingCount == 0), "wake: all acked by broadcast", acks.count);
+
+  // Replies of 1002 and 1003 collide, one broadcast confirms 1001, retries the other two
+  c.setReplyDelay(25);
+  uint32_t before[3] = {commands(a), commands(b), commands(c)};
+  acks = sds.broadcastDataReportingMode(DataReportingMode::query);
+  check((acks.count == 3) && (acks.missingCount == 0), "collision: all acked after retry", acks.count);
+  check(commands(a) - before[0] == 1, "collision: 1001 acked by broadcast", commands(a) - before[0]);
+  check(commands(b) - before[1] == 2, "collision: 1002 retried", commands(b) - before[1]);
+  check(commands(c) - before[2] == 2, "collision: 1003 retried", commands(c) - before[2]);
+
+  acks = sds.broadcastWorkingMode(WorkingMode::mode_work, false);
+  check((acks.count == 1) && acks.contains(0x1001), "no retry: only 1001 acked", acks.count);
+  check((acks.missingCount == 2) && (acks.missing[0] != 0x1001) && (acks.missing[1] != 0x1001),
+        "no retry: 1002 and 1003 missing", acks.missingCount);
+
+  // Silent device stays missing after retry, its reply no longer collides with 1002
+  c.setFaults(100, 0, 0);
+  acks = sds.broadcastDutyCycle(5);
+  check((acks.count == 2) && acks.contains(0x1001) && acks.contains(0x1002), "silent: 1001 and 1002 acked",
+        acks.count);
+  check((acks.missingCount == 1) && (acks.missing[0] == 0x1003), "silent: 1003 missing", acks.missingCount);
+  uint8_t cycle;
+  check(!sds.devices().get(0x1003, cache_duty_cycle, cycle), "silent: 1003 configuration forgotten", 0);
+  c.setFaults(0, 0, 0);
+
+  // Out of range duty cycle is not sent at all
+  uint32_t sent = a.stats().commands + a.stats().ignored;
+  acks = sds.broadcastDutyCycle(255);
+  check((acks.count == 0) && (acks.missingCount == 0), "duty cycle 255: nothing acked", acks.count);
+  check(a.stats().commands + a.stats().ignored == sent, "duty cycle 255: nothing sent",
+        a.stats().commands + a.stats().ignored - sent);
+
+  SDS011SoftBus::stop();
+  printf("%d failed\n", failures);
+  return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,183 @@
+/**
+ * @file capture_replay.cpp
+ * @brief Offline decoder of captures written by SDS011CaptureTap.
+ *
+ * Build: g++ -O2 -std=c++11 -o capture_replay capture_replay.cpp ../../src/SDS011Capture.cpp ../../src/SDS011Frame.cpp
+ * Usage: capture_replay <capture> [--csv]
+ *        capture_replay --generate <capture> [frames]
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "../../src/SDS011Capture.h"
+#include "../../src/SDS011Frame.h"
+
+static bool readFile(const char *path, std::vector<uint8_t> &data)
+{
+  FILE *file = fopen(path, "rb");
+  if (file == NULL)
+  {
+    return false;
+  }
+  uint8_t chunk[65536];
+  size_t size;
+  while ((size = fread(chunk, 1, sizeof(chunk), file)) > 0)
+  {
+    data.insert(data.end(), chunk, chunk + size);
+  }
+  fclose(file);
+  return true;
+}
+
+static void appendRecord(std::vector<uint8_t> &out, bool tx, uint32_t delta, const uint8_t *data, uint8_t length)
+{
+  uint8_t header[SDS011_CAPTURE_MAX_RECORD_HEADER];
+  size_t size = SDS011Capture::writeRecordHeader(header, tx, delta, length);
+  out.insert(out.end(), header, header + size);
+  out.insert(out.end(), data, data + length);
+}
+
+// Query/reply traffic with occasional line noise and corrupted checksum
+static int generate(const char *path, size_t frames)
+{
+  std::vector<uint8_t> out(SDS011_CAPTURE_HEADER_SIZE);
+  SDS011Capture::writeFileHeader(out.data());
+
+  uint32_t state = 1;
+  uint16_t pm25 = 120;
+  uint16_t pm10 = 250;
+  for (size_t i = 0; i < frames; i++)
+  {
+    state = state * 1103515245 + 12345;
+    uint32_t random = state >> 8;
+
+    uint8_t command[19] = {SDS011_HEAD, SDS011_COMMAND, SDS011_QUERY_DATA};
+    command[15] = 0xFF;
+    command[16] = 0xFF;
+    uint8_t sum = 0;
+    for (uint8_t j = 2; j < 17; j++)
+    {
+      sum += command[j];
+    }
+    command[17] = sum;
+    command[18] = SDS011_TAIL;
+    appendRecord(out, true, 3000, command, sizeof(command));
+
+    pm25 = (uint16_t)(pm25 + (random % 7) - 3);
+    pm10 = (uint16_t)(pm10 + ((random >> 4) % 11) - 5);
+    uint8_t reply[10] = {SDS011_HEAD, SDS011_REPLY_DATA,
+                         (uint8_t)(pm25 & 0xFF), (uint8_t)(pm25 >> 8),
+                         (uint8_t)(pm10 & 0xFF), (uint8_t)(pm10 >> 8),
+                         0x34, 0x12};
+    sum = 0;
+    for (uint8_t j = 2; j < 8; j++)
+    {
+      sum += reply[j];
+    }
+    reply[8] = sum;
+    reply[9] = SDS011_TAIL;
+    if (((random >> 8) & 0xFF) == 0)
+    {
+      reply[8] ^= 0x01;
+    }
+    if (((random >> 16) & 0xFF) == 0)
+    {
+      uint8_t noise[3] = {0x00, SDS011_TAIL, SDS011_HEAD};
+      appendRecord(out, false, 1, noise, sizeof(noise));
+    }
+    appendRecord(out, false, 5, reply, sizeof(reply));
+  }
+
+  FILE *file = fopen(path, "wb");
+  if ((file == NULL) || (fwrite(out.data(), 1, out.size(), file) != out.size()))
+  {
+    fprintf(stderr, "cannot write %s\n", path);
+    return 1;
+  }
+  fclose(file);
+  printf("%zu frames, %zu bytes\n", frames, out.size());
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  if ((argc > 2) && (strcmp(argv[1], "--generate") == 0))
+  {
+    return generate(argv[2], (argc > 3) ? strtoul(argv[3], NULL, 10) : 1000000);
+  }
+  if (argc < 2)
+  {
+    fprintf(stderr, "usage: %s <capture> [--csv]\n       %s --generate <capture> [frames]\n", argv[0], argv[0]);
+    return 2;
+  }
+  bool csv = (argc > 2) && (strcmp(argv[2], "--csv") == 0);
+
+  std::vector<uint8_t> data;
+  if (!readFile(argv[1], data))
+  {
+    fprintf(stderr, "cannot read %s\n", argv[1]);
+    return 1;
+  }
+
+  SDS011CaptureReader reader(data.data(), data.size());
+  if (!reader.valid())
+  {
+    fprintf(stderr, "%s is not capture\n", argv[1]);
+    return 1;
+  }
+
+  SDS011FrameDecoder decoder;
+  SDS011CaptureRecord record;
+  uint64_t txBytes = 0;
+  uint64_t rxBytes = 0;
+  uint64_t dataFrames = 0;
+  uint64_t pm25Sum = 0;
+
+  if (csv)
+  {
+    printf("timestamp,device_id,pm25,pm10\n");
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  while (reader.next(record))
+  {
+    if (record.tx)
+    {
+      txBytes += record.length;
+      continue;
+    }
+    rxBytes += record.length;
+    for (uint8_t i = 0; i < record.length; i++)
+    {
+      if (!decoder.push(record.data[i]) || (decoder.command() != SDS011_REPLY_DATA))
+      {
+        continue;
+      }
+      const ReplyType &frame = decoder.frame();
+      uint16_t pm25 = frame[2] | (frame[3] << 8);
+      uint16_t pm10 = frame[4] | (frame[5] << 8);
+      dataFrames++;
+      pm25Sum += pm25;
+      if (csv)
+      {
+        printf("%u,%04X,%u.%u,%u.%u\n", record.timestamp, decoder.deviceId(),
+               pm25 / 10, pm25 % 10, pm10 / 10, pm10 % 10);
+      }
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  FILE *report = csv ? stderr : stdout;
+  fprintf(report, "capture:         %zu bytes%s\n", data.size(), reader.truncated() ? " (truncated)" : "");
+  fprintf(report, "tx / rx bytes:   %llu / %llu\n", (unsigned long long)txBytes, (unsigned long long)rxBytes);
+  fprintf(report, "frames:          %u (%llu data)\n", decoder.frames(), (unsigned long long)dataFrames);
+  fprintf(report, "checksum errors: %u\n", decoder.checksumErrors());
+  fprintf(report, "skipped bytes:   %u\n", decoder.skippedBytes());
+  fprintf(report, "mean PM2.5:      %.1f\n", dataFrames ? pm25Sum / 10.0 / dataFrames : 0.0);
+  fprintf(report, "decode:          %.3f s, %.0f MB/s\n", seconds, seconds > 0 ? data.size() / seconds / 1e6 : 0.0);
+  return 0;
+}
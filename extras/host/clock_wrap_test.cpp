@@ -0,0 +1,209 @@
+/**
+ * @file clock_wrap_test.cpp
+ * @brief Virtual time checks of driver timing across millis() wraparound.
+ *
+ * SDS011Clock::setSource() starts virtual clock just before 2^32 ms.
+ * Checks SDS011Deadline, SDS011Stopwatch and SDS011Clock::reached() on
+ * manually stepped clock, then runs driver against SDS011SoftSensor while
+ * clock wraps: queryData() must never report call_to_often after 3 s pause
+ * and reply timeout must still take wait_write_read. Exits 1 on failure.
+ *
+ * Build: g++ -O2 -std=c++11 -DARDUINO=10800 -Iarduino -I../../src -o clock_wrap_test clock_wrap_test.cpp SDS011SoftSensor.cpp
+ *        arduino/Arduino.cpp ../../src/NovaSDS011.cpp ../../src/SDS011Clock.cpp ../../src/SDS011DeviceCache.cpp
+ *        ../../src/SDS011Frame.cpp
+ */
+
+#include <stdio.h>
+
+#include "NovaSDS011.h"
+#include "SDS011SoftSensor.h"
+
+#define WAIT_WRITE_READ 500
+#define QUERY_PAUSE 3000
+
+static int failures = 0;
+
+static void check(bool ok, const char *name, uint32_t value)
+{
+  printf("%-44s %-4s (%u)\n", name, ok ? "ok" : "FAIL", value);
+  if (!ok)
+  {
+    failures++;
+  }
+}
+
+// --------------------------------------------------------
+// Manually stepped clock
+// --------------------------------------------------------
+static uint32_t steppedMillis = 0;
+static uint32_t steppedMicros = 0;
+
+static uint32_t stepMillis()
+{
+  return steppedMillis;
+}
+
+static uint32_t stepMicros()
+{
+  return steppedMicros;
+}
+
+// --------------------------------------------------------
+// Real time shifted close to wrap, pauses skip time instantly
+// --------------------------------------------------------
+static uint32_t offset = 0;
+static uint32_t realStart = 0;
+
+static uint32_t shiftedMillis()
+{
+  return offset + (uint32_t)(millis() - realStart);
+}
+
+static uint32_t shiftedMicros()
+{
+  return offset * 1000 + (uint32_t)(micros() - realStart * 1000);
+}
+
+// --------------------------------------------------------
+// In memory serial link to software sensor
+// --------------------------------------------------------
+class SoftLink : public Stream
+{
+public:
+  explicit SoftLink(SDS011SoftSensor &sensor) : _sensor(sensor), _pos(0), _size(0) {}
+
+  size_t write(uint8_t byte) override
+  {
+    _sensor.receive(byte, SDS011Clock::millis());
+    return 1;
+  }
+
+  int available() override
+  {
+    pull();
+    return _size - _pos;
+  }
+
+  int read() override
+  {
+    pull();
+    return (_pos < _size) ? _buffer[_pos++] : -1;
+  }
+
+  int peek() override
+  {
+    pull();
+    return (_pos < _size) ? _buffer[_pos] : -1;
+  }
+
+private:
+  void pull()
+  {
+    if (_pos < _size)
+    {
+      return;
+    }
+    uint32_t now = SDS011Clock::millis();
+    _sensor.update(now);
+    _pos = 0;
+    _size = _sensor.transmit(_buffer, sizeof(_buffer), now);
+  }
+
+  SDS011SoftSensor &_sensor;
+  uint8_t _buffer[64];
+  size_t _pos;
+  size_t _size;
+};
+
+static void checkPrimitives()
+{
+  SDS011Clock::setSource(stepMillis, stepMicros);
+
+  // Deadline starts 256 ms before wrap and ends 744 ms after it
+  steppedMillis = 0xFFFFFF00;
+  SDS011Deadline deadline(1000);
+  steppedMillis += 100;
+  check(!deadline.expired(), "deadline: not expired before wrap", deadline.elapsed());
+  steppedMillis += 899;
+  check(!deadline.expired(), "deadline: not expired 1 ms before end", deadline.elapsed());
+  check(deadline.remaining() == 1, "deadline: remaining across wrap", deadline.remaining());
+  steppedMillis += 1;
+  check(deadline.expired(), "deadline: expired after wrap", steppedMillis);
+  check(deadline.remaining() == 0, "deadline: nothing remaining", deadline.remaining());
+
+  check(SDS011Clock::reached(0x00000010, 0xFFFFFFF0), "reached: time before wrap", 0x20);
+  check(!SDS011Clock::reached(0xFFFFFFF0, 0x00000010), "reached: time after wrap", 0x20);
+
+  steppedMicros = 0xFFFFFFF0;
+  SDS011Stopwatch stopwatch;
+  steppedMicros += 100;
+  check(stopwatch.elapsedMicros() == 100, "stopwatch: elapsed across wrap", stopwatch.elapsedMicros());
+
+  SDS011Deadline idle;
+  check(idle.expired(), "deadline: default constructed is expired", idle.elapsed());
+}
+
+static void checkDriver()
+{
+  SDS011SoftSensor sensor(0x1234);
+  SoftLink link(sensor);
+  NovaSDS011 sds;
+
+  realStart = millis();
+  offset = 0xFFFFFFFF - 4 * QUERY_PAUSE;
+  SDS011Clock::setSource(shiftedMillis, shiftedMicros);
+
+  sds.begin(link, WAIT_WRITE_READ);
+  check(sds.setDataReportingMode(DataReportingMode::query, 0x1234), "driver: query reporting mode", 0);
+
+  // Queries every 3 s from 12 s before wrap to 12 s after it
+  uint32_t often = 0;
+  uint32_t failed = 0;
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    uint16_t pm25;
+    uint16_t pm10;
+    QuerryError error = sds.queryData(pm25, pm10, 0x1234);
+    if (error == QuerryError::call_to_often)
+    {
+      often++;
+    }
+    else if (error == QuerryError::response_error)
+    {
+      failed++;
+    }
+    offset += QUERY_PAUSE;
+  }
+  check(SDS011Clock::millis() < 4 * QUERY_PAUSE + 1000, "driver: clock wrapped", SDS011Clock::millis());
+  check(often == 0, "driver: no call_to_often across wrap", often);
+  check(failed == 0, "driver: all queries answered", failed);
+
+  // Sensor stops answering, timeout spans wrap
+  offset = 0xFFFFFFFF - WAIT_WRITE_READ / 2 - (uint32_t)(millis() - realStart);
+  sensor.setFaults(100, 0, 0);
+  uint16_t pm25;
+  uint16_t pm10;
+  uint32_t start = SDS011Clock::millis();
+  QuerryError error = sds.queryData(pm25, pm10, 0x1234);
+  uint32_t took = SDS011Clock::millis() - start;
+  check(error == QuerryError::response_error, "driver: timeout reported", error);
+  check((took >= WAIT_WRITE_READ) && (took < WAIT_WRITE_READ + 100), "driver: timeout takes wait_write_read", took);
+  check(SDS011Clock::millis() < start, "driver: timeout crossed wrap", SDS011Clock::millis());
+
+  // Pause across wrap does not block next query
+  offset += QUERY_PAUSE;
+  sensor.setFaults(0, 0, 0);
+  error = sds.queryData(pm25, pm10, 0x1234);
+  check(error != QuerryError::call_to_often, "driver: query after timeout allowed", error);
+  check(error != QuerryError::response_error, "driver: query after timeout answered", error);
+
+  SDS011Clock::setSource(NULL);
+}
+
+int main()
+{
+  checkPrimitives();
+  checkDriver();
+  printf("%d failed\n", failures);
+  return (failures == 0) ? 0 : 1;
+}
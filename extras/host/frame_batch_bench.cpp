@@ -0,0 +1,164 @@
+/**
+ * @file frame_batch_bench.cpp
+ * @brief Speed of SDS011FrameBatch against per-frame template compare.
+ *
+ * Build: g++ -O2 -std=c++11 -march=native -o frame_batch_bench frame_batch_bench.cpp SDS011FrameBatch.cpp
+ *        (without -march=native SSE2 is used on x86-64)
+ * Usage: frame_batch_bench [frames] [rounds]
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "../../src/SDS011Frame.h"
+#include "SDS011FrameBatch.h"
+
+// Data frames from many devices, about 1 % damaged
+static std::vector<uint8_t> generate(size_t count, uint32_t seed)
+{
+  std::vector<uint8_t> frames(count * sizeof(ReplyType));
+  uint32_t state = seed;
+
+  for (size_t i = 0; i < count; i++)
+  {
+    state = state * 1103515245 + 12345;
+    uint32_t random = state >> 8;
+
+    uint8_t *frame = &frames[i * sizeof(ReplyType)];
+    uint16_t pm25 = random % 2000;
+    uint16_t pm10 = pm25 + (random >> 11) % 1000;
+    uint16_t id = (uint16_t)(random >> 3);
+    frame[0] = SDS011_HEAD;
+    frame[1] = SDS011_REPLY_DATA;
+    frame[2] = pm25 & 0xFF;
+    frame[3] = pm25 >> 8;
+    frame[4] = pm10 & 0xFF;
+    frame[5] = pm10 >> 8;
+    frame[6] = id & 0xFF;
+    frame[7] = id >> 8;
+    uint8_t sum = 0;
+    for (uint8_t j = 2; j < 8; j++)
+    {
+      sum += frame[j];
+    }
+    frame[8] = sum;
+    frame[9] = SDS011_TAIL;
+
+    if ((random % 100) == 0)
+    {
+      frame[random % sizeof(ReplyType)] ^= 1 << ((random >> 4) % 8);
+    }
+  }
+  return frames;
+}
+
+// Per-frame template compare: fill reply template, compute checksum, compare all bytes
+static size_t validateTemplate(const uint8_t *frames, size_t count, const SDS011FrameColumns &columns)
+{
+  size_t valid = 0;
+  ReplyType expected = {SDS011_HEAD, SDS011_REPLY_DATA, 0, 0, 0, 0, 0, 0, 0, SDS011_TAIL};
+
+  for (size_t i = 0; i < count; i++)
+  {
+    const uint8_t *reply = frames + i * sizeof(ReplyType);
+    uint16_t checksum = 0;
+    for (int j = 2; j <= 7; j++)
+    {
+      expected[j] = reply[j];
+      checksum += reply[j];
+    }
+    expected[8] = checksum % 256;
+
+    bool ok = true;
+    for (size_t j = 0; j < sizeof(ReplyType); j++)
+    {
+      if (expected[j] != reply[j])
+      {
+        ok = false;
+        break;
+      }
+    }
+    columns.pm25[i] = reply[2] | (reply[3] << 8);
+    columns.pm10[i] = reply[4] | (reply[5] << 8);
+    columns.deviceId[i] = reply[6] | (reply[7] << 8);
+    columns.valid[i] = ok;
+    valid += ok;
+  }
+  return valid;
+}
+
+struct Columns
+{
+  Columns(size_t count) : pm25(count), pm10(count), deviceId(count), valid(count) {}
+
+  SDS011FrameColumns view() { return {pm25.data(), pm10.data(), deviceId.data(), valid.data()}; }
+
+  bool operator==(const Columns &other) const
+  {
+    for (size_t i = 0; i < valid.size(); i++)
+    {
+      if ((valid[i] != other.valid[i]) ||
+          (valid[i] && ((pm25[i] != other.pm25[i]) || (pm10[i] != other.pm10[i]) ||
+                        (deviceId[i] != other.deviceId[i]))))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::vector<uint16_t> pm25;
+  std::vector<uint16_t> pm10;
+  std::vector<uint16_t> deviceId;
+  std::vector<uint8_t> valid;
+};
+
+typedef size_t (*Validator)(const uint8_t *, size_t, const SDS011FrameColumns &);
+
+static double measure(Validator validator, const std::vector<uint8_t> &frames, size_t count, size_t rounds,
+                      Columns &columns, size_t &valid)
+{
+  SDS011FrameColumns view = columns.view();
+  auto start = std::chrono::steady_clock::now();
+  for (size_t round = 0; round < rounds; round++)
+  {
+    valid = validator(frames.data(), count, view);
+  }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / rounds;
+}
+
+int main(int argc, char **argv)
+{
+  size_t count = (argc > 1) ? strtoul(argv[1], NULL, 10) : 1000000;
+  size_t rounds = (argc > 2) ? strtoul(argv[2], NULL, 10) : 50;
+
+  std::vector<uint8_t> frames = generate(count, 1);
+  Columns reference(count);
+  Columns scalar(count);
+  Columns batch(count);
+  size_t validReference;
+  size_t validScalar;
+  size_t validBatch;
+
+  double timeReference = measure(validateTemplate, frames, count, rounds, reference, validReference);
+  double timeScalar = measure(SDS011FrameBatch::validateScalar, frames, count, rounds, scalar, validScalar);
+  double timeBatch = measure(SDS011FrameBatch::validate, frames, count, rounds, batch, validBatch);
+
+  if ((validScalar != validReference) || (validBatch != validReference) ||
+      !(scalar == reference) || !(batch == reference))
+  {
+    printf("MISMATCH: valid %zu / %zu / %zu\n", validReference, validScalar, validBatch);
+    return 1;
+  }
+
+  double megabytes = frames.size() / 1e6;
+  printf("frames:         %zu (%zu valid)\n", count, validReference);
+  printf("per frame:      %6.2f ns/frame %7.0f MB/s\n", timeReference * 1e9 / count, megabytes / timeReference);
+  printf("batch scalar:   %6.2f ns/frame %7.0f MB/s\n", timeScalar * 1e9 / count, megabytes / timeScalar);
+  printf("batch %-6s    %6.2f ns/frame %7.0f MB/s (%.1fx)\n", SDS011FrameBatch::implementation(),
+         timeBatch * 1e9 / count, megabytes / timeBatch, timeReference / timeBatch);
+  return 0;
+}
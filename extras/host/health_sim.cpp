@@ -0,0 +1,125 @@
+/**
+ * @file health_sim.cpp
+ * @brief Virtual time simulation of SDS011HealthMonitor against failing sensor.
+ *
+ * SDS011SoftSensor on SDS011SoftBus is queried every 3 s. After first hour
+ * it stops answering for 15 min, then comes back asleep (like after power
+ * loss with sleep set by other host). Same run is done with plain
+ * queryData() and with queries through monitor; prints readings, timeouts,
+ * recovery attempts and outage length. Exits 1 if monitor did not wake
+ * sensor or did not save at least 90% of timeouts.
+ *
+ * Build: g++ -O2 -std=c++11 -DARDUINO=10800 -Iarduino -I../../src -o health_sim health_sim.cpp SDS011SoftBus.cpp
+ *        SDS011SoftSensor.cpp arduino/Arduino.cpp ../../src/NovaSDS011.cpp ../../src/SDS011Clock.cpp
+ *        ../../src/SDS011DeviceCache.cpp ../../src/SDS011Frame.cpp ../../src/SDS011HealthMonitor.cpp
+ * Usage: health_sim [hours] [outage minutes]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SDS011HealthMonitor.h"
+#include "SDS011SoftBus.h"
+
+#define DEVICE_ID 0x1A2B
+#define WAIT_WRITE_READ 500
+#define QUERY_INTERVAL 3000
+#define OUTAGE_START 3600000UL
+
+struct RunStats
+{
+  uint32_t readings;
+  uint32_t throttled; // call_to_often, must stay 0
+  uint32_t timeouts;  // transactions without reply
+  uint32_t attempts;
+  uint32_t outage;
+  bool working;       // sensor works and answers at the end
+};
+
+static RunStats run(bool monitored, uint32_t duration, uint32_t outage)
+{
+  SDS011SoftBus::start();
+  SDS011SoftBus bus;
+  SDS011SoftSensor sensor(DEVICE_ID);
+  bus.attach(&sensor);
+
+  NovaSDS011 sds;
+  SDS011HealthMonitor monitor(sds);
+  sds.begin(bus, WAIT_WRITE_READ);
+  sds.setDataReportingMode(DataReportingMode::query, DEVICE_ID);
+  monitor.begin();
+  monitor.addDevice(DEVICE_ID);
+
+  RunStats stats = {0, 0, 0, 0, 0, false};
+  bool dead = false;
+  bool back = false;
+  uint32_t next = SDS011SoftBus::millis();
+  while (SDS011SoftBus::millis() < duration)
+  {
+    uint32_t now = SDS011SoftBus::millis();
+    if (!dead && (now >= OUTAGE_START))
+    {
+      sensor.setFaults(100, 0, 0);
+      dead = true;
+    }
+    if (!back && (now >= OUTAGE_START + outage))
+    {
+      // Sensor answers again but is asleep, sleep is set by other host
+      sensor.setFaults(0, 0, 0);
+      sds.setWorkingMode(WorkingMode::mode_sleep, DEVICE_ID);
+      back = true;
+    }
+
+    if (monitored)
+    {
+      monitor.update();
+    }
+    if (SDS011Clock::reached(SDS011SoftBus::millis(), next))
+    {
+      next = SDS011SoftBus::millis() + QUERY_INTERVAL;
+      uint16_t pm25;
+      uint16_t pm10;
+      QuerryError error = monitored ? monitor.queryData(pm25, pm10, DEVICE_ID) : sds.queryData(pm25, pm10, DEVICE_ID);
+      stats.readings += (error == QuerryError::no_error) ? 1 : 0;
+      stats.throttled += (error == QuerryError::call_to_often) ? 1 : 0;
+    }
+    bus.advance(10);
+  }
+
+  // Replies dropped while dead and commands ignored while asleep each cost one timeout
+  stats.timeouts = sensor.stats().dropped + sensor.stats().ignored;
+  stats.attempts = monitor.stats(DEVICE_ID).recoveryAttempts;
+  stats.outage = monitor.stats(DEVICE_ID).lastOutage;
+  uint16_t pm25;
+  uint16_t pm10;
+  bus.advance(QUERY_INTERVAL);
+  stats.working = (sds.queryData(pm25, pm10, DEVICE_ID) == QuerryError::no_error);
+  SDS011SoftBus::stop();
+
+  printf("%-8s readings %5u, timeouts %5u, recovery attempts %3u, outage %4u s, working at end: %s\n",
+         monitored ? "monitor" : "plain", stats.readings, stats.timeouts, stats.attempts, stats.outage / 1000,
+         stats.working ? "yes" : "no");
+  return stats;
+}
+
+int main(int argc, char **argv)
+{
+  double hours = (argc > 1) ? atof(argv[1]) : 3;
+  uint32_t minutes = (argc > 2) ? strtoul(argv[2], NULL, 10) : 15;
+  uint32_t duration = (uint32_t)(hours * 3600000);
+  if (duration <= OUTAGE_START + minutes * 60000UL)
+  {
+    fprintf(stderr, "Usage: health_sim [hours (more than 1 h + outage)] [outage minutes]\n");
+    return 2;
+  }
+
+  printf("%.1f h, query every %u ms, sensor silent for %u min after 1 h, then asleep\n", hours, QUERY_INTERVAL,
+         minutes);
+  RunStats plain = run(false, duration, minutes * 60000UL);
+  RunStats monitored = run(true, duration, minutes * 60000UL);
+
+  bool ok = monitored.working && (monitored.timeouts * 10 < plain.timeouts) && (plain.throttled == 0) &&
+            (monitored.throttled == 0);
+  printf("%s\n", ok ? "ok" : "FAIL");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+/**
+ * @file payload_bench.cpp
+ * @brief Speed and heap use of SDS011PayloadEncoder against String concatenation.
+ *
+ * String path is modelled with std::string the way sketches build payloads with
+ * Arduino String: temporary per piece, float formatted like String(pm25 / 10.0).
+ *
+ * Build: g++ -O2 -std=c++11 -o payload_bench payload_bench.cpp ../../src/SDS011Payload.cpp
+ * Usage: payload_bench [samples per payload] [payloads]
+ */
+
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "../../src/SDS011Payload.h"
+
+static size_t allocations = 0;
+
+void *operator new(size_t size)
+{
+  allocations++;
+  void *memory = malloc(size ? size : 1);
+  if (memory == NULL)
+  {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+void operator delete(void *memory) noexcept
+{
+  free(memory);
+}
+
+// Used instead of unsized one from C++14
+void operator delete(void *memory, size_t) noexcept
+{
+  free(memory);
+}
+
+struct Sample
+{
+  uint16_t deviceId;
+  uint16_t pm25;
+  uint16_t pm10;
+  uint32_t timestamp;
+};
+
+static std::vector<Sample> generate(size_t count, uint32_t seed)
+{
+  std::vector<Sample> samples(count);
+  uint32_t state = seed;
+
+  for (size_t i = 0; i < count; i++)
+  {
+    state = state * 1103515245 + 12345;
+    uint32_t random = state >> 8;
+    samples[i].deviceId = 0x1A00 + (random & 0x03);
+    samples[i].pm25 = random % 2000;
+    samples[i].pm10 = samples[i].pm25 + (random >> 11) % 1000;
+    samples[i].timestamp = 1700000000 + i * 3;
+  }
+  return samples;
+}
+
+// Stand-in for Arduino String(float), which prints two decimals via dtostrf
+static std::string floatString(float value)
+{
+  char text[16];
+  snprintf(text, sizeof(text), "%.2f", value);
+  return std::string(text);
+}
+
+static std::string hexString(uint16_t value)
+{
+  char text[8];
+  snprintf(text, sizeof(text), "%X", value);
+  return std::string(text);
+}
+
+static std::string stringPayload(const Sample *samples, size_t count)
+{
+  std::string payload;
+  for (size_t i = 0; i < count; i++)
+  {
+    payload += std::string("sds011,device=") + hexString(samples[i].deviceId) + " pm25=" +
+               floatString(samples[i].pm25 / 10.0) + ",pm10=" + floatString(samples[i].pm10 / 10.0) + " " +
+               std::to_string(samples[i].timestamp) + "\n";
+  }
+  return payload;
+}
+
+int main(int argc, char **argv)
+{
+  size_t batchSize = (argc > 1) ? strtoul(argv[1], NULL, 10) : 8;
+  size_t payloads = (argc > 2) ? strtoul(argv[2], NULL, 10) : 200000;
+
+  std::vector<Sample> samples = generate(batchSize * payloads, 1);
+  std::vector<char> buffer(batchSize * 64 + 1);
+  size_t encoderBytes = 0;
+  size_t stringBytes = 0;
+  double encoderSeconds = 0;
+  double stringSeconds = 0;
+  size_t stringAllocations = 0;
+  size_t encoderAllocations = 0;
+
+  for (size_t p = 0; p < payloads; p++)
+  {
+    const Sample *batch = &samples[p * batchSize];
+
+    size_t before = allocations;
+    auto start = std::chrono::steady_clock::now();
+    SDS011PayloadEncoder encoder(buffer.data(), buffer.size());
+    for (size_t i = 0; i < batchSize; i++)
+    {
+      if (!encoder.addReading(batch[i].deviceId, batch[i].pm25, batch[i].pm10, batch[i].timestamp))
+      {
+        fprintf(stderr, "Payload %zu does not fit into buffer\n", p);
+        return 1;
+      }
+    }
+    encoder.finish();
+    auto encoded = std::chrono::steady_clock::now();
+    encoderAllocations += allocations - before;
+
+    before = allocations;
+    std::string payload = stringPayload(batch, batchSize);
+    auto concatenated = std::chrono::steady_clock::now();
+    stringAllocations += allocations - before;
+
+    encoderBytes += encoder.length();
+    stringBytes += payload.size();
+    encoderSeconds += std::chrono::duration<double>(encoded - start).count();
+    stringSeconds += std::chrono::duration<double>(concatenated - encoded).count();
+  }
+
+  size_t total = batchSize * payloads;
+  printf("Samples:          %zu in %zu payloads\n", total, payloads);
+  printf("Encoder:          %.1f ns/sample, %.1f bytes/sample, %.2f allocations/payload\n",
+         encoderSeconds * 1e9 / total, (double)encoderBytes / total, (double)encoderAllocations / payloads);
+  printf("String:           %.1f ns/sample, %.1f bytes/sample, %.2f allocations/payload\n",
+         stringSeconds * 1e9 / total, (double)stringBytes / total, (double)stringAllocations / payloads);
+  printf("Speedup:          %.1fx\n", stringSeconds / encoderSeconds);
+  return 0;
+}
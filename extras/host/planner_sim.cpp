@@ -0,0 +1,249 @@
+/**
+ * @file planner_sim.cpp
+ * @brief Virtual time simulation of SDS011QueryPlanner against refreshing sensor.
+ *
+ * Sensor model refreshes its value once per refresh period at fixed phase of
+ * its own clock (slightly off nominal period) and answers queries with value
+ * valid when query was received. Board clock starts before 2^32 ms so millis()
+ * wraps in the middle of run. Same run is done with planner and with plain
+ * queries every interval; mean age of readings is printed for time before
+ * wrap, first two minutes after it and the rest. Exits 1 if planner readings
+ * are not at least four times fresher than plain ones in every part, so phase
+ * lost on wrap shows as failure.
+ *
+ * Build: g++ -O2 -std=c++11 -DARDUINO=10800 -Iarduino -I../../src -o planner_sim planner_sim.cpp arduino/Arduino.cpp
+ *        ../../src/NovaSDS011.cpp ../../src/SDS011Clock.cpp ../../src/SDS011DeviceCache.cpp ../../src/SDS011Frame.cpp
+ *        ../../src/SDS011QueryPlanner.cpp
+ * Usage: planner_sim [hours] [refresh period ms] [sensor clock error ppm]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <deque>
+
+#include "SDS011QueryPlanner.h"
+
+#define DEVICE_ID 0x1234
+#define WAIT_WRITE_READ 500
+#define READ_INTERVAL 3000
+// Query frame takes about 20 ms at 9600 baud, reply starts after it
+#define QUERY_TIME 20
+#define REPLY_DELAY 30
+#define REFRESH_PHASE 437
+// Readings right after wrap
+#define RECOVERY_TIME 120000UL
+
+// --------------------------------------------------------
+// Virtual board clock, 32 bit like millis()
+// --------------------------------------------------------
+static uint64_t simTime = 0;
+static uint32_t boardStart = 0;
+
+static uint32_t simMillis()
+{
+  return boardStart + (uint32_t)simTime;
+}
+
+static uint32_t simMicros()
+{
+  return (boardStart + (uint32_t)simTime) * 1000;
+}
+
+// --------------------------------------------------------
+// Sensor refreshing value once per period of its own clock
+// --------------------------------------------------------
+class RefreshingSensor : public Stream
+{
+public:
+  RefreshingSensor(double period, double phase) : _period(period), _phase(phase), _pos(0), _lastReceived(0) {}
+
+  size_t write(uint8_t byte) override
+  {
+    _command[_pos++] = byte;
+    if (_pos < sizeof(_command))
+    {
+      return 1;
+    }
+    _pos = 0;
+
+    uint8_t reply[10] = {SDS011_HEAD, SDS011_REPLY_COMMAND, _command[2], _command[3], _command[4], 0,
+                         DEVICE_ID & 0xFF, DEVICE_ID >> 8, 0, SDS011_TAIL};
+    uint32_t delay = 0;
+    if (_command[2] == SDS011_QUERY_DATA)
+    {
+      // Value is the one valid when whole query arrived
+      _lastReceived = (double)simTime + QUERY_TIME;
+      uint16_t value = 100 + refreshIndex(_lastReceived) % 500;
+      reply[1] = SDS011_REPLY_DATA;
+      reply[2] = value & 0xFF;
+      reply[3] = value >> 8;
+      reply[4] = (value + 1) & 0xFF;
+      reply[5] = (value + 1) >> 8;
+      delay = QUERY_TIME + REPLY_DELAY;
+    }
+    // Other commands are answered at once, blocking driver calls do not move virtual time
+    uint8_t sum = 0;
+    for (uint8_t i = 2; i < 8; i++)
+    {
+      sum += reply[i];
+    }
+    reply[8] = sum;
+    for (uint8_t i = 0; i < sizeof(reply); i++)
+    {
+      _output.push_back(reply[i]);
+      _outputTime.push_back(simTime + delay + (delay ? i : 0));
+    }
+    return 1;
+  }
+
+  int available() override
+  {
+    int count = 0;
+    while ((count < (int)_outputTime.size()) && (_outputTime[count] <= simTime))
+    {
+      count++;
+    }
+    return count;
+  }
+
+  int read() override
+  {
+    if (available() == 0)
+    {
+      return -1;
+    }
+    uint8_t byte = _output.front();
+    _output.pop_front();
+    _outputTime.pop_front();
+    return byte;
+  }
+
+  int peek() override
+  {
+    return (available() > 0) ? _output.front() : -1;
+  }
+
+  // Age of value in last answered query
+  double lastAge() const
+  {
+    return _lastReceived - (refreshIndex(_lastReceived) * _period + _phase);
+  }
+
+private:
+  int64_t refreshIndex(double time) const
+  {
+    return (int64_t)((time - _phase + _period * 1000) / _period) - 1000;
+  }
+
+  double _period;
+  double _phase;
+  uint8_t _command[19];
+  uint8_t _pos;
+  double _lastReceived;
+  std::deque<uint8_t> _output;
+  std::deque<uint64_t> _outputTime;
+};
+
+// --------------------------------------------------------
+// Mean reading age before wrap, just after it and later
+// --------------------------------------------------------
+struct AgeStats
+{
+  uint64_t wrapAt;
+  double sum[3];
+  uint32_t count[3];
+};
+
+static RefreshingSensor *sensor = NULL;
+static AgeStats *ages = NULL;
+
+static void onSample(void *, uint16_t, uint16_t, uint16_t, uint32_t)
+{
+  uint8_t part = (simTime < ages->wrapAt) ? 0 : ((simTime < ages->wrapAt + RECOVERY_TIME) ? 1 : 2);
+  ages->sum[part] += sensor->lastAge();
+  ages->count[part]++;
+}
+
+static double mean(const AgeStats &stats, uint8_t part)
+{
+  return stats.count[part] ? (stats.sum[part] / stats.count[part]) : 0;
+}
+
+static AgeStats run(bool planned, uint64_t duration, double period, uint16_t nominal)
+{
+  RefreshingSensor model(period, REFRESH_PHASE);
+  NovaSDS011 sds;
+  SDS011QueryPlanner planner(sds);
+  AgeStats stats = {duration - duration / 2, {0, 0, 0}, {0, 0}};
+  sensor = &model;
+  ages = &stats;
+
+  simTime = 0;
+  boardStart = (uint32_t)(0x100000000ULL - stats.wrapAt);
+  sds.begin(model, WAIT_WRITE_READ);
+  if (planned)
+  {
+    planner.addDevice(DEVICE_ID, READ_INTERVAL, nominal);
+    planner.onSample(onSample);
+    planner.begin();
+  }
+  else
+  {
+    sds.setDataReportingMode(DataReportingMode::query, DEVICE_ID);
+    sds.onSample(onSample);
+  }
+
+  uint64_t next = 0;
+  for (; simTime < duration; simTime++)
+  {
+    if (planned)
+    {
+      planner.update();
+      continue;
+    }
+    sds.service();
+    if ((simTime >= next) && sds.requestData(DEVICE_ID))
+    {
+      next = simTime + READ_INTERVAL;
+    }
+  }
+
+  printf("%-8s before wrap %6.1f ms (%u), after wrap %6.1f ms (%u), later %6.1f ms (%u)", planned ? "planner" : "plain",
+         mean(stats, 0), stats.count[0], mean(stats, 1), stats.count[1], mean(stats, 2), stats.count[2]);
+  if (planned)
+  {
+    SDS011PlannerStats planStats = planner.stats(DEVICE_ID);
+    printf(", probes %u, errors %u, drift %d/256 ms", planStats.probes, planStats.errors, planStats.drift);
+  }
+  printf("\n");
+  return stats;
+}
+
+int main(int argc, char **argv)
+{
+  double hours = (argc > 1) ? atof(argv[1]) : 6;
+  uint16_t nominal = (argc > 2) ? strtoul(argv[2], NULL, 10) : 1000;
+  double ppm = (argc > 3) ? atof(argv[3]) : 100;
+  if ((hours <= 0) || (nominal < 250))
+  {
+    fprintf(stderr, "Usage: planner_sim [hours] [refresh period ms (250+)] [sensor clock error ppm]\n");
+    return 2;
+  }
+
+  uint64_t duration = (uint64_t)(hours * 3600000);
+  double period = nominal * (1 + ppm / 1e6);
+  SDS011Clock::setSource(simMillis, simMicros);
+  printf("%.1f h, refresh period %.4f ms, query every %u ms, millis() wraps after %.1f h\n", hours, period,
+         READ_INTERVAL, hours / 2);
+
+  AgeStats plain = run(false, duration, period, nominal);
+  AgeStats planned = run(true, duration, period, nominal);
+
+  bool ok = true;
+  for (uint8_t part = 0; part < 3; part++)
+  {
+    ok = ok && (mean(planned, part) * 4 < mean(plain, part));
+  }
+  printf("%s\n", ok ? "ok" : "FAIL");
+  return ok ? 0 : 1;
+}
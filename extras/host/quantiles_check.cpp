@@ -0,0 +1,86 @@
+/**
+ * @file quantiles_check.cpp
+ * @brief Checks of SDS011QuantileSketch near counter limits.
+ *
+ * Merge of two full sketches, periodic input after counters were rescaled
+ * and sketch with very large scale. Exits with 1 if any check fails.
+ *
+ * Build: g++ -O2 -std=c++11 -o quantiles_check quantiles_check.cpp ../../src/SDS011Quantiles.cpp
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../../src/SDS011Quantiles.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char *name, uint32_t value)
+{
+  printf("%-40s %-4s (%u)\n", name, ok ? "ok" : "FAIL", value);
+  if (!ok)
+  {
+    failures++;
+  }
+}
+
+// Relative error of sketch is at most 1/16
+static bool near(uint32_t value, uint32_t expected)
+{
+  uint32_t error = (value > expected) ? (value - expected) : (expected - value);
+  return error * 16 <= expected;
+}
+
+static void fill(SDS011QuantileSketch &sketch)
+{
+  for (uint32_t i = 0; i < 65535; i++)
+  {
+    sketch.add(100);
+  }
+  sketch.add(5000);
+}
+
+int main()
+{
+  // Both sketches have full bucket, sum needs more than one halving
+  SDS011QuantileSketch a;
+  SDS011QuantileSketch b;
+  fill(a);
+  fill(b);
+  a.merge(b);
+  check(near(a.quantile(100), 100), "merge full: q10", a.quantile(100));
+  check(near(a.quantile(500), 100), "merge full: q50", a.quantile(500));
+  check(near(a.quantile(990), 100), "merge full: q99", a.quantile(990));
+  check(a.maximum() == 5000, "merge full: max", a.maximum());
+  check(near(a.count(), 131072), "merge full: count", a.count());
+
+  // Alternating input must not alias with choice of counted samples
+  SDS011QuantileSketch alternating;
+  for (uint32_t i = 0; i < 300000; i++)
+  {
+    alternating.add((i & 1) ? 1000 : 10);
+  }
+  check(near(alternating.quantile(250), 10), "alternating: q25", alternating.quantile(250));
+  check(near(alternating.quantile(750), 1000), "alternating: q75", alternating.quantile(750));
+  check(near(alternating.count(), 300000), "alternating: count", alternating.count());
+
+  // Sample weight 2^20, new samples must not count at full weight
+  SDS011QuantileSketch scaled;
+  for (uint32_t i = 0; i < 1000; i++)
+  {
+    scaled.add(100);
+  }
+  uint8_t buffer[SDS011QuantileSketch::MAX_SERIALIZED_SIZE];
+  size_t size = scaled.serialize(buffer, sizeof(buffer));
+  buffer[1] = 20;
+  scaled.deserialize(buffer, size);
+  for (uint32_t i = 0; i < 100000; i++)
+  {
+    scaled.add(5000);
+  }
+  check(near(scaled.quantile(500), 100), "large scale: q50", scaled.quantile(500));
+  check(scaled.maximum() == 5000, "large scale: max", scaled.maximum());
+
+  printf("%d failed\n", failures);
+  return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file resync_check.cpp
+ * @brief Checks that blocking commands find their reply behind unrelated bytes.
+ *
+ * SDS011SoftBus sends line noise, corrupted copy of expected reply, active
+ * mode frame of other device and reply to other command just before reply
+ * of SDS011SoftSensor. Query, reporting mode, working mode and version
+ * calls must still succeed with values of the right device. Exits 1 on
+ * failure.
+ *
+ * Build: g++ -O2 -std=c++11 -DARDUINO=10800 -Iarduino -I../../src -o resync_check resync_check.cpp SDS011SoftBus.cpp
+ *        SDS011SoftSensor.cpp arduino/Arduino.cpp ../../src/NovaSDS011.cpp ../../src/SDS011Clock.cpp
+ *        ../../src/SDS011DeviceCache.cpp ../../src/SDS011Frame.cpp
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "NovaSDS011.h"
+#include "SDS011SoftBus.h"
+
+#define DEVICE_ID 0x1001
+#define OTHER_ID 0x2002
+#define OTHER_PM25 4321
+#define WAIT_WRITE_READ 200
+
+static int failures = 0;
+
+static void check(bool ok, const char *name, uint32_t value)
+{
+  printf("%-44s %-4s (%u)\n", name, ok ? "ok" : "FAIL", value);
+  if (!ok)
+  {
+    failures++;
+  }
+}
+
+static void frame(uint8_t *out, uint8_t command, uint8_t data0, uint8_t data1, uint8_t data2, uint16_t id)
+{
+  uint8_t bytes[10] = {SDS011_HEAD, command, data0, data1, data2, 0, (uint8_t)(id & 0xFF), (uint8_t)(id >> 8), 0,
+                       SDS011_TAIL};
+  for (uint8_t i = 2; i < 8; i++)
+  {
+    bytes[8] += bytes[i];
+  }
+  memcpy(out, bytes, sizeof(bytes));
+}
+
+// Junk in front of reply with given command and sub-command
+static void injectJunk(SDS011SoftBus &bus, uint8_t command, uint8_t sub)
+{
+  uint8_t junk[4 + 3 * 10] = {0x13, SDS011_HEAD, 0xAA, 0x5A};
+  uint8_t *next = junk + 4;
+
+  // Expected reply with wrong checksum
+  frame(next, command, sub, 0x01, 1, DEVICE_ID);
+  next[8] ^= 0x40;
+  next += 10;
+
+  frame(next, SDS011_REPLY_DATA, OTHER_PM25 & 0xFF, OTHER_PM25 >> 8, 0x66, OTHER_ID);
+  next += 10;
+
+  frame(next, SDS011_REPLY_COMMAND, (sub == SDS011_DUTY_CYCLE) ? SDS011_VERSION : SDS011_DUTY_CYCLE, 0x01, 20,
+        DEVICE_ID);
+  bus.sendAfterCommand(junk, sizeof(junk));
+}
+
+int main()
+{
+  SDS011SoftBus::start();
+  SDS011SoftBus bus;
+  SDS011SoftSensor sensor(DEVICE_ID);
+  bus.attach(&sensor);
+
+  NovaSDS011 sds;
+  sds.begin(bus, WAIT_WRITE_READ);
+  sds.setDataReportingMode(DataReportingMode::query, DEVICE_ID);
+  bus.advance(3000);
+
+  uint16_t pm25 = 0;
+  uint16_t pm10 = 0;
+  injectJunk(bus, SDS011_REPLY_DATA, 0);
+  QuerryError error = sds.queryData(pm25, pm10, DEVICE_ID);
+  check(error == QuerryError::no_error, "query: reply found", error);
+  check((pm25 != OTHER_PM25) && (pm10 != 0), "query: values of right device", pm25);
+
+  // Cache would skip set commands, so every call goes to sensor
+  sds.invalidateCache();
+  injectJunk(bus, SDS011_REPLY_COMMAND, SDS011_REPORTING_MODE);
+  check(sds.setDataReportingMode(DataReportingMode::query, DEVICE_ID), "reporting mode: confirmed", 0);
+
+  sds.invalidateCache();
+  injectJunk(bus, SDS011_REPLY_COMMAND, SDS011_WORKING_MODE);
+  check(sds.setWorkingMode(WorkingMode::mode_work, DEVICE_ID), "working mode: confirmed", 0);
+
+  sds.invalidateCache();
+  injectJunk(bus, SDS011_REPLY_COMMAND, SDS011_VERSION);
+  SDS011Version version = sds.getVersionDate(DEVICE_ID);
+  check(version.valid && (version.year == 18), "version: reply of sensor, not injected one", version.year);
+
+  SDS011SoftBus::stop();
+  printf("%d failed\n", failures);
+  return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,201 @@
+/**
+ * @file samplelog_check.cpp
+ * @brief Round trip checks of SDS011SampleLog on SDS011FileStorage.
+ *
+ * Writes steady one-minute series and reads it back with SDS011LogReader,
+ * prints storage bytes per sample against CSV text. Then checks ring wrap,
+ * begin() continuing flushed page after restart and page with broken CRC
+ * counted by corruptPages(). Exits 1 on failure.
+ *
+ * Build: g++ -O2 -std=c++11 -o samplelog_check samplelog_check.cpp ../../src/SDS011SampleLog.cpp
+ * Usage: samplelog_check [page size (64+, default 256)]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+#include "SDS011FileStorage.h"
+#include "../../src/SDS011SampleLog.h"
+
+#define START_TIME 1700000000U
+#define SAMPLE_PERIOD 60
+#define RING_PAGES 8
+#define RING_WRITES 20
+#define ROUND_TRIP_SAMPLES 2000
+#define MAX_RECORD_SIZE 15
+#define MIN_PAGE_SIZE 64 // smaller pages have no room left to continue after begin()
+
+static int failures = 0;
+
+static void check(bool ok, const char *name, uint32_t value)
+{
+  printf("%-44s %-4s (%u)\n", name, ok ? "ok" : "FAIL", value);
+  if (!ok)
+  {
+    failures++;
+  }
+}
+
+// Steady air, PM moves by few tenths between minutes
+static std::vector<SDS011LogSample> generate(size_t count)
+{
+  std::vector<SDS011LogSample> samples(count);
+  uint32_t state = 12345;
+  int32_t pm25 = 120;
+  int32_t pm10 = 250;
+  for (size_t i = 0; i < count; i++)
+  {
+    state = state * 1103515245 + 12345;
+    pm25 += (int32_t)((state >> 16) % 5) - 2;
+    pm10 += (int32_t)((state >> 24) % 7) - 3;
+    pm25 = (pm25 < 0) ? 0 : pm25;
+    pm10 = (pm10 < pm25) ? pm25 : pm10;
+    samples[i] = {START_TIME + (uint32_t)i * SAMPLE_PERIOD, (uint16_t)pm25, (uint16_t)pm10};
+  }
+  return samples;
+}
+
+struct ReadResult
+{
+  uint32_t count;
+  uint32_t first;      // index of first sample read
+  uint32_t last;       // index of last sample read
+  uint32_t mismatches; // samples not equal to written ones or out of order
+  uint16_t corrupt;
+};
+
+// Every sample is compared with written one of same timestamp
+static ReadResult readAll(SDS011Storage &storage, uint8_t *buffer, const std::vector<SDS011LogSample> &written)
+{
+  ReadResult result = {0, 0, 0, 0, 0};
+  SDS011LogReader reader(storage, buffer);
+  SDS011LogSample sample;
+  while (reader.next(sample))
+  {
+    uint32_t index = (sample.timestamp - START_TIME) / SAMPLE_PERIOD;
+    bool ordered = (result.count == 0) || (index > result.last);
+    if (!ordered || (index >= written.size()) || (written[index].timestamp != sample.timestamp) ||
+        (written[index].pm25 != sample.pm25) || (written[index].pm10 != sample.pm10))
+    {
+      result.mismatches++;
+    }
+    if (result.count == 0)
+    {
+      result.first = index;
+    }
+    result.last = index;
+    result.count++;
+  }
+  result.corrupt = reader.corruptPages();
+  return result;
+}
+
+int main(int argc, char **argv)
+{
+  uint16_t pageSize = (argc > 1) ? strtoul(argv[1], NULL, 10) : 256;
+  if (pageSize < MIN_PAGE_SIZE)
+  {
+    fprintf(stderr, "Usage: samplelog_check [page size (%d+)]\n", MIN_PAGE_SIZE);
+    return 2;
+  }
+
+  char path[] = "/tmp/samplelog_checkXXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0)
+  {
+    perror("mkstemp");
+    return 2;
+  }
+  close(fd);
+
+  std::vector<uint8_t> buffer(pageSize);
+  // Records take at least 3 bytes, enough samples for RING_WRITES pages
+  std::vector<SDS011LogSample> samples = generate(ROUND_TRIP_SAMPLES + (RING_WRITES + 1) * pageSize / 3);
+
+  // Series fits into storage even with largest records, only full pages count for size
+  {
+    uint16_t pages = ROUND_TRIP_SAMPLES * MAX_RECORD_SIZE / (pageSize - SDS011_LOG_HEADER_SIZE - 2) + 1;
+    SDS011FileStorage storage(path, pageSize, pages);
+    SDS011SampleLog log(storage, buffer.data());
+    log.begin();
+    uint32_t count = ROUND_TRIP_SAMPLES;
+    size_t csv = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+      log.append(samples[i].timestamp, samples[i].pm25, samples[i].pm10);
+      char line[48];
+      csv += snprintf(line, sizeof(line), "%u,%u.%u,%u.%u\n", samples[i].timestamp, samples[i].pm25 / 10,
+                      samples[i].pm25 % 10, samples[i].pm10 / 10, samples[i].pm10 % 10);
+    }
+    uint32_t inFullPages = count - log.pendingSamples();
+    double perSample = (double)log.pageWrites() * pageSize / inFullPages;
+    printf("%u samples, %u byte pages: %.2f bytes/sample, CSV %.2f bytes/sample\n", count, pageSize, perSample,
+           (double)csv / count);
+    check(log.flush(), "round trip: flush", 0);
+
+    ReadResult read = readAll(storage, buffer.data(), samples);
+    check(read.count == count, "round trip: all samples read", read.count);
+    check(read.mismatches == 0, "round trip: samples equal", read.mismatches);
+  }
+  unlink(path);
+
+  // Ring of RING_PAGES pages written several times over, newest page flushed half full
+  uint32_t written = 0;
+  ReadResult before;
+  {
+    SDS011FileStorage storage(path, pageSize, RING_PAGES);
+    SDS011SampleLog log(storage, buffer.data());
+    log.begin();
+    while ((log.pageWrites() < RING_WRITES) || (log.pendingSamples() < 5))
+    {
+      log.append(samples[written].timestamp, samples[written].pm25, samples[written].pm10);
+      written++;
+    }
+    log.flush();
+
+    before = readAll(storage, buffer.data(), samples);
+    check(before.mismatches == 0, "ring: samples equal and ordered", before.mismatches);
+    check(before.last == written - 1, "ring: newest sample kept", before.last);
+    check(before.count == written - before.first, "ring: no gap after wrap", before.count);
+  }
+
+  // Restart, log continues in flushed page
+  {
+    SDS011FileStorage storage(path, pageSize, RING_PAGES);
+    SDS011SampleLog log(storage, buffer.data());
+    log.begin();
+    check(log.pendingSamples() > 0, "resume: continues flushed page", log.pendingSamples());
+    for (uint32_t i = 0; i < 3; i++)
+    {
+      log.append(samples[written].timestamp, samples[written].pm25, samples[written].pm10);
+      written++;
+    }
+    log.flush();
+
+    ReadResult after = readAll(storage, buffer.data(), samples);
+    check(after.mismatches == 0, "resume: samples equal and ordered", after.mismatches);
+    check((after.last == written - 1) && (after.first == before.first), "resume: nothing lost", after.count);
+    check(after.count == before.count + 3, "resume: samples added to same page", after.count);
+
+    // Broken byte in page which is neither oldest nor newest
+    uint16_t page = 0;
+    uint32_t sequence;
+    SDS011SampleLog::findNewestPage(storage, buffer.data(), page, sequence);
+    page = (page + RING_PAGES / 2) % RING_PAGES;
+    storage.readPage(page, buffer.data());
+    buffer[SDS011_LOG_HEADER_SIZE + 3] ^= 0x10;
+    storage.writePage(page, buffer.data());
+
+    ReadResult corrupt = readAll(storage, buffer.data(), samples);
+    check(corrupt.corrupt == 1, "corrupt: page counted", corrupt.corrupt);
+    check(corrupt.mismatches == 0, "corrupt: other samples equal", corrupt.mismatches);
+    check((corrupt.count < after.count) && (corrupt.last == written - 1), "corrupt: only its samples skipped",
+          after.count - corrupt.count);
+  }
+  unlink(path);
+
+  printf("%d failed\n", failures);
+  return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,349 @@
+/**
+ * @file sds011_cli.cpp
+ * @brief Command line tool for sds011 on Linux, built on the driver.
+ *
+ * Queries and configures sensor on USB serial adapter or on pty of
+ * sds011_sim, streams active mode samples and runs soak test of the
+ * non blocking request path with throughput, latency percentiles,
+ * timeout/resync counters and CPU usage.
+ *
+ * Build: g++ -O2 -std=c++11 -DARDUINO=10800 -Iarduino -I../../src -o sds011_cli sds011_cli.cpp SDS011PosixSerial.cpp
+ *        arduino/Arduino.cpp ../../src/NovaSDS011.cpp ../../src/SDS011Clock.cpp ../../src/SDS011DeviceCache.cpp
+ *        ../../src/SDS011Frame.cpp ../../src/SDS011Quantiles.cpp
+ * Usage: sds011_cli [--port dev] [--id hex] [--timeout ms] [--interval ms] [--report s] command [args]
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include "NovaSDS011.h"
+#include "SDS011PosixSerial.h"
+#include "SDS011Quantiles.h"
+
+static volatile sig_atomic_t running = 1;
+
+static void stop(int)
+{
+  running = 0;
+}
+
+static void usage()
+{
+  fprintf(stderr,
+          "Usage: sds011_cli [options] command [args]\n"
+          "Options:\n"
+          "  --port dev       serial device or pty (default /dev/ttyUSB0)\n"
+          "  --id hex         device id (default FFFF, any device)\n"
+          "  --timeout ms     reply timeout (default 1000)\n"
+          "  --interval ms    soak: pause between requests (default 0)\n"
+          "  --report s       soak: progress report period (default 60)\n"
+          "Commands:\n"
+          "  query                     read PM2.5 and PM10\n"
+          "  version                   firmware version\n"
+          "  id                        device id\n"
+          "  mode [sleep|work]         get or set working mode\n"
+          "  reporting [active|query]  get or set data reporting mode\n"
+          "  duty [0-30]               get or set duty cycle in minutes\n"
+          "  setid hex                 change device id\n"
+          "  probe                     read complete configuration\n"
+          "  discover                  list devices on bus\n"
+          "  stream [s]                print active mode samples as CSV\n"
+          "  soak [s]                  load test of request path\n");
+}
+
+// --------------------------------------------------------
+// Soak test state
+// --------------------------------------------------------
+struct Soak
+{
+  const NovaSDS011 *sds;
+  SDS011QuantileSketch latency;  // 0.1 ms units
+  SDS011Stopwatch request;
+  bool waiting;
+  uint32_t requests;
+  uint32_t samples;
+  uint32_t timeouts;
+  uint32_t checksumErrors;
+};
+
+static void soakSample(void *context, uint16_t, uint16_t, uint16_t, uint32_t)
+{
+  Soak &soak = *(Soak *)context;
+  uint32_t tenths = soak.request.elapsedMicros() / 100;
+  soak.latency.add((tenths > SDS011QuantileSketch::MAX_VALUE) ? SDS011QuantileSketch::MAX_VALUE : tenths);
+  soak.samples++;
+  soak.waiting = false;
+}
+
+static void soakError(void *context, uint16_t, QuerryError)
+{
+  // Checksum error is reported before timeout in same service() call
+  Soak &soak = *(Soak *)context;
+  if (soak.sds->decoder().checksumErrors() != soak.checksumErrors)
+  {
+    soak.checksumErrors = soak.sds->decoder().checksumErrors();
+    return;
+  }
+  soak.timeouts++;
+  soak.waiting = false;
+}
+
+static double cpuSeconds()
+{
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+static void soakReport(const char *label, const Soak &soak, const NovaSDS011 &sds, uint32_t elapsed, double cpu)
+{
+  double seconds = elapsed / 1000.0;
+  printf("%s %.0fs: requests %u, samples %u (%.1f/s), timeouts %u, checksum errors %u, skipped bytes %u, "
+         "latency ms p50 %.1f p95 %.1f p99 %.1f max %.1f, cpu %.1f%%\n",
+         label, seconds, soak.requests, soak.samples, seconds ? soak.samples / seconds : 0, soak.timeouts,
+         sds.decoder().checksumErrors(), sds.decoder().skippedBytes(), soak.latency.quantile(500) / 10.0,
+         soak.latency.quantile(950) / 10.0, soak.latency.quantile(990) / 10.0, soak.latency.maximum() / 10.0,
+         seconds ? cpu * 100 / seconds : 0);
+  fflush(stdout);
+}
+
+static int runSoak(NovaSDS011 &sds, SDS011PosixSerial &serial, uint16_t id, uint32_t duration, uint32_t interval,
+                   uint32_t report)
+{
+  if (!sds.setWorkingMode(WorkingMode::mode_work, id) || !sds.setDataReportingMode(DataReportingMode::query, id))
+  {
+    fprintf(stderr, "Sensor does not answer\n");
+    return 1;
+  }
+
+  Soak soak;
+  soak.sds = &sds;
+  soak.checksumErrors = sds.decoder().checksumErrors();
+  soak.waiting = false;
+  soak.requests = 0;
+  soak.samples = 0;
+  soak.timeouts = 0;
+  sds.onSample(soakSample, &soak);
+  sds.onError(soakError, &soak);
+
+  SDS011Deadline total(duration * 1000);
+  SDS011Deadline pause(0);
+  SDS011Deadline nextReport(report * 1000);
+  double cpuStart = cpuSeconds();
+
+  while (running && ((duration == 0) || !total.expired()))
+  {
+    if (!soak.waiting && pause.expired() && sds.requestData(id))
+    {
+      soak.request.start();
+      soak.waiting = true;
+      soak.requests++;
+      pause.start(interval);
+    }
+
+    serial.waitReadable(1);
+    sds.service();
+
+    if ((report > 0) && nextReport.expired())
+    {
+      nextReport.start(report * 1000);
+      soakReport("progress", soak, sds, total.elapsed(), cpuSeconds() - cpuStart);
+    }
+  }
+
+  soakReport("total", soak, sds, total.elapsed(), cpuSeconds() - cpuStart);
+  sds.onSample(NULL);
+  sds.onError(NULL);
+  return (soak.samples > 0) ? 0 : 1;
+}
+
+static void streamSample(void *, uint16_t device_id, uint16_t pm25, uint16_t pm10, uint32_t timestamp)
+{
+  printf("%u,%04X,%u.%u,%u.%u\n", timestamp, device_id, pm25 / 10, pm25 % 10, pm10 / 10, pm10 % 10);
+  fflush(stdout);
+}
+
+static int runStream(NovaSDS011 &sds, SDS011PosixSerial &serial, uint16_t id, uint32_t duration)
+{
+  if (!sds.setWorkingMode(WorkingMode::mode_work, id) || !sds.setDataReportingMode(DataReportingMode::active, id))
+  {
+    fprintf(stderr, "Sensor does not answer\n");
+    return 1;
+  }
+
+  printf("millis,device,pm25,pm10\n");
+  sds.onSample(streamSample);
+  SDS011Deadline total(duration * 1000);
+  while (running && ((duration == 0) || !total.expired()))
+  {
+    serial.waitReadable(100);
+    sds.service();
+  }
+  sds.onSample(NULL);
+  return 0;
+}
+
+static int printResult(bool ok)
+{
+  printf("%s\n", ok ? "ok" : "failed");
+  return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+  const char *port = "/dev/ttyUSB0";
+  uint16_t id = SDS011_BROADCAST_ID;
+  uint16_t timeout = 1000;
+  uint32_t interval = 0;
+  uint32_t report = 60;
+
+  int arg = 1;
+  for (; (arg + 1 < argc) && (strncmp(argv[arg], "--", 2) == 0); arg += 2)
+  {
+    const char *value = argv[arg + 1];
+    if (strcmp(argv[arg], "--port") == 0)
+    {
+      port = value;
+    }
+    else if (strcmp(argv[arg], "--id") == 0)
+    {
+      id = strtoul(value, NULL, 16);
+    }
+    else if (strcmp(argv[arg], "--timeout") == 0)
+    {
+      timeout = strtoul(value, NULL, 10);
+    }
+    else if (strcmp(argv[arg], "--interval") == 0)
+    {
+      interval = strtoul(value, NULL, 10);
+    }
+    else if (strcmp(argv[arg], "--report") == 0)
+    {
+      report = strtoul(value, NULL, 10);
+    }
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+  if (arg >= argc)
+  {
+    usage();
+    return 2;
+  }
+  const char *command = argv[arg];
+  const char *param = (arg + 1 < argc) ? argv[arg + 1] : NULL;
+
+  SDS011PosixSerial serial;
+  if (!serial.open(port))
+  {
+    perror(port);
+    return 1;
+  }
+  NovaSDS011 sds;
+  sds.begin(serial, timeout);
+  signal(SIGINT, stop);
+  signal(SIGTERM, stop);
+
+  if (strcmp(command, "query") == 0)
+  {
+    uint16_t pm25;
+    uint16_t pm10;
+    if (sds.queryData(pm25, pm10, id) != QuerryError::no_error)
+    {
+      fprintf(stderr, "No reply\n");
+      return 1;
+    }
+    printf("PM2.5=%u.%u PM10=%u.%u\n", pm25 / 10, pm25 % 10, pm10 / 10, pm10 % 10);
+    return 0;
+  }
+  if (strcmp(command, "version") == 0)
+  {
+    SDS011Version version = sds.getVersionDate(id);
+    if (!version.valid)
+    {
+      fprintf(stderr, "No reply\n");
+      return 1;
+    }
+    printf("20%02u-%02u-%02u\n", version.year, version.month, version.day);
+    return 0;
+  }
+  if (strcmp(command, "id") == 0)
+  {
+    uint16_t deviceId = sds.getDeviceID(id);
+    printf("%04X\n", deviceId);
+    return (deviceId != SDS011_BROADCAST_ID) ? 0 : 1;
+  }
+  if (strcmp(command, "mode") == 0)
+  {
+    if (param != NULL)
+    {
+      return printResult(sds.setWorkingMode((strcmp(param, "sleep") == 0) ? WorkingMode::mode_sleep
+                                                                          : WorkingMode::mode_work,
+                                            id));
+    }
+    WorkingMode mode = sds.getWorkingMode(id);
+    printf("%s\n", (mode == WorkingMode::mode_work) ? "work" : ((mode == WorkingMode::mode_sleep) ? "sleep" : "error"));
+    return (mode != WorkingMode::mode_error) ? 0 : 1;
+  }
+  if (strcmp(command, "reporting") == 0)
+  {
+    if (param != NULL)
+    {
+      return printResult(sds.setDataReportingMode((strcmp(param, "active") == 0) ? DataReportingMode::active
+                                                                                 : DataReportingMode::query,
+                                                  id));
+    }
+    DataReportingMode mode = sds.getDataReportingMode(id);
+    printf("%s\n", (mode == DataReportingMode::active) ? "active"
+                                                       : ((mode == DataReportingMode::query) ? "query" : "error"));
+    return (mode != DataReportingMode::report_error) ? 0 : 1;
+  }
+  if (strcmp(command, "duty") == 0)
+  {
+    if (param != NULL)
+    {
+      return printResult(sds.setDutyCycle(strtoul(param, NULL, 10), id));
+    }
+    uint8_t duty = sds.getDutyCycle(id);
+    printf("%u\n", duty);
+    return (duty <= 30) ? 0 : 1;
+  }
+  if ((strcmp(command, "setid") == 0) && (param != NULL))
+  {
+    return printResult(sds.setDeviceID(strtoul(param, NULL, 16), id));
+  }
+  if (strcmp(command, "probe") == 0)
+  {
+    SDS011ProbeResult result = sds.probe(id);
+    printf("device %04X, firmware 20%02u-%02u-%02u, reporting %d, working %d, duty %u, ready in %u ms\n",
+           result.deviceId, result.version.year, result.version.month, result.version.day, result.reportingMode,
+           result.workingMode, result.dutyCycle, result.timeToReady);
+    return result.valid ? 0 : 1;
+  }
+  if (strcmp(command, "discover") == 0)
+  {
+    uint8_t count = sds.discover();
+    for (uint8_t i = 0; i < sds.devices().count(); i++)
+    {
+      printf("%04X\n", sds.devices().at(i).deviceId);
+    }
+    return (count > 0) ? 0 : 1;
+  }
+  if (strcmp(command, "stream") == 0)
+  {
+    return runStream(sds, serial, id, (param != NULL) ? strtoul(param, NULL, 10) : 0);
+  }
+  if (strcmp(command, "soak") == 0)
+  {
+    return runSoak(sds, serial, id, (param != NULL) ? strtoul(param, NULL, 10) : 0, interval, report);
+  }
+
+  usage();
+  return 2;
+}
@@ -0,0 +1,157 @@
+/**
+ * @file sds011_sim.cpp
+ * @brief Software sds011 sensor behind pseudo terminal.
+ *
+ * Creates pty, prints its slave device and answers driver commands on it,
+ * so sds011_cli and other host tools run without hardware, e.g. in CI.
+ *
+ * Build: g++ -O2 -std=c++11 -o sds011_sim sds011_sim.cpp SDS011SoftSensor.cpp
+ * Usage: sds011_sim [--link path] [--id hex] [--delay ms] [--drop %] [--corrupt %] [--noise %]
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "SDS011SoftSensor.h"
+
+static volatile sig_atomic_t running = 1;
+
+static void stop(int)
+{
+  running = 0;
+}
+
+static uint32_t nowMillis()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t)(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+static void usage()
+{
+  fprintf(stderr, "Usage: sds011_sim [--link path] [--id hex] [--delay ms] [--drop %%] [--corrupt %%] [--noise %%]\n");
+}
+
+int main(int argc, char **argv)
+{
+  const char *link = NULL;
+  uint16_t id = 0x1A2B;
+  uint32_t delay = 5;
+  uint8_t drop = 0;
+  uint8_t corrupt = 0;
+  uint8_t noise = 0;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if ((i + 1 >= argc) || (strncmp(argv[i], "--", 2) != 0))
+    {
+      usage();
+      return 2;
+    }
+    const char *value = argv[++i];
+    if (strcmp(argv[i - 1], "--link") == 0)
+    {
+      link = value;
+    }
+    else if (strcmp(argv[i - 1], "--id") == 0)
+    {
+      id = strtoul(value, NULL, 16);
+    }
+    else if (strcmp(argv[i - 1], "--delay") == 0)
+    {
+      delay = strtoul(value, NULL, 10);
+    }
+    else if (strcmp(argv[i - 1], "--drop") == 0)
+    {
+      drop = strtoul(value, NULL, 10);
+    }
+    else if (strcmp(argv[i - 1], "--corrupt") == 0)
+    {
+      corrupt = strtoul(value, NULL, 10);
+    }
+    else if (strcmp(argv[i - 1], "--noise") == 0)
+    {
+      noise = strtoul(value, NULL, 10);
+    }
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if ((master < 0) || (grantpt(master) != 0) || (unlockpt(master) != 0))
+  {
+    perror("posix_openpt");
+    return 1;
+  }
+  const char *slave = ptsname(master);
+  fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+  // Keep slave open so pty survives reconnects of clients, raw mode is shared with them
+  int keep = open(slave, O_RDWR | O_NOCTTY);
+  termios options;
+  tcgetattr(keep, &options);
+  cfmakeraw(&options);
+  tcsetattr(keep, TCSANOW, &options);
+
+  if ((link != NULL) && ((unlink(link), symlink(slave, link)) != 0))
+  {
+    perror("symlink");
+    return 1;
+  }
+  printf("%s\n", slave);
+  fflush(stdout);
+
+  signal(SIGINT, stop);
+  signal(SIGTERM, stop);
+
+  SDS011SoftSensor sensor(id);
+  sensor.setReplyDelay(delay);
+  sensor.setFaults(drop, corrupt, noise);
+
+  while (running)
+  {
+    pollfd request = {master, POLLIN, 0};
+    if (poll(&request, 1, 1) > 0)
+    {
+      uint8_t buffer[256];
+      ssize_t size = read(master, buffer, sizeof(buffer));
+      uint32_t now = nowMillis();
+      for (ssize_t i = 0; i < size; i++)
+      {
+        sensor.receive(buffer[i], now);
+      }
+    }
+
+    uint32_t now = nowMillis();
+    sensor.update(now);
+    uint8_t buffer[256];
+    size_t size = sensor.transmit(buffer, sizeof(buffer), now);
+    if ((size > 0) && (write(master, buffer, size) < 0) && (errno != EAGAIN))
+    {
+      perror("write");
+    }
+  }
+
+  SDS011SoftSensorStats stats = sensor.stats();
+  fprintf(stderr, "commands %u, ignored %u, replies %u, dropped %u, corrupted %u, noise bytes %u\n",
+          stats.commands, stats.ignored, stats.replies, stats.dropped, stats.corrupted, stats.noise);
+  if (link != NULL)
+  {
+    unlink(link);
+  }
+  close(keep);
+  close(master);
+  return 0;
+}
@@ -13,6 +13,15 @@
 #include "Commands.h"
 
 #define MIN_QUERY_INTERVAL 3000
+#define BUS_QUIET_TIME 50
+
+// --------------------------------------------------------
+// Device id from reply
+// --------------------------------------------------------
+static uint16_t replyDeviceId(const ReplyType reply)
+{
+  return reply[6] | (reply[7] << 8);
+}
 
 // --------------------------------------------------------
 // NovaSDS011:constructor
@@ -63,51 +72,46 @@ uint8_t NovaSDS011::calculateCommandCheckSum(CommandType cmd)
   return checksum;
 }
 
-// --------------------------------------------------------
-// NovaSDS011:calculateCheckSum
-// --------------------------------------------------------
-uint8_t NovaSDS011::calculateReplyCheckSum(ReplyType reply)
-{
-  uint16_t checksum = 0;
-  for (int i = 2; i <= 7; i++)
-  {
-    checksum += reply[i];
-  }
-
-  checksum &= 0xFF;
-  return checksum;
-}
-
 // --------------------------------------------------------
 // NovaSDS011:readReply
 // --------------------------------------------------------
-bool NovaSDS011::readReply(ReplyType &reply)
+bool NovaSDS011::readReply(ReplyType &reply, uint8_t command, uint8_t sub_command, uint16_t device_id)
 {
   bool timeout = true;
   
-  uint64_t start = millis();
-  while (_sdsSerial->available() < sizeof(ReplyType))
+  SDS011Stopwatch latency;
+  SDS011Deadline deadline(_waitWriteRead);
+
+  // Decoder rejects bad frames as bytes arrive, replies of other devices are skipped
+  _decoder.reset();
+  _decoder.expect(command, sub_command);
+  while (timeout && !deadline.expired())
   {
-    if (millis() > (start + _waitWriteRead))
+    if (_sdsSerial->available() == 0)
     {
-      break;
+      delay(1);
+      continue;
     }
 
-    delay(1);
+    if (_decoder.push(_sdsSerial->read()) &&
+        ((device_id == SDS011_BROADCAST_ID) || (_decoder.deviceId() == device_id)))
+    {
+      timeout = false;
+    }
   }
+  _decoder.expect();
 
 #ifndef NO_TRACES
-  uint32_t duration = (millis() - start);
-  DebugOut("readReply - Wait for " + String(duration) + "ms");
+  DebugOut("readReply - Wait for " + String(deadline.elapsed()) + "ms");
 #endif
 
-  for (int i = 0; (_sdsSerial->available() > 0) && (i < sizeof(ReplyType)); i++)
+  if (!timeout)
   {
-    reply[i] = _sdsSerial->read();
-    if (i == (sizeof(ReplyType) - 1))
+    for (uint8_t i = 0; i < sizeof(ReplyType); i++)
     {
-      timeout = false;
+      reply[i] = _decoder.frame()[i];
     }
+    _replyLatency = latency.elapsedMicros();
   }
 
   clearSerial();
@@ -119,22 +123,46 @@ bool NovaSDS011::readReply(ReplyType &reply)
 // --------------------------------------------------------
 void NovaSDS011::begin(uint8_t pin_rx, uint8_t pin_tx, uint16_t wait_write_read)
 {
-  _waitWriteRead = wait_write_read;
   SoftwareSerial *softSerial = new SoftwareSerial(pin_rx, pin_tx);
 
   // Initialize soft serial bus
   softSerial->begin(9600);
-  _sdsSerial = softSerial;
+  begin(*softSerial, wait_write_read);
+}
+
+// --------------------------------------------------------
+// NovaSDS011:begin
+// --------------------------------------------------------
+void NovaSDS011::begin(Stream &serial, uint16_t wait_write_read)
+{
+  _waitWriteRead = wait_write_read;
+  _sdsSerial = &serial;
+  _cache.clear();
+  _decoder.reset();
 
   clearSerial();
 }
 
+// --------------------------------------------------------
+// NovaSDS011:invalidateCache
+// --------------------------------------------------------
+void NovaSDS011::invalidateCache(uint16_t device_id)
+{
+  _cache.invalidate(device_id);
+}
+
 // --------------------------------------------------------
 // NovaSDS011:setDataReportingMode
 // --------------------------------------------------------
 bool NovaSDS011::setDataReportingMode(DataReportingMode mode, uint16_t device_id)
 {
   ReplyType reply;
+  uint8_t cached;
+
+  if (_cache.get(device_id, cache_reporting_mode, cached) && (cached == mode))
+  {
+    return true;
+  }
 
   REPORT_TYPE_CMD[3] = 0x01; //Set reporting mode
   REPORT_TYPE_CMD[4] = uint8_t(mode & 0xFF);
@@ -148,40 +176,26 @@ bool NovaSDS011::setDataReportingMode(DataReportingMode mode, uint16_t device_id
   }
   _sdsSerial->flush();
 
-  if (readReply(reply))
+  if (readReply(reply, SDS011_REPLY_COMMAND, SDS011_REPORTING_MODE, device_id))
   {
 #ifndef NO_TRACES
     DebugOut("setDataReportingMode - Error read reply timeout");
 #endif
+    _cache.invalidate(device_id);
     return false;
   }
-  readReply(reply);
-
-  REPORT_TYPE_REPLY[3] = REPORT_TYPE_CMD[3]; //Set reporting mode
-  REPORT_TYPE_REPLY[4] = REPORT_TYPE_CMD[4]; //Reporting mode
-  if (device_id != 0xFFFF)
-  {
-    REPORT_TYPE_REPLY[6] = REPORT_TYPE_CMD[15]; //Device ID byte 1
-    REPORT_TYPE_REPLY[7] = REPORT_TYPE_CMD[16]; //Device ID byte 2
-  }
-  else
-  {
-    REPORT_TYPE_REPLY[6] = reply[6]; //Device ID byte 1
-    REPORT_TYPE_REPLY[7] = reply[7]; //Device ID byte 2
-  }
-  REPORT_TYPE_REPLY[8] = calculateReplyCheckSum(reply);
 
-  for (int i = 0; i < sizeof(ReplyType); i++)
+  // Confirmation carries new value
+  if ((reply[3] != 0x01) || (reply[4] != REPORT_TYPE_CMD[4]))
   {
-    if (REPORT_TYPE_REPLY[i] != reply[i])
-    {
 #ifndef NO_TRACES
-      DebugOut("setDataReportingMode - Error on byte " + String(i) + " Received byte=" + String(reply[i]) +
-               " Expected byte=" + String(REPORT_TYPE_REPLY[i]));
+    DebugOut("setDataReportingMode - Error value not confirmed, received " + String(reply[4]));
 #endif
-      return false;
-    }
+    _cache.invalidate(device_id);
+    return false;
   }
+
+  _cache.apply(device_id, replyDeviceId(reply), cache_reporting_mode, mode);
   return true;
 }
 
@@ -191,6 +205,12 @@ bool NovaSDS011::setDataReportingMode(DataReportingMode mode, uint16_t device_id
 DataReportingMode NovaSDS011::getDataReportingMode(uint16_t device_id)
 {
   ReplyType reply;
+  uint8_t cached;
+
+  if (_cache.get(device_id, cache_reporting_mode, cached))
+  {
+    return (DataReportingMode)cached;
+  }
 
   REPORT_TYPE_CMD[3] = 0x00; //Get reporting mode
   REPORT_TYPE_CMD[15] = device_id & 0xFF;
@@ -203,46 +223,33 @@ DataReportingMode NovaSDS011::getDataReportingMode(uint16_t device_id)
   }
   _sdsSerial->flush();
 
-  if (readReply(reply))
+  if (readReply(reply, SDS011_REPLY_COMMAND, SDS011_REPORTING_MODE, device_id))
   {
 #ifndef NO_TRACES
     DebugOut("getDataReportingMode - Error read reply timeout");
 #endif
+    _cache.invalidate(device_id);
     return DataReportingMode::report_error;
   }
 
-  REPORT_TYPE_REPLY[3] = REPORT_TYPE_CMD[3]; //Get reporting mode
-  REPORT_TYPE_REPLY[4] = reply[4];           //Reporting mode
-  if (device_id != 0xFFFF)
+  // Reply to query of current value, not confirmation of set
+  if (reply[3] != 0x00)
   {
-    REPORT_TYPE_REPLY[6] = REPORT_TYPE_CMD[15]; //Device ID byte 1
-    REPORT_TYPE_REPLY[7] = REPORT_TYPE_CMD[16]; //Device ID byte 2
-  }
-  else
-  {
-    REPORT_TYPE_REPLY[6] = reply[6]; //Device ID byte 1
-    REPORT_TYPE_REPLY[7] = reply[7]; //Device ID byte 2
-  }
-  REPORT_TYPE_REPLY[8] = calculateReplyCheckSum(reply);
-
-  for (int i = 0; i < sizeof(ReplyType); i++)
-  {
-    if (REPORT_TYPE_REPLY[i] != reply[i])
-    {
 #ifndef NO_TRACES
-      DebugOut("getDataReportingMode - Error on byte " + String(i) + " Received byte=" + String(reply[i]) +
-               " Expected byte=" + String(REPORT_TYPE_REPLY[i]));
+    DebugOut("getDataReportingMode - Error unexpected reply to set command");
 #endif
-      return DataReportingMode::report_error;
-    }
+    _cache.invalidate(device_id);
+    return DataReportingMode::report_error;
   }
 
   if (reply[4] == DataReportingMode::active)
   {
+    _cache.observe(device_id, replyDeviceId(reply), cache_reporting_mode, DataReportingMode::active);
     return DataReportingMode::active;
   }
   else if (reply[4] == DataReportingMode::query)
   {
+    _cache.observe(device_id, replyDeviceId(reply), cache_reporting_mode, DataReportingMode::query);
     return DataReportingMode::query;
   }
   else
@@ -256,7 +263,26 @@ DataReportingMode NovaSDS011::getDataReportingMode(uint16_t device_id)
 // --------------------------------------------------------
 QuerryError NovaSDS011::queryData(float &PM25, float &PM10, uint16_t device_id)
 {
-  static uint64_t lastCall = 0;
+  uint16_t pm25Serial = 0;
+  uint16_t pm10Serial = 0;
+
+  QuerryError result = queryData(pm25Serial, pm10Serial, device_id);
+  if (result != QuerryError::no_error)
+  {
+    return result;
+  }
+
+  PM25 = (float)pm25Serial / 10.0;
+  PM10 = (float)pm10Serial / 10.0;
+
+  return QuerryError::no_error;
+}
+
+// --------------------------------------------------------
+// NovaSDS011:queryData
+// --------------------------------------------------------
+QuerryError NovaSDS011::queryData(uint16_t &PM25, uint16_t &PM10, uint16_t device_id)
+{
   static uint16_t lastPM25 = 0;
   static uint16_t lastPM10 = 0;
 
@@ -264,11 +290,11 @@ QuerryError NovaSDS011::queryData(float &PM25, float &PM10, uint16_t device_id)
   uint16_t pm25Serial = 0;
   uint16_t pm10Serial = 0;
 
-  if (millis() < (lastCall + MIN_QUERY_INTERVAL))
+  if (!_queryInterval.expired())
   {
     return QuerryError::call_to_often;
   }
-  lastCall = millis();
+  _queryInterval.start(MIN_QUERY_INTERVAL);
 
   QUERY_CMD[15] = device_id & 0xFF;
   QUERY_CMD[16] = (device_id >> 8) & 0xFF;
@@ -280,42 +306,22 @@ QuerryError NovaSDS011::queryData(float &PM25, float &PM10, uint16_t device_id)
   }
   _sdsSerial->flush();
 
-  if (readReply(reply))
+  if (readReply(reply, SDS011_REPLY_DATA, 0, device_id))
   {
 #ifndef NO_TRACES
     DebugOut("queryData - Error read reply timeout");
 #endif
+    _cache.invalidate(device_id);
     return QuerryError::response_error;
   }
 
-  QUERY_REPLY[2] = reply[2]; //data byte 1 (PM2.5 low byte)
-  QUERY_REPLY[3] = reply[3]; //data byte 2 (PM2.5 high byte)
-  QUERY_REPLY[4] = reply[4]; //data byte 3 (PM10 low byte)
-  QUERY_REPLY[5] = reply[5]; //data byte 4 (PM10 high byte)
-
-  if (device_id != 0xFFFF)
-  {
-    QUERY_REPLY[6] = QUERY_CMD[15]; //Device ID byte 1
-    QUERY_REPLY[7] = QUERY_CMD[16]; //Device ID byte 2
-  }
-  else
-  {
-    QUERY_REPLY[6] = reply[6]; //Device ID byte 1
-    QUERY_REPLY[7] = reply[7]; //Device ID byte 2
-  }
-  QUERY_REPLY[8] = calculateReplyCheckSum(reply);
-
-  for (int i = 0; i < sizeof(ReplyType); i++)
+  // Device measures so it is working, if cache says otherwise it was reset
+  uint8_t cached;
+  if (_cache.get(device_id, cache_working_mode, cached) && (cached != WorkingMode::mode_work))
   {
-    if (QUERY_REPLY[i] != reply[i])
-    {
-#ifndef NO_TRACES
-      DebugOut("queryData - Error on byte " + String(i) + " Received byte=" + String(reply[i]) +
-               " Expected byte=" + String(REPORT_TYPE_REPLY[i]));
-#endif
-      return QuerryError::response_error;
-    }
+    _cache.invalidate(device_id);
   }
+  _cache.observe(device_id, replyDeviceId(reply), cache_working_mode, WorkingMode::mode_work);
 
   pm25Serial = reply[2];
   pm25Serial += (reply[3] << 8);
@@ -330,8 +336,8 @@ QuerryError NovaSDS011::queryData(float &PM25, float &PM10, uint16_t device_id)
   lastPM25 = pm25Serial;
   lastPM10 = pm10Serial;
 
-  PM25 = (float)pm25Serial / 10.0;
-  PM10 = (float)pm10Serial / 10.0;
+  PM25 = pm25Serial;
+  PM10 = pm10Serial;
 
   return QuerryError::no_error;
 }
@@ -355,30 +361,16 @@ bool NovaSDS011::setDeviceID(uint16_t new_device_id, uint16_t device_id)
   }
   _sdsSerial->flush();
 
-  if (readReply(reply))
+  if (readReply(reply, SDS011_REPLY_COMMAND, SDS011_SET_DEVICE_ID, new_device_id))
   {
 #ifndef NO_TRACES
     DebugOut("setDeviceID - Error read reply timeout");
 #endif
+    _cache.invalidate(device_id);
     return false;
   }
 
-  SET_ID_REPLY[6] = SET_ID_CMD[13]; //Device ID byte 1
-  SET_ID_REPLY[7] = SET_ID_CMD[14]; //Device ID byte 2
-
-  SET_ID_REPLY[8] = calculateReplyCheckSum(reply);
-
-  for (int i = 0; i < sizeof(ReplyType); i++)
-  {
-    if (SET_ID_REPLY[i] != reply[i])
-    {
-#ifndef NO_TRACES
-      DebugOut("setDeviceID - Error on byte " + String(i) + " Received byte=" + String(reply[i]) +
-               " Expected byte=" + String(REPORT_TYPE_REPLY[i]));
-#endif
-      return false;
-    }
-  }
+  _cache.rename(device_id, new_device_id);
   return true;
 }
 
@@ -389,6 +381,12 @@ bool NovaSDS011::setWorkingMode(WorkingMode mode, uint16_t device_id)
 {
   ReplyType reply;
   bool timeout;
+  uint8_t cached;
+
+  if (_cache.get(device_id, cache_working_mode, cached) && (cached == mode))
+  {
+    return true;
+  }
 
   WORKING_MODE_CMD[3] = 0x01; //Set reporting mode
   WORKING_MODE_CMD[4] = uint8_t(mode & 0xFF);
@@ -402,41 +400,37 @@ bool NovaSDS011::setWorkingMode(WorkingMode mode, uint16_t device_id)
   }
   _sdsSerial->flush();
 
-  timeout = readReply(reply);
+  timeout = readReply(reply, SDS011_REPLY_COMMAND, SDS011_WORKING_MODE, device_id);
 
   if ((mode == WorkingMode::mode_sleep) && (timeout))
   {
 #ifndef NO_TRACES
     DebugOut("setWorkingMode - Read timeout");
 #endif
+    _cache.invalidate(device_id);
     return true;
   }
 
-  WORKING_MODE_REPLY[3] = WORKING_MODE_CMD[3]; //Set reporting mode
-  WORKING_MODE_REPLY[4] = WORKING_MODE_CMD[4]; //Reporting mode
-  if (device_id != 0xFFFF)
-  {
-    WORKING_MODE_REPLY[6] = WORKING_MODE_REPLY[15]; //Device ID byte 1
-    WORKING_MODE_REPLY[7] = WORKING_MODE_REPLY[16]; //Device ID byte 2
-  }
-  else
+  if (timeout)
   {
-    WORKING_MODE_REPLY[6] = reply[6]; //Device ID byte 1
-    WORKING_MODE_REPLY[7] = reply[7]; //Device ID byte 2
+#ifndef NO_TRACES
+    DebugOut("setWorkingMode - Error read reply timeout");
+#endif
+    _cache.invalidate(device_id);
+    return false;
   }
-  WORKING_MODE_REPLY[8] = calculateReplyCheckSum(reply);
 
-  for (int i = 0; i < sizeof(ReplyType); i++)
+  // Confirmation carries new value
+  if ((reply[3] != 0x01) || (reply[4] != WORKING_MODE_CMD[4]))
   {
-    if (WORKING_MODE_REPLY[i] != reply[i])
-    {
 #ifndef NO_TRACES
-      DebugOut("setWorkingMode - Error on byte " + String(i) + " Received byte=" + String(reply[i]) +
-               " Expected byte=" + String(WORKING_MODE_REPLY[i]));
+    DebugOut("setWorkingMode - Error value not confirmed, received " + String(reply[4]));
 #endif
-      return false;
-    }
+    _cache.invalidate(device_id);
+    return false;
   }
+
+  _cache.apply(device_id, replyDeviceId(reply), cache_working_mode, mode);
   return true;
 }
 
@@ -446,6 +440,12 @@ bool NovaSDS011::setWorkingMode(WorkingMode mode, uint16_t device_id)
 WorkingMode NovaSDS011::getWorkingMode(uint16_t device_id)
 {
   ReplyType reply;
+  uint8_t cached;
+
+  if (_cache.get(device_id, cache_working_mode, cached))
+  {
+    return (WorkingMode)cached;
+  }
 
   WORKING_MODE_CMD[3] = 0x00; //Get reporting mode
   WORKING_MODE_CMD[15] = device_id & 0xFF;
@@ -458,46 +458,33 @@ WorkingMode NovaSDS011::getWorkingMode(uint16_t device_id)
   }
   _sdsSerial->flush();
 
-  if (readReply(reply))
+  if (readReply(reply, SDS011_REPLY_COMMAND, SDS011_WORKING_MODE, device_id))
   {
 #ifndef NO_TRACES
     DebugOut("getWorkingMode - Error read reply timeout");
 #endif
+    _cache.invalidate(device_id);
     return WorkingMode::mode_error;
   }
 
-  WORKING_MODE_REPLY[3] = WORKING_MODE_CMD[3]; //Get reporting mode
-  WORKING_MODE_REPLY[4] = reply[4];            //Reporting mode
-  if (device_id != 0xFFFF)
-  {
-    WORKING_MODE_REPLY[6] = WORKING_MODE_CMD[15]; //Device ID byte 1
-    WORKING_MODE_REPLY[7] = WORKING_MODE_CMD[16]; //Device ID byte 2
-  }
-  else
-  {
-    WORKING_MODE_REPLY[6] = reply[6]; //Device ID byte 1
-    WORKING_MODE_REPLY[7] = reply[7]; //Device ID byte 2
-  }
-  WORKING_MODE_REPLY[8] = calculateReplyCheckSum(reply);
-
-  for (int i = 0; i < sizeof(ReplyType); i++)
+  // Reply to query of current value, not confirmation of set
+  if (reply[3] != 0x00)
   {
-    if (WORKING_MODE_REPLY[i] != reply[i])
-    {
 #ifndef NO_TRACES
-      DebugOut("getWorkingMode - Error on byte " + String(i) + " Received byte=" + String(reply[i]) +
-               " Expected byte=" + String(WORKING_MODE_REPLY[i]));
+    DebugOut("getWorkingMode - Error unexpected reply to set command");
 #endif
-      return WorkingMode::mode_error;
-    }
+    _cache.invalidate(device_id);
+    return WorkingMode::mode_error;
   }
 
   if (reply[4] == WorkingMode::mode_sleep)
   {
+    _cache.observe(device_id, replyDeviceId(reply), cache_working_mode, WorkingMode::mode_sleep);
     return WorkingMode::mode_sleep;
   }
-  else if (reply[4] == WorkingMode::work)
+  else if (reply[4] == WorkingMode::mode_work)
   {
+    _cache.observe(device_id, replyDeviceId(reply), cache_working_mode, WorkingMode::mode_work);
     return WorkingMode::mode_work;
   }
   else
@@ -519,6 +506,12 @@ bool NovaSDS011::setDutyCycle(uint8_t duty_cycle, uint16_t device_id)
     return false;
   }
 
+  uint8_t cached;
+  if (_cache.get(device_id, cache_duty_cycle, cached) && (cached == duty_cycle))
+  {
+    return true;
+  }
+
   DUTY_CYCLE_CMD[3] = 0x01; //Set reporting mode
   DUTY_CYCLE_CMD[4] = duty_cycle;
   DUTY_CYCLE_CMD[15] = device_id & 0xFF;
@@ -531,39 +524,26 @@ bool NovaSDS011::setDutyCycle(uint8_t duty_cycle, uint16_t device_id)
   }
   _sdsSerial->flush();
 
-  if (readReply(reply))
+  if (readReply(reply, SDS011_REPLY_COMMAND, SDS011_DUTY_CYCLE, device_id))
   {
 #ifndef NO_TRACES
     DebugOut("setDutyCycle - Error read reply timeout");
 #endif
+    _cache.invalidate(device_id);
     return false;
   }
 
-  DUTY_CYCLE_REPLY[3] = DUTY_CYCLE_CMD[3]; //Set reporting mode
-  DUTY_CYCLE_REPLY[4] = DUTY_CYCLE_CMD[4]; //Reporting mode
-  if (device_id != 0xFFFF)
-  {
-    DUTY_CYCLE_REPLY[6] = DUTY_CYCLE_CMD[15]; //Device ID byte 1
-    DUTY_CYCLE_REPLY[7] = DUTY_CYCLE_CMD[16]; //Device ID byte 2
-  }
-  else
-  {
-    DUTY_CYCLE_REPLY[6] = reply[6]; //Device ID byte 1
-    DUTY_CYCLE_REPLY[7] = reply[7]; //Device ID byte 2
-  }
-  DUTY_CYCLE_REPLY[8] = calculateReplyCheckSum(reply);
-
-  for (int i = 0; i < sizeof(ReplyType); i++)
+  // Confirmation carries new value
+  if ((reply[3] != 0x01) || (reply[4] != DUTY_CYCLE_CMD[4]))
   {
-    if (DUTY_CYCLE_REPLY[i] != reply[i])
-    {
 #ifndef NO_TRACES
-      DebugOut("setDutyCycle - Error on byte " + String(i) + " Received byte=" + String(reply[i]) +
-               " Expected byte=" + String(DUTY_CYCLE_REPLY[i]));
+    DebugOut("setDutyCycle - Error value not confirmed, received " + String(reply[4]));
 #endif
-      return false;
-    }
+    _cache.invalidate(device_id);
+    return false;
   }
+
+  _cache.apply(device_id, replyDeviceId(reply), cache_duty_cycle, duty_cycle);
   return true;
 }
 
@@ -573,6 +553,12 @@ bool NovaSDS011::setDutyCycle(uint8_t duty_cycle, uint16_t device_id)
 uint8_t NovaSDS011::getDutyCycle(uint16_t device_id)
 {
   ReplyType reply;
+  uint8_t cached;
+
+  if (_cache.get(device_id, cache_duty_cycle, cached))
+  {
+    return cached;
+  }
 
   DUTY_CYCLE_CMD[3] = 0x00; //Get reporting mode
   DUTY_CYCLE_CMD[15] = device_id & 0xFF;
@@ -585,38 +571,23 @@ uint8_t NovaSDS011::getDutyCycle(uint16_t device_id)
   }
   _sdsSerial->flush();
 
-  if (readReply(reply))
+  if (readReply(reply, SDS011_REPLY_COMMAND, SDS011_DUTY_CYCLE, device_id))
   {
 #ifndef NO_TRACES
     DebugOut("getDutyCycle - Error read reply timeout");
 #endif
+    _cache.invalidate(device_id);
     return WorkingMode::mode_error;
   }
 
-  DUTY_CYCLE_REPLY[3] = DUTY_CYCLE_CMD[3]; //Get reporting mode
-  DUTY_CYCLE_REPLY[4] = reply[4];          //Reporting mode
-  if (device_id != 0xFFFF)
-  {
-    DUTY_CYCLE_REPLY[6] = DUTY_CYCLE_CMD[15]; //Device ID byte 1
-    DUTY_CYCLE_REPLY[7] = DUTY_CYCLE_CMD[16]; //Device ID byte 2
-  }
-  else
-  {
-    DUTY_CYCLE_REPLY[6] = reply[6]; //Device ID byte 1
-    DUTY_CYCLE_REPLY[7] = reply[7]; //Device ID byte 2
-  }
-  DUTY_CYCLE_REPLY[8] = calculateReplyCheckSum(reply);
-
-  for (int i = 0; i < sizeof(ReplyType); i++)
+  // Reply to query of current value, not confirmation of set
+  if (reply[3] != 0x00)
   {
-    if (DUTY_CYCLE_REPLY[i] != reply[i])
-    {
 #ifndef NO_TRACES
-      DebugOut("getDutyCycle - Error on byte " + String(i) + " Received byte=" + String(reply[i]) +
-               " Expected byte=" + String(DUTY_CYCLE_REPLY[i]));
+    DebugOut("getDutyCycle - Error unexpected reply to set command");
 #endif
-      return WorkingMode::mode_error;
-    }
+    _cache.invalidate(device_id);
+    return WorkingMode::mode_error;
   }
 
   if (reply[4] > 30)
@@ -625,6 +596,7 @@ uint8_t NovaSDS011::getDutyCycle(uint16_t device_id)
   }
   else
   {
+    _cache.observe(device_id, replyDeviceId(reply), cache_duty_cycle, reply[4]);
     return reply[4];
   }
 }
@@ -635,6 +607,12 @@ uint8_t NovaSDS011::getDutyCycle(uint16_t device_id)
 SDS011Version NovaSDS011::getVersionDate(uint16_t device_id)
 {
   ReplyType reply;
+  uint8_t cached[3];
+
+  if (_cache.getVersion(device_id, cached))
+  {
+    return {true, cached[0], cached[1], cached[2]};
+  }
 
   VERSION_CMD[15] = device_id & 0xFF;
   VERSION_CMD[16] = (device_id >> 8) & 0xFF;
@@ -646,40 +624,649 @@ SDS011Version NovaSDS011::getVersionDate(uint16_t device_id)
   }
   _sdsSerial->flush();
 
-  if (readReply(reply))
+  if (readReply(reply, SDS011_REPLY_COMMAND, SDS011_VERSION, device_id))
   {
 #ifndef NO_TRACES
     DebugOut("getVersionDate - Error read reply timeout");
 #endif
+    _cache.invalidate(device_id);
     return {false, 0, 0, 0};
   }
 
-  VERSION_REPLY[3] = reply[3]; //Get reporting mode
-  VERSION_REPLY[4] = reply[4]; //Reporting mode
-  VERSION_REPLY[5] = reply[5]; //Reporting
+  _cache.observeVersion(device_id, replyDeviceId(reply), &reply[3]);
+  return {true, reply[3], reply[4], reply[5]};
+}
+
+// --------------------------------------------------------
+// NovaSDS011:getDeviceID
+// --------------------------------------------------------
+uint16_t NovaSDS011::getDeviceID(uint16_t device_id)
+{
+  uint16_t cached;
+
+  if (!_cache.getDeviceId(device_id, cached))
+  {
+    // Any reply carries device id, version query has no side effects
+    if (!getVersionDate(device_id).valid || !_cache.getDeviceId(device_id, cached))
+    {
+      return 0xFFFF;
+    }
+  }
+  return cached;
+}
+
+// --------------------------------------------------------
+// NovaSDS011:probe
+// --------------------------------------------------------
+SDS011ProbeResult NovaSDS011::probe(uint16_t device_id)
+{
+  SDS011ProbeResult result = {false, 0xFFFF, {false, 0, 0, 0}, DataReportingMode::report_error,
+                              WorkingMode::mode_error, 0xFF, 0};
+  uint8_t *commands[] = {VERSION_CMD, REPORT_TYPE_CMD, WORKING_MODE_CMD, DUTY_CYCLE_CMD};
+  uint8_t received = 0;
+
+  SDS011Deadline start(0);
+  clearSerial();
+  _decoder.reset();
+
+  for (uint8_t step = 0; step < 4; step++)
+  {
+    uint8_t *cmd = commands[step];
+
+    if (cmd != VERSION_CMD)
+    {
+      cmd[3] = 0x00; //Query current value
+    }
+    cmd[15] = device_id & 0xFF;
+    cmd[16] = (device_id >> 8) & 0xFF;
+    cmd[17] = calculateCommandCheckSum(cmd);
+
+    for (uint8_t i = 0; i < 19; i++)
+    {
+      _sdsSerial->write(cmd[i]);
+    }
+    _sdsSerial->flush();
+
+    // Replies of previous steps may still arrive, every decoded frame is used
+    SDS011Deadline deadline(_waitWriteRead);
+    while (!(received & (1 << step)) && !deadline.expired())
+    {
+      if (_sdsSerial->available() > 0)
+      {
+        if (_decoder.push(_sdsSerial->read()))
+        {
+          received |= handleProbeFrame(result, device_id);
+        }
+      }
+      else
+      {
+        yield();
+      }
+    }
+
+    if (received == 0)
+    {
+#ifndef NO_TRACES
+      DebugOut("probe - No reply");
+#endif
+      _cache.invalidate(device_id);
+      break;
+    }
+  }
+
+  result.timeToReady = start.elapsed();
+  result.valid = (received == 0x0F);
+  return result;
+}
+
+// --------------------------------------------------------
+// NovaSDS011:handleProbeFrame
+// --------------------------------------------------------
+uint8_t NovaSDS011::handleProbeFrame(SDS011ProbeResult &result, uint16_t device_id)
+{
+  const ReplyType &frame = _decoder.frame();
+  uint16_t replyId = _decoder.deviceId();
+
+  if ((device_id != 0xFFFF) && (replyId != device_id))
+  {
+    return 0;
+  }
+  result.deviceId = replyId;
+  cacheReply(device_id);
+
+  if (_decoder.command() == SDS011_REPLY_DATA)
+  {
+    // Active mode measurement, device is working
+    result.workingMode = WorkingMode::mode_work;
+    return 0;
+  }
+
+  switch (_decoder.subCommand())
+  {
+  case SDS011_VERSION:
+    result.version = {true, frame[3], frame[4], frame[5]};
+    return 0x01;
+
+  case SDS011_REPORTING_MODE:
+    if ((frame[3] != 0x00) || (frame[4] > DataReportingMode::query))
+    {
+      return 0;
+    }
+    result.reportingMode = (DataReportingMode)frame[4];
+    return 0x02;
+
+  case SDS011_WORKING_MODE:
+    if ((frame[3] != 0x00) || (frame[4] > WorkingMode::mode_work))
+    {
+      return 0;
+    }
+    result.workingMode = (WorkingMode)frame[4];
+    return 0x04;
+
+  case SDS011_DUTY_CYCLE:
+    if ((frame[3] != 0x00) || (frame[4] > 30))
+    {
+      return 0;
+    }
+    result.dutyCycle = frame[4];
+    return 0x08;
+  }
+  return 0;
+}
+
+// --------------------------------------------------------
+// NovaSDS011:cacheReply
+// --------------------------------------------------------
+void NovaSDS011::cacheReply(uint16_t device_id)
+{
+  const ReplyType &frame = _decoder.frame();
+  uint16_t replyId = _decoder.deviceId();
+  SDS011CacheField field;
+  uint8_t limit;
+
+  if (_decoder.command() == SDS011_REPLY_DATA)
+  {
+    _cache.observe(device_id, replyId, cache_working_mode, WorkingMode::mode_work);
+    return;
+  }
+
+  switch (_decoder.subCommand())
+  {
+  case SDS011_VERSION:
+    _cache.observeVersion(device_id, replyId, &frame[3]);
+    return;
+  case SDS011_REPORTING_MODE:
+    field = cache_reporting_mode;
+    limit = DataReportingMode::query;
+    break;
+  case SDS011_WORKING_MODE:
+    field = cache_working_mode;
+    limit = WorkingMode::mode_work;
+    break;
+  case SDS011_DUTY_CYCLE:
+    field = cache_duty_cycle;
+    limit = 30;
+    break;
+  default:
+    return;
+  }
+
+  if (frame[4] > limit)
+  {
+    return;
+  }
+  if (frame[3] == 0x01)
+  {
+    _cache.apply(device_id, replyId, field, frame[4]);
+  }
+  else
+  {
+    _cache.observe(device_id, replyId, field, frame[4]);
+  }
+}
 
-  if (device_id != 0xFFFF)
+// --------------------------------------------------------
+// NovaSDS011:collectReplies
+// --------------------------------------------------------
+uint8_t NovaSDS011::collectReplies(uint8_t sub_command, uint16_t *ids, uint8_t size, bool match_value,
+                                   uint8_t set_value)
+{
+  uint8_t count = 0;
+  SDS011Deadline deadline(_waitWriteRead);
+  SDS011Deadline quiet(BUS_QUIET_TIME);
+
+  // Wait up to _waitWriteRead for first reply, then until nothing arrives for BUS_QUIET_TIME
+  while (!deadline.expired())
   {
-    VERSION_REPLY[6] = VERSION_CMD[15]; //Device ID byte 1
-    VERSION_REPLY[7] = VERSION_CMD[16]; //Device ID byte 2
+    if (_sdsSerial->available() == 0)
+    {
+      if ((count > 0) && quiet.expired())
+      {
+        break;
+      }
+      yield();
+      continue;
+    }
+
+    quiet.start(BUS_QUIET_TIME);
+    if (!_decoder.push(_sdsSerial->read()) || (_decoder.command() != SDS011_REPLY_COMMAND) ||
+        (_decoder.subCommand() != sub_command))
+    {
+      continue;
+    }
+
+    uint16_t replyId = _decoder.deviceId();
+    cacheReply(replyId);
+
+    // Query reply or other value is not confirmation of set
+    const ReplyType &frame = _decoder.frame();
+    if (match_value && ((frame[3] != 0x01) || (frame[4] != set_value)))
+    {
+      continue;
+    }
+
+    bool known = false;
+    for (uint8_t i = 0; i < count; i++)
+    {
+      known |= (ids[i] == replyId);
+    }
+    if (!known && (count < size))
+    {
+      ids[count++] = replyId;
+    }
+  }
+  return count;
+}
+
+// --------------------------------------------------------
+// NovaSDS011:discover
+// --------------------------------------------------------
+uint8_t NovaSDS011::discover()
+{
+  uint16_t ids[SDS011_MAX_DEVICES];
+
+  clearSerial();
+  _decoder.reset();
+  _cache.clear();
+
+  // Sleeping sensors answer only working mode command, query it so they are found too
+  WORKING_MODE_CMD[3] = 0x00; //Query current value
+  sendCommand(WORKING_MODE_CMD, SDS011_BROADCAST_ID);
+
+  uint8_t count = collectReplies(SDS011_WORKING_MODE, ids, SDS011_MAX_DEVICES);
+
+#ifndef NO_TRACES
+  DebugOut("discover - Found " + String(count) + " devices");
+#endif
+
+  // Modes of each working device, unicast so replies can not overlap
+  for (uint8_t i = 0; i < count; i++)
+  {
+    uint8_t mode;
+    if (_cache.get(ids[i], cache_working_mode, mode) && (mode == WorkingMode::mode_sleep))
+    {
+      continue;
+    }
+    probe(ids[i]);
+  }
+  return count;
+}
+
+// --------------------------------------------------------
+// NovaSDS011:saveDevices
+// --------------------------------------------------------
+size_t NovaSDS011::saveDevices(uint8_t *buffer, size_t size) const
+{
+  return _cache.serialize(buffer, size);
+}
+
+// --------------------------------------------------------
+// NovaSDS011:loadDevices
+// --------------------------------------------------------
+bool NovaSDS011::loadDevices(const uint8_t *buffer, size_t size)
+{
+  return _cache.deserialize(buffer, size);
+}
+
+// --------------------------------------------------------
+// NovaSDS011:onSample
+// --------------------------------------------------------
+void NovaSDS011::onSample(SDS011SampleHandler handler, void *context)
+{
+  _sampleHandler = handler;
+  _sampleContext = context;
+}
+
+// --------------------------------------------------------
+// NovaSDS011:onError
+// --------------------------------------------------------
+void NovaSDS011::onError(SDS011ErrorHandler handler, void *context)
+{
+  _errorHandler = handler;
+  _errorContext = context;
+}
+
+// --------------------------------------------------------
+// NovaSDS011:onStateChange
+// --------------------------------------------------------
+void NovaSDS011::onStateChange(SDS011StateHandler handler, void *context)
+{
+  _stateHandler = handler;
+  _stateContext = context;
+}
+
+// --------------------------------------------------------
+// NovaSDS011:requestData
+// --------------------------------------------------------
+bool NovaSDS011::requestData(uint16_t device_id)
+{
+  if (_requestState == RequestState::request_pending)
+  {
+    return false;
+  }
+
+  sendCommand(QUERY_CMD, device_id);
+
+  _requestState = RequestState::request_pending;
+  _requestId = device_id;
+  _requestCommand = SDS011_QUERY_DATA;
+  _requestDeadline.start(_waitWriteRead);
+  return true;
+}
+
+// --------------------------------------------------------
+// NovaSDS011:requestWorkingMode
+// --------------------------------------------------------
+bool NovaSDS011::requestWorkingMode(WorkingMode mode, uint16_t device_id)
+{
+  return requestSet(WORKING_MODE_CMD, cache_working_mode, mode, device_id);
+}
+
+// --------------------------------------------------------
+// NovaSDS011:requestDataReportingMode
+// --------------------------------------------------------
+bool NovaSDS011::requestDataReportingMode(DataReportingMode mode, uint16_t device_id)
+{
+  return requestSet(REPORT_TYPE_CMD, cache_reporting_mode, mode, device_id);
+}
+
+// --------------------------------------------------------
+// NovaSDS011:requestDutyCycle
+// --------------------------------------------------------
+bool NovaSDS011::requestDutyCycle(uint8_t duty_cycle, uint16_t device_id)
+{
+  if (duty_cycle > 30)
+  {
+    return false;
+  }
+  return requestSet(DUTY_CYCLE_CMD, cache_duty_cycle, duty_cycle, device_id);
+}
+
+// --------------------------------------------------------
+// NovaSDS011:requestSet
+// --------------------------------------------------------
+bool NovaSDS011::requestSet(uint8_t *cmd, SDS011CacheField field, uint8_t value, uint16_t device_id)
+{
+  uint8_t cached;
+
+  if (_requestState == RequestState::request_pending)
+  {
+    return false;
+  }
+
+  _requestId = device_id;
+  _requestCommand = cmd[2];
+  _requestValue = value;
+
+  if (_cache.get(device_id, field, cached) && (cached == value))
+  {
+    _requestState = RequestState::request_done;
+    return true;
+  }
+
+  cmd[3] = 0x01; //Set value
+  cmd[4] = value;
+  sendCommand(cmd, device_id);
+
+  _requestState = RequestState::request_pending;
+  _requestDeadline.start(_waitWriteRead);
+  return true;
+}
+
+// --------------------------------------------------------
+// NovaSDS011:completeRequest
+// --------------------------------------------------------
+void NovaSDS011::completeRequest()
+{
+  const ReplyType &frame = _decoder.frame();
+
+  if (_requestCommand == SDS011_QUERY_DATA)
+  {
+    if (_decoder.command() != SDS011_REPLY_DATA)
+    {
+      return;
+    }
   }
   else
   {
-    VERSION_REPLY[6] = reply[6]; //Device ID byte 1
-    VERSION_REPLY[7] = reply[7]; //Device ID byte 2
+    if ((_decoder.command() != SDS011_REPLY_COMMAND) || (_decoder.subCommand() != _requestCommand) ||
+        (frame[3] != 0x01))
+    {
+      return;
+    }
+
+    // Confirmation carries new value
+    if (frame[4] != _requestValue)
+    {
+#ifndef NO_TRACES
+      DebugOut("completeRequest - Error value not confirmed, received " + String(frame[4]));
+#endif
+      _cache.invalidate(_requestId);
+      _requestState = RequestState::request_failed;
+      return;
+    }
+
+    // Reply was cached under its own id, broadcast entry is updated here
+    if (_requestId != _decoder.deviceId())
+    {
+      cacheReply(_requestId);
+    }
+  }
+
+  for (uint8_t i = 0; i < sizeof(ReplyType); i++)
+  {
+    _requestReply[i] = frame[i];
+  }
+  _requestState = RequestState::request_done;
+}
+
+// --------------------------------------------------------
+// NovaSDS011:service
+// --------------------------------------------------------
+uint8_t NovaSDS011::service()
+{
+  uint8_t events = 0;
+
+  while (_sdsSerial->available() > 0)
+  {
+    if (_decoder.push(_sdsSerial->read()))
+    {
+      events += dispatchFrame();
+    }
+  }
+
+  if (_decoder.checksumErrors() != _checksumErrors)
+  {
+    _checksumErrors = _decoder.checksumErrors();
+    if (_errorHandler != NULL)
+    {
+      _errorHandler(_errorContext, SDS011_BROADCAST_ID, QuerryError::response_error);
+      events++;
+    }
   }
-  VERSION_REPLY[8] = calculateReplyCheckSum(reply);
 
-  for (int i = 0; i < sizeof(ReplyType); i++)
+  if ((_requestState == RequestState::request_pending) && _requestDeadline.expired())
   {
-    if (VERSION_REPLY[i] != reply[i])
+    _cache.invalidate(_requestId);
+
+    // Same as setWorkingMode(), sensor may fall asleep without confirmation
+    if ((_requestCommand == SDS011_WORKING_MODE) && (_requestValue == WorkingMode::mode_sleep))
     {
+      _requestState = RequestState::request_done;
+      return events;
+    }
+
 #ifndef NO_TRACES
-      DebugOut("getVersionDate - Error on byte " + String(i) + " Received byte=" + String(reply[i]) +
-               " Expected byte=" + String(VERSION_REPLY[i]));
+    DebugOut("service - Error read reply timeout");
 #endif
-      return {false, 0, 0, 0};
+    _requestState = RequestState::request_failed;
+    if (_errorHandler != NULL)
+    {
+      _errorHandler(_errorContext, _requestId, QuerryError::response_error);
+      events++;
+    }
+  }
+  return events;
+}
+
+// --------------------------------------------------------
+// NovaSDS011:dispatchFrame
+// --------------------------------------------------------
+uint8_t NovaSDS011::dispatchFrame()
+{
+  const ReplyType &frame = _decoder.frame();
+  uint16_t replyId = _decoder.deviceId();
+  uint8_t events = 0;
+  uint8_t before;
+  uint8_t after;
+  uint16_t id;
+
+  // New device or known mode changed, mode forgotten after error is not a change
+  bool known = _cache.get(replyId, cache_working_mode, before);
+  bool seen = _cache.getDeviceId(replyId, id);
+  cacheReply(replyId);
+
+  if ((_stateHandler != NULL) && _cache.get(replyId, cache_working_mode, after) &&
+      (known ? (before != after) : !seen))
+  {
+    _stateHandler(_stateContext, replyId, (WorkingMode)after);
+    events++;
+  }
+
+  if ((_requestState == RequestState::request_pending) &&
+      ((_requestId == replyId) || (_requestId == SDS011_BROADCAST_ID)))
+  {
+    completeRequest();
+  }
+
+  if (_decoder.command() != SDS011_REPLY_DATA)
+  {
+    return events;
+  }
+
+  if (_sampleHandler != NULL)
+  {
+    _sampleHandler(_sampleContext, replyId, frame[2] | (frame[3] << 8), frame[4] | (frame[5] << 8), SDS011Clock::millis());
+    events++;
+  }
+  return events;
+}
+
+// --------------------------------------------------------
+// NovaSDS011:sendCommand
+// --------------------------------------------------------
+void NovaSDS011::sendCommand(uint8_t *cmd, uint16_t device_id)
+{
+  cmd[15] = device_id & 0xFF;
+  cmd[16] = (device_id >> 8) & 0xFF;
+  cmd[17] = calculateCommandCheckSum(cmd);
+
+  for (uint8_t i = 0; i < 19; i++)
+  {
+    _sdsSerial->write(cmd[i]);
+  }
+  _sdsSerial->flush();
+}
+
+// --------------------------------------------------------
+// NovaSDS011:broadcastSet
+// --------------------------------------------------------
+SDS011AckSet NovaSDS011::broadcastSet(uint8_t *cmd, uint8_t value, bool retry_missing)
+{
+  SDS011AckSet acks;
+  acks.missingCount = 0;
+
+  clearSerial();
+  _decoder.reset();
+
+  cmd[3] = 0x01; //Set value
+  cmd[4] = value;
+  sendCommand(cmd, SDS011_BROADCAST_ID);
+
+  // Replies of all devices, overlapping frames are dropped by decoder
+  acks.count = collectReplies(cmd[2], acks.acked, SDS011_MAX_DEVICES, true, value);
+
+  for (uint8_t i = 0; i < _cache.count(); i++)
+  {
+    uint16_t id = _cache.at(i).key;
+    if ((id == SDS011_BROADCAST_ID) || acks.contains(id))
+    {
+      continue;
+    }
+
+    uint16_t confirmed;
+    if (retry_missing)
+    {
+      sendCommand(cmd, id);
+      if ((collectReplies(cmd[2], &confirmed, 1, true, value) == 1) && (confirmed == id) &&
+          (acks.count < SDS011_MAX_DEVICES))
+      {
+        acks.acked[acks.count++] = id;
+        continue;
+      }
     }
+
+    // State of device is unknown, command may have been applied or not
+#ifndef NO_TRACES
+    DebugOut("broadcastSet - No confirmation from " + String(id));
+#endif
+    _cache.invalidate(id);
+    acks.missing[acks.missingCount++] = id;
+  }
+
+  return acks;
+}
+
+// --------------------------------------------------------
+// NovaSDS011:broadcastWorkingMode
+// --------------------------------------------------------
+SDS011AckSet NovaSDS011::broadcastWorkingMode(WorkingMode mode, bool retry_missing)
+{
+  return broadcastSet(WORKING_MODE_CMD, mode, retry_missing);
+}
+
+// --------------------------------------------------------
+// NovaSDS011:broadcastDataReportingMode
+// --------------------------------------------------------
+SDS011AckSet NovaSDS011::broadcastDataReportingMode(DataReportingMode mode, bool retry_missing)
+{
+  return broadcastSet(REPORT_TYPE_CMD, mode, retry_missing);
+}
+
+// --------------------------------------------------------
+// NovaSDS011:broadcastDutyCycle
+// --------------------------------------------------------
+SDS011AckSet NovaSDS011::broadcastDutyCycle(uint8_t duty_cycle, bool retry_missing)
+{
+  if (duty_cycle > 30)
+  {
+#ifndef NO_TRACES
+    DebugOut("broadcastDutyCycle - Duty cycle out of range " + String(duty_cycle));
+#endif
+    SDS011AckSet acks;
+    acks.count = 0;
+    acks.missingCount = 0;
+    return acks;
   }
-  return {true, VERSION_REPLY[3], VERSION_REPLY[4], VERSION_REPLY[5]};
+  return broadcastSet(DUTY_CYCLE_CMD, duty_cycle, retry_missing);
 }
@@ -18,12 +18,12 @@
 #endif
 
 #include <SoftwareSerial.h>
+#include "SDS011Clock.h"
+#include "SDS011DeviceCache.h"
+#include "SDS011Frame.h"
 
 #define NO_TRACES 
 
-typedef uint8_t CommandType[19];
-typedef uint8_t ReplyType[10];
-
 enum DataReportingMode
 {
 	active = 0,
@@ -46,6 +46,14 @@ enum WorkingMode
 	mode_error = 0xFF
 };
 
+enum RequestState
+{
+	request_idle = 0,
+	request_pending = 1,
+	request_done = 2,
+	request_failed = 3
+};
+
 struct SDS011Version
 {
 	bool valid;
@@ -54,6 +62,44 @@ struct SDS011Version
 	uint8_t day;
 };
 
+struct SDS011ProbeResult
+{
+	bool valid;                      // all queries answered
+	uint16_t deviceId;               // id reported by sensor, 0xFFFF if none answered
+	SDS011Version version;
+	DataReportingMode reportingMode;
+	WorkingMode workingMode;
+	uint8_t dutyCycle;               // 0xFF if unknown
+	uint16_t timeToReady;            // ms from first command to last reply
+};
+
+struct SDS011AckSet
+{
+	uint8_t count;                         // devices which confirmed new value
+	uint16_t acked[SDS011_MAX_DEVICES];
+	uint8_t missingCount;                  // known devices which did not confirm it
+	uint16_t missing[SDS011_MAX_DEVICES];
+
+	bool contains(uint16_t device_id) const
+	{
+		for (uint8_t i = 0; i < count; i++)
+		{
+			if (acked[i] == device_id)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+/**
+ * Handlers of events dispatched by NovaSDS011::service().
+ * context is pointer given when handler was registered.
+ */
+typedef void (*SDS011SampleHandler)(void *context, uint16_t device_id, uint16_t pm25, uint16_t pm10, uint32_t timestamp);
+typedef void (*SDS011ErrorHandler)(void *context, uint16_t device_id, QuerryError error);
+typedef void (*SDS011StateHandler)(void *context, uint16_t device_id, WorkingMode mode);
 
 class NovaSDS011
 {
@@ -71,6 +117,14 @@ public:
 		*/
 	void begin(uint8_t pin_rx, uint8_t pin_tx, uint16_t wait_write_read = 500);
 
+	/**
+		* Initialize communication via already started serial port.
+		* Use for hardware serial or to put SDS011CaptureTap between driver and port.
+		* @param serial serial port configured to 9600 baud
+		* @param wait_write_read Max time in ms to wait for response after sending command to sensor.
+		*/
+	void begin(Stream &serial, uint16_t wait_write_read = 500);
+
 	/**
 		* Set report mode to specific device or to all devices connected to bus.
 		* Report query mode：Sensor received query data command to report the measurement data.
@@ -100,6 +154,17 @@ public:
 		*/
 	QuerryError queryData(float &PM25, float &PM10, uint16_t device_id = 0xFFFF);
 
+	/**
+		* Send query to sensor asking for measurement data.
+		* Same as queryData with float output but returns raw sensor values,
+		* suitable for integer processing (e.g. SDS011QuantileSketch).
+		* @param [out] PM25 value of PM2.5 particles in tenths of μg/m3
+		* @param [out] PM10 value of PM10 particles in tenths of μg/m3
+		* @param device_id device id (optional)
+		* @return QuerryError
+		*/
+	QuerryError queryData(uint16_t &PM25, uint16_t &PM10, uint16_t device_id = 0xFFFF);
+
 
 	/**
 		* Set new device ID to specific device or to all devices connected to bus.
@@ -148,6 +213,183 @@ public:
 		* @return SDS011Version valid is false if error occurs
 		*/
 	SDS011Version getVersionDate(uint16_t device_id = 0xFFFF);
+
+	/**
+		* Get device id of specific device or of device answering broadcast.
+		* @param device_id device id (optional)
+		* @return uint16_t device id, 0xFFFF if error occurs
+		*/
+	uint16_t getDeviceID(uint16_t device_id = 0xFFFF);
+
+	/**
+		* Read complete state of device in one go.
+		* Version, reporting mode, working mode and duty cycle are queried back to back,
+		* next query is sent as soon as reply of previous one is decoded. Replies are
+		* matched by command, so unrelated frames (e.g. active mode data) do not break probe.
+		* Stops early if device does not answer first query.
+		* @param device_id device id (optional)
+		* @return SDS011ProbeResult valid is false if any query was not answered
+		*/
+	SDS011ProbeResult probe(uint16_t device_id = 0xFFFF);
+
+	/**
+		* Find all devices connected to bus.
+		* Broadcast working mode query is sent (sleeping devices answer it too) and replies
+		* are collected until bus is quiet, then every working device is probed. Sleeping
+		* devices are in table with their working mode only. Device table is replaced by result.
+		* @return number of devices found (up to SDS011_MAX_DEVICES)
+		*/
+	uint8_t discover();
+
+	/**
+		* Set working mode of all devices with one broadcast and collect confirmations.
+		* Replies are gathered until bus is quiet and decoded one by one, devices from
+		* device table (see discover()) which did not confirm are retried by unicast.
+		* Some firmware does not confirm going to sleep.
+		* @param mode new mode
+		* @param retry_missing send unicast command to known devices without confirmation
+		* @return SDS011AckSet devices which confirmed and known devices which did not
+		*/
+	SDS011AckSet broadcastWorkingMode(WorkingMode mode, bool retry_missing = true);
+
+	/**
+		* Set reporting mode of all devices with one broadcast and collect confirmations.
+		* @param mode new mode
+		* @param retry_missing send unicast command to known devices without confirmation
+		* @return SDS011AckSet devices which confirmed and known devices which did not
+		*/
+	SDS011AckSet broadcastDataReportingMode(DataReportingMode mode, bool retry_missing = true);
+
+	/**
+		* Set duty cycle of all devices with one broadcast and collect confirmations.
+		* @param duty_cycle 0 continuous, 1-30 minutes
+		* @param retry_missing send unicast command to known devices without confirmation
+		* @return SDS011AckSet devices which confirmed and known devices which did not,
+		*         both empty if duty_cycle is out of range (nothing is sent)
+		*/
+	SDS011AckSet broadcastDutyCycle(uint8_t duty_cycle, bool retry_missing = true);
+
+	/**
+		* Get table of known devices with their cached configuration.
+		* @return device table
+		*/
+	const SDS011DeviceCache &devices() const { return _cache; }
+
+	/**
+		* Write device table to buffer so later boots can skip discover().
+		* @param [out] buffer output buffer, SDS011DeviceCache::MAX_SERIALIZED_SIZE is enough
+		* @param size size of buffer
+		* @return number of bytes written, 0 if buffer is too small
+		*/
+	size_t saveDevices(uint8_t *buffer, size_t size) const;
+
+	/**
+		* Restore device table written by saveDevices().
+		* @param buffer input buffer
+		* @param size number of bytes in buffer
+		* @return true if buffer was valid
+		*/
+	bool loadDevices(const uint8_t *buffer, size_t size);
+
+	/**
+		* Forget cached configuration of device.
+		* Getters answer from cache and setters skip commands which would not change
+		* anything. Cache is invalidated on errors, call this after power cycling sensor.
+		* @param device_id device id (optional), 0xFFFF forgets all devices
+		*/
+	void invalidateCache(uint16_t device_id = 0xFFFF);
+
+	/**
+		* Register handler called for every measurement, in active mode
+		* or as reply to requestData(). PM values are in tenths of μg/m3,
+		* timestamp is SDS011Clock::millis() when frame was decoded.
+		* @param handler function, NULL to unregister
+		* @param context passed to handler
+		*/
+	void onSample(SDS011SampleHandler handler, void *context = NULL);
+
+	/**
+		* Register handler called when frame with bad checksum arrives (device id 0xFFFF)
+		* or when device does not answer request in time (response_error).
+		* @param handler function, NULL to unregister
+		* @param context passed to handler
+		*/
+	void onError(SDS011ErrorHandler handler, void *context = NULL);
+
+	/**
+		* Register handler called when observed working mode of device changes,
+		* e.g. measurements arrive from device which was put to sleep.
+		* @param handler function, NULL to unregister
+		* @param context passed to handler
+		*/
+	void onStateChange(SDS011StateHandler handler, void *context = NULL);
+
+	/**
+		* Send query for measurement data without waiting for reply.
+		* Reply is delivered by service() to sample handler.
+		* @param device_id device id (optional)
+		* @return false if previous request is still waiting for reply
+		*/
+	bool requestData(uint16_t device_id = 0xFFFF);
+
+	/**
+		* Send set command without waiting for confirmation.
+		* Completion is reported by requestState() after service(),
+		* unchanged cached value completes request immediately.
+		* @param mode new working mode
+		* @param device_id device id (optional)
+		* @return false if previous request is still waiting for reply
+		*/
+	bool requestWorkingMode(WorkingMode mode, uint16_t device_id = 0xFFFF);
+
+	/**
+		* Send set command without waiting for confirmation, see requestWorkingMode().
+		* @param mode new data reporting mode
+		* @param device_id device id (optional)
+		* @return false if previous request is still waiting for reply
+		*/
+	bool requestDataReportingMode(DataReportingMode mode, uint16_t device_id = 0xFFFF);
+
+	/**
+		* Send set command without waiting for confirmation, see requestWorkingMode().
+		* @param duty_cycle new duty cycle in minutes (0-30)
+		* @param device_id device id (optional)
+		* @return false if previous request is still waiting for reply or duty_cycle is out of range
+		*/
+	bool requestDutyCycle(uint8_t duty_cycle, uint16_t device_id = 0xFFFF);
+
+	/**
+		* Get state of last request sent by requestData() or request setters.
+		* request_failed means timeout or value not confirmed.
+		* @return RequestState
+		*/
+	RequestState requestState() const { return _requestState; }
+
+	/**
+		* Get reply which completed last request, e.g. measurement for requestData().
+		* Valid only when requestState() is request_done and command was sent.
+		* @return reply frame
+		*/
+	const ReplyType &requestReply() const { return _requestReply; }
+
+	/**
+		* Decode bytes received so far and dispatch events, never waits.
+		* Call it from loop().
+		* @return number of dispatched events
+		*/
+	uint8_t service();
+
+	/**
+		* Get time from command to complete reply of last blocking transaction.
+		* @return latency in μs
+		*/
+	uint32_t replyLatency() const { return _replyLatency; }
+
+	/**
+		* Get receive statistics: valid frames, checksum errors and bytes skipped to resync.
+		* @return decoder
+		*/
+	const SDS011FrameDecoder &decoder() const { return _decoder; }
 	
 private:
 	void clearSerial();
@@ -161,21 +403,80 @@ private:
 	uint8_t calculateCommandCheckSum(CommandType cmd);
 
 	/**
-		* Calculate checksum from given reply.
-		* Checksum: Low 8bit of the sum result of Data Bytes（not including packet head, tail and
-		* Command ID).
-		* @param cmd input reply
-		* @return checksum value
+		* Wait up to _waitWriteRead ms for valid reply and copy it into &reply.
+		* Head, command id, sub-command echo, checksum and tail are checked by
+		* decoder as bytes arrive, frames of other devices are skipped.
+		* @param [out] reply place for reply
+		* @param command SDS011_REPLY_DATA or SDS011_REPLY_COMMAND
+		* @param sub_command expected data byte 1 of SDS011_REPLY_COMMAND, 0 for any
+		* @param device_id expected device id, 0xFFFF for any
+		* @return if timeout
 		*/
-	uint8_t calculateReplyCheckSum(ReplyType reply);
+	bool readReply(ReplyType &reply, uint8_t command, uint8_t sub_command, uint16_t device_id);
 
 	/**
-		* Wait up to _waitWriteRead ms for reply to arrive and read it into &reply. 
-		* Command ID).
-		* @param [out] reply place for reply
-		* @return if timeout
+		* Store configuration carried by last decoded frame in cache.
+		* @param device_id device id used in command
 		*/
-	bool readReply(ReplyType &reply);
+	void cacheReply(uint16_t device_id);
+
+	/**
+		* Collect replies to broadcast command until bus is quiet.
+		* Every reply is stored in cache.
+		* @param sub_command data byte 1 of expected replies
+		* @param [out] ids distinct device ids which replied
+		* @param size size of ids
+		* @param match_value count only replies confirming set of set_value, otherwise any reply
+		* @param set_value value which replies must confirm
+		* @return number of distinct devices which replied
+		*/
+	uint8_t collectReplies(uint8_t sub_command, uint16_t *ids, uint8_t size, bool match_value = false,
+	                       uint8_t set_value = 0);
+
+	/**
+		* Send set command to all devices and gather confirmations.
+		* @param cmd command template
+		* @param value new value
+		* @param retry_missing send unicast command to known devices without confirmation
+		* @return SDS011AckSet
+		*/
+	SDS011AckSet broadcastSet(uint8_t *cmd, uint8_t value, bool retry_missing);
+
+	/**
+		* Send set command without waiting for confirmation.
+		* @param cmd command template
+		* @param field cached register
+		* @param value new value
+		* @param device_id device id
+		* @return false if previous request is still waiting for reply
+		*/
+	bool requestSet(uint8_t *cmd, SDS011CacheField field, uint8_t value, uint16_t device_id);
+
+	/**
+		* Finish pending request if last decoded frame answers it.
+		*/
+	void completeRequest();
+
+	/**
+		* Send command to device.
+		* @param cmd command template, device id and checksum are filled in
+		* @param device_id device id
+		*/
+	void sendCommand(uint8_t *cmd, uint16_t device_id);
+
+	/**
+		* Fill probe result and cache from last decoded frame.
+		* @param [out] result probe result
+		* @param device_id device id used in queries
+		* @return bit of probe step answered by frame, 0 if none
+		*/
+	uint8_t handleProbeFrame(SDS011ProbeResult &result, uint16_t device_id);
+
+	/**
+		* Dispatch events of last decoded frame.
+		* @return number of dispatched events
+		*/
+	uint8_t dispatchFrame();
 
 	void DebugOut(const String &text, bool linebreak = true);
 
@@ -193,4 +494,45 @@ private:
 		* Current state of SDS011 sensor.
 		*/
 	Stream *_sdsSerial;
+
+	/**
+		* Last confirmed configuration of devices.
+		*/
+	SDS011DeviceCache _cache;
+
+	/**
+		* Decoder of incoming replies.
+		*/
+	SDS011FrameDecoder _decoder;
+
+	/**
+		* Registered event handlers.
+		*/
+	SDS011SampleHandler _sampleHandler = NULL;
+	void *_sampleContext = NULL;
+	SDS011ErrorHandler _errorHandler = NULL;
+	void *_errorContext = NULL;
+	SDS011StateHandler _stateHandler = NULL;
+	void *_stateContext = NULL;
+
+	/**
+		* Last request sent by requestData() or request setters.
+		*/
+	RequestState _requestState = RequestState::request_idle;
+	uint16_t _requestId = 0xFFFF;
+	uint8_t _requestCommand = 0;
+	uint8_t _requestValue = 0;
+	ReplyType _requestReply = {0};
+	SDS011Deadline _requestDeadline;
+	uint32_t _checksumErrors = 0;
+
+	/**
+		* Minimal interval between queryData() calls.
+		*/
+	SDS011Deadline _queryInterval;
+
+	/**
+		* Time in μs from command to complete reply of last blocking transaction.
+		*/
+	uint32_t _replyLatency = 0;
 };
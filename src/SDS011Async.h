@@ -0,0 +1,453 @@
+/**
+ * @file SDS011Async.h
+ * @brief Coroutine API on top of non blocking requests.
+ *
+ * Sequences of sensor operations (wake, warm-up, set mode, query, sleep)
+ * are written as C++20 coroutines instead of hand made state machines:
+ * co_await sds.setWorkingMode(...), co_await SDS011Scheduler::sleepFor(...),
+ * co_await sds.query(id). Single threaded scheduler services drivers and
+ * resumes coroutines whose request or sleep completed. Suspended coroutine
+ * keeps only its frame (allocated from heap when task is created), there is
+ * no stack per task, so one thread runs scripts for hundreds of sensors.
+ * Header is empty unless compiler supports coroutines (Linux, ESP32 with C++20).
+ */
+
+#pragma once
+
+#include "NovaSDS011.h"
+
+#if defined(__cpp_impl_coroutine)
+
+#include <coroutine>
+#include <stdlib.h>
+
+class SDS011Task;
+class SDS011Scheduler;
+class SDS011AsyncSensor;
+
+struct SDS011QueryResult
+{
+	bool valid;
+	uint16_t deviceId;  // id of device which replied
+	uint16_t pm25;      // tenths of μg/m3
+	uint16_t pm10;      // tenths of μg/m3
+};
+
+/**
+ * Suspension point polled by scheduler.
+ */
+class SDS011Awaiter
+{
+public:
+	/**
+		* Check if suspended coroutine can continue.
+		* @return true to resume it
+		*/
+	virtual bool poll() = 0;
+
+	/**
+		* Always suspend, work starts on next scheduler pass so waiting tasks keep their order.
+		*/
+	bool await_ready() const { return false; }
+
+protected:
+	/**
+		* Put coroutine on wait list of its scheduler.
+		*/
+	void suspend(std::coroutine_handle<> handle, SDS011Scheduler &scheduler);
+
+	friend class SDS011Scheduler;
+
+	std::coroutine_handle<> _handle;
+	SDS011Awaiter *_next = nullptr;
+};
+
+/**
+ * Coroutine run by SDS011Scheduler, can be spawned or awaited by other task.
+ */
+class SDS011Task
+{
+public:
+	struct promise_type;
+
+	struct FinalAwaiter
+	{
+		bool await_ready() const noexcept { return false; }
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept;
+		void await_resume() const noexcept {}
+	};
+
+	struct promise_type
+	{
+		SDS011Scheduler *scheduler = nullptr;
+		std::coroutine_handle<> continuation;
+
+		SDS011Task get_return_object() { return SDS011Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+		std::suspend_always initial_suspend() const noexcept { return {}; }
+		FinalAwaiter final_suspend() const noexcept { return {}; }
+		void return_void() const {}
+		void unhandled_exception() const { abort(); }
+	};
+
+	SDS011Task(SDS011Task &&other) : _handle(other._handle) { other._handle = nullptr; }
+	SDS011Task(const SDS011Task &) = delete;
+	SDS011Task &operator=(const SDS011Task &) = delete;
+
+	~SDS011Task()
+	{
+		if (_handle)
+		{
+			_handle.destroy();
+		}
+	}
+
+	/**
+		* Run task as part of awaiting one, it continues when task returns.
+		*/
+	bool await_ready() const { return !_handle || _handle.done(); }
+
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> parent)
+	{
+		_handle.promise().scheduler = parent.promise().scheduler;
+		_handle.promise().continuation = parent;
+		return _handle;
+	}
+
+	void await_resume() const {}
+
+private:
+	friend class SDS011Scheduler;
+
+	explicit SDS011Task(std::coroutine_handle<promise_type> handle) : _handle(handle) {}
+
+	std::coroutine_handle<promise_type> _handle;
+};
+
+/**
+ * Wait for given time.
+ */
+class SDS011SleepAwaiter : public SDS011Awaiter
+{
+public:
+	explicit SDS011SleepAwaiter(uint32_t timeout) : _deadline(timeout) {}
+
+	bool poll() override { return _deadline.expired(); }
+
+	void await_suspend(std::coroutine_handle<SDS011Task::promise_type> handle)
+	{
+		suspend(handle, *handle.promise().scheduler);
+	}
+
+	void await_resume() const {}
+
+private:
+	SDS011Deadline _deadline;
+};
+
+/**
+ * Wait for request slot of driver, send request and wait for its completion.
+ */
+class SDS011RequestAwaiter : public SDS011Awaiter
+{
+public:
+	SDS011RequestAwaiter(SDS011AsyncSensor &sensor, uint8_t command, uint8_t value, uint16_t device_id)
+	    : _sensor(sensor), _command(command), _value(value), _deviceId(device_id)
+	{
+	}
+
+	bool poll() override;
+
+	void await_suspend(std::coroutine_handle<SDS011Task::promise_type> handle)
+	{
+		suspend(handle, *handle.promise().scheduler);
+	}
+
+protected:
+	bool send();
+
+	SDS011AsyncSensor &_sensor;
+	uint8_t _command;
+	uint8_t _value;
+	uint16_t _deviceId;
+	bool _sent = false;
+	RequestState _state = RequestState::request_idle;
+	ReplyType _reply = {0};
+};
+
+class SDS011QueryAwaiter : public SDS011RequestAwaiter
+{
+public:
+	using SDS011RequestAwaiter::SDS011RequestAwaiter;
+
+	SDS011QueryResult await_resume() const
+	{
+		if (_state != RequestState::request_done)
+		{
+			return {false, 0xFFFF, 0, 0};
+		}
+		return {true, (uint16_t)(_reply[6] | (_reply[7] << 8)), (uint16_t)(_reply[2] | (_reply[3] << 8)),
+		        (uint16_t)(_reply[4] | (_reply[5] << 8))};
+	}
+};
+
+class SDS011SetAwaiter : public SDS011RequestAwaiter
+{
+public:
+	using SDS011RequestAwaiter::SDS011RequestAwaiter;
+
+	/**
+		* @return true if device confirmed new value
+		*/
+	bool await_resume() const { return _state == RequestState::request_done; }
+};
+
+class SDS011Scheduler
+{
+public:
+	/**
+		* Start task, it runs until its first co_await.
+		* Scheduler owns task and frees it when it returns.
+		* @param task coroutine returning SDS011Task
+		*/
+	void spawn(SDS011Task task)
+	{
+		std::coroutine_handle<SDS011Task::promise_type> handle = task._handle;
+		task._handle = nullptr;
+		handle.promise().scheduler = this;
+		_tasks++;
+		handle.resume();
+	}
+
+	/**
+		* Service drivers and resume tasks which can continue, never waits.
+		* Call it from loop().
+		* @return number of resumed tasks
+		*/
+	uint16_t update();
+
+	/**
+		* Call update() until all tasks returned.
+		*/
+	void run()
+	{
+		while (_tasks > 0)
+		{
+			if (update() == 0)
+			{
+				yield();
+			}
+		}
+	}
+
+	/**
+		* Get number of running tasks.
+		* @return count
+		*/
+	uint16_t count() const { return _tasks; }
+
+	/**
+		* Suspend task, e.g. co_await SDS011Scheduler::sleepFor(30000).
+		* @param timeout time in ms, 0 lets other tasks run
+		* @return awaiter
+		*/
+	static SDS011SleepAwaiter sleepFor(uint32_t timeout) { return SDS011SleepAwaiter(timeout); }
+
+private:
+	friend class SDS011Awaiter;
+	friend class SDS011AsyncSensor;
+	friend struct SDS011Task::FinalAwaiter;
+
+	void wait(SDS011Awaiter &awaiter)
+	{
+		awaiter._next = nullptr;
+		if (_tail != nullptr)
+		{
+			_tail->_next = &awaiter;
+		}
+		else
+		{
+			_head = &awaiter;
+		}
+		_tail = &awaiter;
+	}
+
+	SDS011Awaiter *_head = nullptr;
+	SDS011Awaiter *_tail = nullptr;
+	SDS011AsyncSensor *_sensors = nullptr;
+	uint16_t _tasks = 0;
+};
+
+/**
+ * Awaitable operations of driver. One request is in flight per driver,
+ * tasks sharing bus (different device ids) take turns in order of arrival.
+ */
+class SDS011AsyncSensor
+{
+public:
+	/**
+		* Constructor, driver is serviced by scheduler from now on.
+		* @param scheduler scheduler running tasks which use sensor
+		* @param driver initialized driver
+		*/
+	SDS011AsyncSensor(SDS011Scheduler &scheduler, NovaSDS011 &driver) : _driver(driver)
+	{
+		_next = scheduler._sensors;
+		scheduler._sensors = this;
+	}
+
+	/**
+		* Query measurement, e.g. SDS011QueryResult result = co_await sds.query(id).
+		* @param device_id device id (optional)
+		* @return awaiter, result is not valid on timeout
+		*/
+	SDS011QueryAwaiter query(uint16_t device_id = 0xFFFF)
+	{
+		return SDS011QueryAwaiter(*this, SDS011_QUERY_DATA, 0, device_id);
+	}
+
+	/**
+		* Set working mode, e.g. bool ok = co_await sds.setWorkingMode(WorkingMode::mode_work).
+		* @param mode new working mode
+		* @param device_id device id (optional)
+		* @return awaiter, result is true if device confirmed new value
+		*/
+	SDS011SetAwaiter setWorkingMode(WorkingMode mode, uint16_t device_id = 0xFFFF)
+	{
+		return SDS011SetAwaiter(*this, SDS011_WORKING_MODE, mode, device_id);
+	}
+
+	/**
+		* Set data reporting mode, see setWorkingMode().
+		*/
+	SDS011SetAwaiter setDataReportingMode(DataReportingMode mode, uint16_t device_id = 0xFFFF)
+	{
+		return SDS011SetAwaiter(*this, SDS011_REPORTING_MODE, mode, device_id);
+	}
+
+	/**
+		* Set duty cycle in minutes (0-30), see setWorkingMode().
+		* Other values are not sent, awaiter returns false.
+		*/
+	SDS011SetAwaiter setDutyCycle(uint8_t duty_cycle, uint16_t device_id = 0xFFFF)
+	{
+		return SDS011SetAwaiter(*this, SDS011_DUTY_CYCLE, duty_cycle, device_id);
+	}
+
+	/**
+		* Get driver, e.g. for event handlers or statistics.
+		*/
+	NovaSDS011 &driver() { return _driver; }
+
+private:
+	friend class SDS011Scheduler;
+	friend class SDS011RequestAwaiter;
+
+	NovaSDS011 &_driver;
+	SDS011Awaiter *_owner = nullptr;  // request in flight
+	SDS011AsyncSensor *_next;
+};
+
+inline void SDS011Awaiter::suspend(std::coroutine_handle<> handle, SDS011Scheduler &scheduler)
+{
+	_handle = handle;
+	scheduler.wait(*this);
+}
+
+inline std::coroutine_handle<> SDS011Task::FinalAwaiter::await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+{
+	promise_type &promise = handle.promise();
+	if (promise.continuation)
+	{
+		return promise.continuation;
+	}
+
+	// Spawned task, nobody waits for it
+	promise.scheduler->_tasks--;
+	handle.destroy();
+	return std::noop_coroutine();
+}
+
+inline uint16_t SDS011Scheduler::update()
+{
+	uint16_t resumed = 0;
+
+	for (SDS011AsyncSensor *sensor = _sensors; sensor != nullptr; sensor = sensor->_next)
+	{
+		sensor->_driver.service();
+	}
+
+	// Tasks suspended while this pass runs wait for next one
+	SDS011Awaiter *awaiter = _head;
+	_head = nullptr;
+	_tail = nullptr;
+	while (awaiter != nullptr)
+	{
+		SDS011Awaiter *next = awaiter->_next;
+		if (awaiter->poll())
+		{
+			awaiter->_handle.resume();
+			resumed++;
+		}
+		else
+		{
+			wait(*awaiter);
+		}
+		awaiter = next;
+	}
+	return resumed;
+}
+
+inline bool SDS011RequestAwaiter::send()
+{
+	NovaSDS011 &driver = _sensor._driver;
+
+	switch (_command)
+	{
+	case SDS011_QUERY_DATA:
+		return driver.requestData(_deviceId);
+	case SDS011_WORKING_MODE:
+		return driver.requestWorkingMode((WorkingMode)_value, _deviceId);
+	case SDS011_REPORTING_MODE:
+		return driver.requestDataReportingMode((DataReportingMode)_value, _deviceId);
+	default:
+		return driver.requestDutyCycle(_value, _deviceId);
+	}
+}
+
+inline bool SDS011RequestAwaiter::poll()
+{
+	NovaSDS011 &driver = _sensor._driver;
+
+	if (!_sent)
+	{
+		// Driver refuses it too, waiting for free driver would never end
+		if ((_command == SDS011_DUTY_CYCLE) && (_value > 30))
+		{
+			_state = RequestState::request_failed;
+			return true;
+		}
+
+		// Driver may also be busy with request sent outside of scheduler
+		if ((_sensor._owner != nullptr) || !send())
+		{
+			return false;
+		}
+		_sensor._owner = this;
+		_sent = true;
+	}
+
+	_state = driver.requestState();
+	if (_state == RequestState::request_pending)
+	{
+		return false;
+	}
+
+	for (uint8_t i = 0; i < sizeof(ReplyType); i++)
+	{
+		_reply[i] = driver.requestReply()[i];
+	}
+	_sensor._owner = nullptr;
+	return true;
+}
+
+#endif
@@ -0,0 +1,274 @@
+/**
+ * @file SDS011BatchCodec.cpp
+ * @brief Bit packed batch of PM readings for uplink.
+ */
+
+#include "SDS011BatchCodec.h"
+#include "SDS011Varint.h"
+
+#define BATCH_VERSION 1
+
+// Prefix codes: '0', '10', '110', '1110' followed by payload of given size, '1111' + raw
+static const uint8_t TIMESTAMP_BITS[] = {7, 9, 12, 32};
+static const uint8_t VALUE_BITS[] = {4, 7, 10, 17};
+
+// --------------------------------------------------------
+// SDS011BatchEncoder:constructor
+// --------------------------------------------------------
+SDS011BatchEncoder::SDS011BatchEncoder(uint8_t *buffer, size_t size)
+    : _buffer(buffer), _size(size)
+{
+  reset();
+}
+
+// --------------------------------------------------------
+// SDS011BatchEncoder:reset
+// --------------------------------------------------------
+void SDS011BatchEncoder::reset()
+{
+  _bytePos = SDS011_BATCH_HEADER_SIZE;
+  _bitPos = 0;
+  _count = 0;
+  _timestamp = 0;
+  _delta = 0;
+  _pm25 = 0;
+  _pm10 = 0;
+}
+
+// --------------------------------------------------------
+// SDS011BatchEncoder:writeBits
+// --------------------------------------------------------
+bool SDS011BatchEncoder::writeBits(uint32_t value, uint8_t bits)
+{
+  while (bits > 0)
+  {
+    if (_bytePos >= _size)
+    {
+      return false;
+    }
+    if (_bitPos == 0)
+    {
+      _buffer[_bytePos] = 0;
+    }
+
+    // Fill current byte from most significant bit
+    uint8_t room = 8 - _bitPos;
+    uint8_t take = (bits < room) ? bits : room;
+    uint8_t chunk = (value >> (bits - take)) & ((1 << take) - 1);
+    _buffer[_bytePos] |= chunk << (room - take);
+
+    bits -= take;
+    _bitPos += take;
+    if (_bitPos == 8)
+    {
+      _bitPos = 0;
+      _bytePos++;
+    }
+  }
+  return true;
+}
+
+// --------------------------------------------------------
+// SDS011BatchEncoder:writeDelta
+// --------------------------------------------------------
+bool SDS011BatchEncoder::writeDelta(int32_t value, const uint8_t *sizes)
+{
+  if (value == 0)
+  {
+    return writeBits(0, 1);
+  }
+
+  uint32_t zigzag = SDS011Varint::zigzag(value);
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    if (zigzag < ((uint32_t)1 << sizes[i]))
+    {
+      // i+1 ones followed by zero
+      return writeBits(((1 << (i + 2)) - 2), i + 2) && writeBits(zigzag, sizes[i]);
+    }
+  }
+  return writeBits(0x0F, 4) && writeBits(zigzag, sizes[3]);
+}
+
+// --------------------------------------------------------
+// SDS011BatchEncoder:add
+// --------------------------------------------------------
+bool SDS011BatchEncoder::add(uint32_t timestamp, uint16_t pm25, uint16_t pm10)
+{
+  if (_count == 0xFFFF)
+  {
+    return false;
+  }
+
+  size_t bytePos = _bytePos;
+  uint8_t bitPos = _bitPos;
+  int32_t delta = (int32_t)(timestamp - _timestamp);
+  bool ok;
+
+  if (_count == 0)
+  {
+    ok = writeBits(timestamp, 32) && writeBits(pm25, 16) && writeBits(pm10, 16);
+    delta = 0;
+  }
+  else
+  {
+    ok = writeDelta(delta - _delta, TIMESTAMP_BITS) && writeDelta((int32_t)pm25 - _pm25, VALUE_BITS) &&
+         writeDelta((int32_t)pm10 - _pm10, VALUE_BITS);
+  }
+
+  if (!ok)
+  {
+    // Roll back partially written sample
+    _bytePos = bytePos;
+    _bitPos = bitPos;
+    if (_bitPos != 0)
+    {
+      _buffer[_bytePos] &= 0xFF << (8 - _bitPos);
+    }
+    return false;
+  }
+
+  _count++;
+  _timestamp = timestamp;
+  _delta = delta;
+  _pm25 = pm25;
+  _pm10 = pm10;
+  return true;
+}
+
+// --------------------------------------------------------
+// SDS011BatchEncoder:finish
+// --------------------------------------------------------
+size_t SDS011BatchEncoder::finish()
+{
+  if (_size < SDS011_BATCH_HEADER_SIZE)
+  {
+    return 0;
+  }
+  _buffer[0] = BATCH_VERSION;
+  _buffer[1] = _count & 0xFF;
+  _buffer[2] = (_count >> 8) & 0xFF;
+  return _bytePos + (_bitPos ? 1 : 0);
+}
+
+// --------------------------------------------------------
+// SDS011BatchDecoder:constructor
+// --------------------------------------------------------
+SDS011BatchDecoder::SDS011BatchDecoder(const uint8_t *buffer, size_t size)
+    : _buffer(buffer), _size(size), _bytePos(SDS011_BATCH_HEADER_SIZE), _bitPos(0), _count(0), _read(0),
+      _timestamp(0), _delta(0), _pm25(0), _pm10(0)
+{
+  if ((size >= SDS011_BATCH_HEADER_SIZE) && (buffer[0] == BATCH_VERSION))
+  {
+    _count = buffer[1] | (buffer[2] << 8);
+  }
+}
+
+// --------------------------------------------------------
+// SDS011BatchDecoder:readBits
+// --------------------------------------------------------
+bool SDS011BatchDecoder::readBits(uint8_t bits, uint32_t &value)
+{
+  value = 0;
+  while (bits > 0)
+  {
+    if (_bytePos >= _size)
+    {
+      return false;
+    }
+
+    uint8_t room = 8 - _bitPos;
+    uint8_t take = (bits < room) ? bits : room;
+    uint8_t chunk = (_buffer[_bytePos] >> (room - take)) & ((1 << take) - 1);
+    value = (value << take) | chunk;
+
+    bits -= take;
+    _bitPos += take;
+    if (_bitPos == 8)
+    {
+      _bitPos = 0;
+      _bytePos++;
+    }
+  }
+  return true;
+}
+
+// --------------------------------------------------------
+// SDS011BatchDecoder:readDelta
+// --------------------------------------------------------
+bool SDS011BatchDecoder::readDelta(const uint8_t *sizes, int32_t &value)
+{
+  uint32_t bit;
+  uint8_t ones = 0;
+
+  // Count leading ones of prefix, at most 4
+  while (ones < 4)
+  {
+    if (!readBits(1, bit))
+    {
+      return false;
+    }
+    if (bit == 0)
+    {
+      break;
+    }
+    ones++;
+  }
+
+  if (ones == 0)
+  {
+    value = 0;
+    return true;
+  }
+
+  uint32_t zigzag;
+  if (!readBits(sizes[ones - 1], zigzag))
+  {
+    return false;
+  }
+  value = SDS011Varint::unzigzag(zigzag);
+  return true;
+}
+
+// --------------------------------------------------------
+// SDS011BatchDecoder:next
+// --------------------------------------------------------
+bool SDS011BatchDecoder::next(uint32_t &timestamp, uint16_t &pm25, uint16_t &pm10)
+{
+  if (_read >= _count)
+  {
+    return false;
+  }
+
+  if (_read == 0)
+  {
+    uint32_t t, a, b;
+    if (!readBits(32, t) || !readBits(16, a) || !readBits(16, b))
+    {
+      _count = 0;
+      return false;
+    }
+    _timestamp = t;
+    _pm25 = a;
+    _pm10 = b;
+  }
+  else
+  {
+    int32_t dod, d25, d10;
+    if (!readDelta(TIMESTAMP_BITS, dod) || !readDelta(VALUE_BITS, d25) || !readDelta(VALUE_BITS, d10))
+    {
+      _count = 0;
+      return false;
+    }
+    _delta += dod;
+    _timestamp += _delta;
+    _pm25 += d25;
+    _pm10 += d10;
+  }
+
+  _read++;
+  timestamp = _timestamp;
+  pm25 = _pm25;
+  pm10 = _pm10;
+  return true;
+}
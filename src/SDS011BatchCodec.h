@@ -0,0 +1,112 @@
+/**
+ * @file SDS011BatchCodec.h
+ * @brief Bit packed batch of PM readings for uplink.
+ *
+ * Gorilla style encoding of series from one sensor: timestamps as
+ * delta-of-delta, PM2.5 and PM10 (integer tenths of μg/m3) as zig-zag
+ * delta, both with short prefix codes. Steady series at fixed interval
+ * takes 3 bits per sample. Encoder and decoder have no Arduino
+ * dependencies, same code decodes batches on ingestion server.
+ *
+ * Layout: version byte, sample count (16 bit little endian), bitstream.
+ * First sample is stored raw (32 bit timestamp, 16 bit PM2.5, 16 bit PM10).
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SDS011_BATCH_HEADER_SIZE 3
+
+class SDS011BatchEncoder
+{
+public:
+	/**
+		* Constructor.
+		* @param [out] buffer output buffer
+		* @param size size of buffer
+		*/
+	SDS011BatchEncoder(uint8_t *buffer, size_t size);
+
+	/**
+		* Start new batch in same buffer.
+		*/
+	void reset();
+
+	/**
+		* Add sample to batch.
+		* @param timestamp time of sample in seconds
+		* @param pm25 PM2.5 in tenths of μg/m3
+		* @param pm10 PM10 in tenths of μg/m3
+		* @return false if sample does not fit into buffer, batch is unchanged then
+		*/
+	bool add(uint32_t timestamp, uint16_t pm25, uint16_t pm10);
+
+	/**
+		* Complete batch header.
+		* @return number of bytes of batch
+		*/
+	size_t finish();
+
+	/**
+		* Get number of samples in batch.
+		*/
+	uint16_t count() const { return _count; }
+
+private:
+	bool writeBits(uint32_t value, uint8_t bits);
+	bool writeDelta(int32_t value, const uint8_t *sizes);
+
+	uint8_t *_buffer;
+	size_t _size;
+	size_t _bytePos;
+	uint8_t _bitPos;
+
+	uint16_t _count;
+	uint32_t _timestamp;
+	int32_t _delta;
+	uint16_t _pm25;
+	uint16_t _pm10;
+};
+
+class SDS011BatchDecoder
+{
+public:
+	/**
+		* Constructor.
+		* @param buffer batch written by SDS011BatchEncoder
+		* @param size number of bytes in buffer
+		*/
+	SDS011BatchDecoder(const uint8_t *buffer, size_t size);
+
+	/**
+		* Get number of samples in batch, 0 if header is invalid.
+		*/
+	uint16_t count() const { return _count; }
+
+	/**
+		* Read next sample.
+		* @param [out] timestamp time of sample in seconds
+		* @param [out] pm25 PM2.5 in tenths of μg/m3
+		* @param [out] pm10 PM10 in tenths of μg/m3
+		* @return false if there are no more samples or batch is truncated
+		*/
+	bool next(uint32_t &timestamp, uint16_t &pm25, uint16_t &pm10);
+
+private:
+	bool readBits(uint8_t bits, uint32_t &value);
+	bool readDelta(const uint8_t *sizes, int32_t &value);
+
+	const uint8_t *_buffer;
+	size_t _size;
+	size_t _bytePos;
+	uint8_t _bitPos;
+
+	uint16_t _count;
+	uint16_t _read;
+	uint32_t _timestamp;
+	int32_t _delta;
+	uint16_t _pm25;
+	uint16_t _pm10;
+};
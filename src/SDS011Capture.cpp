@@ -0,0 +1,93 @@
+/**
+ * @file SDS011Capture.cpp
+ * @brief Compact capture format of raw serial traffic.
+ */
+
+#include "SDS011Capture.h"
+#include "SDS011Varint.h"
+
+static const uint8_t CAPTURE_MAGIC[] = {'S', 'D', 'S', 'C'};
+
+// --------------------------------------------------------
+// SDS011Capture:writeFileHeader
+// --------------------------------------------------------
+void SDS011Capture::writeFileHeader(uint8_t *buffer)
+{
+  for (uint8_t i = 0; i < sizeof(CAPTURE_MAGIC); i++)
+  {
+    buffer[i] = CAPTURE_MAGIC[i];
+  }
+  buffer[4] = SDS011_CAPTURE_VERSION;
+  buffer[5] = 0;
+  buffer[6] = 0;
+  buffer[7] = 0;
+}
+
+// --------------------------------------------------------
+// SDS011Capture:checkFileHeader
+// --------------------------------------------------------
+bool SDS011Capture::checkFileHeader(const uint8_t *buffer, size_t size)
+{
+  if (size < SDS011_CAPTURE_HEADER_SIZE)
+  {
+    return false;
+  }
+  for (uint8_t i = 0; i < sizeof(CAPTURE_MAGIC); i++)
+  {
+    if (buffer[i] != CAPTURE_MAGIC[i])
+    {
+      return false;
+    }
+  }
+  return buffer[4] == SDS011_CAPTURE_VERSION;
+}
+
+// --------------------------------------------------------
+// SDS011Capture:writeRecordHeader
+// --------------------------------------------------------
+size_t SDS011Capture::writeRecordHeader(uint8_t *buffer, bool tx, uint32_t delta, uint8_t length)
+{
+  buffer[0] = (tx ? 0x80 : 0x00) | (length & SDS011_CAPTURE_MAX_RUN);
+  return SDS011Varint::write(buffer, SDS011_CAPTURE_MAX_RECORD_HEADER, 1, delta);
+}
+
+// --------------------------------------------------------
+// SDS011CaptureReader:constructor
+// --------------------------------------------------------
+SDS011CaptureReader::SDS011CaptureReader(const uint8_t *buffer, size_t size)
+    : _buffer(buffer), _size(size), _pos(SDS011_CAPTURE_HEADER_SIZE), _timestamp(0), _truncated(false)
+{
+  _valid = SDS011Capture::checkFileHeader(buffer, size);
+}
+
+// --------------------------------------------------------
+// SDS011CaptureReader:next
+// --------------------------------------------------------
+bool SDS011CaptureReader::next(SDS011CaptureRecord &record)
+{
+  if (!_valid || (_pos >= _size))
+  {
+    return false;
+  }
+
+  uint8_t head = _buffer[_pos];
+  uint32_t delta;
+  size_t pos = SDS011Varint::read(_buffer, _size, _pos + 1, delta);
+  uint8_t length = head & SDS011_CAPTURE_MAX_RUN;
+
+  if ((pos == 0) || (length == 0) || ((_size - pos) < length))
+  {
+    _truncated = true;
+    _pos = _size;
+    return false;
+  }
+
+  _timestamp += delta;
+  record.tx = (head & 0x80) != 0;
+  record.timestamp = _timestamp;
+  record.data = _buffer + pos;
+  record.length = length;
+
+  _pos = pos + length;
+  return true;
+}
@@ -0,0 +1,97 @@
+/**
+ * @file SDS011Capture.h
+ * @brief Compact capture format of raw serial traffic.
+ *
+ * File starts with SDS011_CAPTURE_HEADER_SIZE bytes header ("SDSC", version,
+ * 3 reserved bytes). Then records follow, each one holding run of bytes sent
+ * in one direction:
+ *   byte 0  bit 7 direction (1 = TX to sensor, 0 = RX from sensor),
+ *           bits 0-6 number of data bytes (1-127)
+ *   varint  time in ms since previous record (since 0 for first record)
+ *   data bytes
+ *
+ * Writer side is SDS011CaptureTap (Arduino), reader has no dependencies
+ * so captures can be replayed on Linux (extras/host/capture_replay.cpp).
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SDS011_CAPTURE_HEADER_SIZE 8
+#define SDS011_CAPTURE_VERSION 1
+#define SDS011_CAPTURE_MAX_RUN 127
+#define SDS011_CAPTURE_MAX_RECORD_HEADER 6
+
+struct SDS011CaptureRecord
+{
+	bool tx;             // true if bytes were sent to sensor
+	uint32_t timestamp;  // ms, sum of record deltas
+	const uint8_t *data; // bytes of record, points into capture buffer
+	uint8_t length;      // number of bytes
+};
+
+class SDS011Capture
+{
+public:
+	/**
+		* Write file header.
+		* @param [out] buffer SDS011_CAPTURE_HEADER_SIZE bytes
+		*/
+	static void writeFileHeader(uint8_t *buffer);
+
+	/**
+		* Check file header.
+		* @param buffer input buffer
+		* @param size number of bytes in buffer
+		* @return true if buffer starts with valid header
+		*/
+	static bool checkFileHeader(const uint8_t *buffer, size_t size);
+
+	/**
+		* Write header of record.
+		* @param [out] buffer SDS011_CAPTURE_MAX_RECORD_HEADER bytes
+		* @param tx true if bytes were sent to sensor
+		* @param delta ms since previous record
+		* @param length number of data bytes (1-127)
+		* @return number of bytes written
+		*/
+	static size_t writeRecordHeader(uint8_t *buffer, bool tx, uint32_t delta, uint8_t length);
+};
+
+class SDS011CaptureReader
+{
+public:
+	/**
+		* Constructor.
+		* @param buffer whole capture including file header
+		* @param size number of bytes in buffer
+		*/
+	SDS011CaptureReader(const uint8_t *buffer, size_t size);
+
+	/**
+		* Check if file header is valid.
+		*/
+	bool valid() const { return _valid; }
+
+	/**
+		* Read next record, data is not copied.
+		* @param [out] record next record
+		* @return false at end of capture or if record is truncated
+		*/
+	bool next(SDS011CaptureRecord &record);
+
+	/**
+		* Check if capture ended with incomplete record.
+		*/
+	bool truncated() const { return _truncated; }
+
+private:
+	const uint8_t *_buffer;
+	size_t _size;
+	size_t _pos;
+	uint32_t _timestamp;
+	bool _valid;
+	bool _truncated;
+};
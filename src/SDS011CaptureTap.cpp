@@ -0,0 +1,102 @@
+/**
+ * @file SDS011CaptureTap.cpp
+ * @brief Stream wrapper recording raw traffic between driver and sensor.
+ */
+
+#include "SDS011CaptureTap.h"
+
+// --------------------------------------------------------
+// SDS011CaptureTap:constructor
+// --------------------------------------------------------
+SDS011CaptureTap::SDS011CaptureTap(Stream &serial, Print &capture)
+    : _serial(serial), _capture(capture)
+{
+}
+
+// --------------------------------------------------------
+// SDS011CaptureTap:begin
+// --------------------------------------------------------
+void SDS011CaptureTap::begin()
+{
+  uint8_t header[SDS011_CAPTURE_HEADER_SIZE];
+
+  SDS011Capture::writeFileHeader(header);
+  _capture.write(header, sizeof(header));
+  _lastRecord = 0;
+  _length = 0;
+}
+
+// --------------------------------------------------------
+// SDS011CaptureTap:flushCapture
+// --------------------------------------------------------
+void SDS011CaptureTap::flushCapture()
+{
+  if (_length == 0)
+  {
+    return;
+  }
+
+  uint8_t header[SDS011_CAPTURE_MAX_RECORD_HEADER];
+  size_t size = SDS011Capture::writeRecordHeader(header, _tx, _runTime - _lastRecord, _length);
+
+  _capture.write(header, size);
+  _capture.write(_run, _length);
+  _capturedBytes += _length;
+  _lastRecord = _runTime;
+  _length = 0;
+}
+
+// --------------------------------------------------------
+// SDS011CaptureTap:record
+// --------------------------------------------------------
+void SDS011CaptureTap::record(bool tx, uint8_t byte)
+{
+  uint32_t now = SDS011Clock::millis();
+
+  if ((_length > 0) &&
+      ((tx != _tx) || (_length == sizeof(_run)) || ((now - _lastByte) > SDS011_CAPTURE_RUN_GAP)))
+  {
+    flushCapture();
+  }
+  if (_length == 0)
+  {
+    _tx = tx;
+    _runTime = now;
+  }
+  _run[_length++] = byte;
+  _lastByte = now;
+}
+
+// --------------------------------------------------------
+// SDS011CaptureTap:Stream interface
+// --------------------------------------------------------
+int SDS011CaptureTap::available()
+{
+  return _serial.available();
+}
+
+int SDS011CaptureTap::read()
+{
+  int byte = _serial.read();
+  if (byte >= 0)
+  {
+    record(false, byte);
+  }
+  return byte;
+}
+
+int SDS011CaptureTap::peek()
+{
+  return _serial.peek();
+}
+
+size_t SDS011CaptureTap::write(uint8_t byte)
+{
+  record(true, byte);
+  return _serial.write(byte);
+}
+
+void SDS011CaptureTap::flush()
+{
+  _serial.flush();
+}
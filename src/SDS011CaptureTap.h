@@ -0,0 +1,74 @@
+/**
+ * @file SDS011CaptureTap.h
+ * @brief Stream wrapper recording raw traffic between driver and sensor.
+ *
+ * Tap is put between driver and serial port:
+ *   SDS011CaptureTap tap(serial, captureFile);
+ *   sds011.begin(tap);
+ * Every byte read or written by driver (including bytes dropped by
+ * clearSerial) is written to capture in SDS011Capture.h format.
+ */
+
+#pragma once
+
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#include "SDS011Capture.h"
+#include "SDS011Clock.h"
+
+#define SDS011_CAPTURE_RUN_BUFFER 32
+#define SDS011_CAPTURE_RUN_GAP 2
+
+class SDS011CaptureTap : public Stream
+{
+public:
+	/**
+		* Constructor.
+		* @param serial serial port connected to sensor
+		* @param capture output of capture, e.g. SD card file
+		*/
+	SDS011CaptureTap(Stream &serial, Print &capture);
+
+	/**
+		* Write capture file header, call once before first transfer.
+		*/
+	void begin();
+
+	/**
+		* Write pending bytes to capture.
+		* Bytes are grouped into runs, run is written when direction changes,
+		* it is full or after SDS011_CAPTURE_RUN_GAP ms pause.
+		*/
+	void flushCapture();
+
+	/**
+		* Get number of bytes recorded.
+		*/
+	uint32_t capturedBytes() const { return _capturedBytes; }
+
+	int available();
+	int read();
+	int peek();
+	size_t write(uint8_t byte);
+	void flush();
+
+	using Print::write;
+
+private:
+	void record(bool tx, uint8_t byte);
+
+	Stream &_serial;
+	Print &_capture;
+
+	uint8_t _run[SDS011_CAPTURE_RUN_BUFFER];
+	uint8_t _length = 0;
+	bool _tx = false;
+	uint32_t _runTime = 0;
+	uint32_t _lastRecord = 0;
+	uint32_t _lastByte = 0;
+	uint32_t _capturedBytes = 0;
+};
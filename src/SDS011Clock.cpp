@@ -0,0 +1,37 @@
+/**
+ * @file SDS011Clock.cpp
+ * @brief Monotonic clock and wrap-safe deadlines.
+ */
+
+#include "SDS011Clock.h"
+
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+// --------------------------------------------------------
+// Arduino clock
+// --------------------------------------------------------
+static uint32_t arduinoMillis()
+{
+  return millis();
+}
+
+static uint32_t arduinoMicros()
+{
+  return micros();
+}
+
+SDS011TimeSource SDS011Clock::_millis = arduinoMillis;
+SDS011TimeSource SDS011Clock::_micros = arduinoMicros;
+
+// --------------------------------------------------------
+// SDS011Clock:setSource
+// --------------------------------------------------------
+void SDS011Clock::setSource(SDS011TimeSource millis_source, SDS011TimeSource micros_source)
+{
+  _millis = (millis_source != NULL) ? millis_source : arduinoMillis;
+  _micros = (micros_source != NULL) ? micros_source : arduinoMicros;
+}
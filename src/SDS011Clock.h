@@ -0,0 +1,118 @@
+/**
+ * @file SDS011Clock.h
+ * @brief Monotonic clock and wrap-safe deadlines.
+ *
+ * millis() wraps after ~49 days and micros() after ~71 minutes. Times are
+ * only compared as unsigned difference (now - start), which stays correct
+ * across wraparound for intervals shorter than the wrap period. Clock
+ * source can be replaced, e.g. by virtual time in simulations and tests.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint32_t (*SDS011TimeSource)();
+
+class SDS011Clock
+{
+public:
+	/**
+		* Current time in ms.
+		*/
+	static uint32_t millis() { return _millis(); }
+
+	/**
+		* Current time in μs, for latency statistics.
+		*/
+	static uint32_t micros() { return _micros(); }
+
+	/**
+		* Replace clock source.
+		* @param millis_source function returning time in ms, NULL restores Arduino millis()
+		* @param micros_source function returning time in μs, NULL restores Arduino micros()
+		*/
+	static void setSource(SDS011TimeSource millis_source, SDS011TimeSource micros_source = NULL);
+
+	/**
+		* Check if point in time was reached, wrap-safe for times less than ~24 days apart.
+		* @param now current time
+		* @param time point in time
+		*/
+	static bool reached(uint32_t now, uint32_t time) { return (int32_t)(now - time) >= 0; }
+
+private:
+	static SDS011TimeSource _millis;
+	static SDS011TimeSource _micros;
+};
+
+class SDS011Deadline
+{
+public:
+	/**
+		* Constructor, deadline is expired until started.
+		*/
+	SDS011Deadline() : _start(0), _timeout(0) {}
+
+	/**
+		* Constructor, starts deadline.
+		* @param timeout time in ms from now
+		*/
+	explicit SDS011Deadline(uint32_t timeout) { start(timeout); }
+
+	/**
+		* Start deadline.
+		* @param timeout time in ms from now
+		*/
+	void start(uint32_t timeout)
+	{
+		_start = SDS011Clock::millis();
+		_timeout = timeout;
+	}
+
+	/**
+		* Check if timeout elapsed since start.
+		*/
+	bool expired() const { return elapsed() >= _timeout; }
+
+	/**
+		* Time in ms since start.
+		*/
+	uint32_t elapsed() const { return SDS011Clock::millis() - _start; }
+
+	/**
+		* Time in ms left until deadline, 0 when expired.
+		*/
+	uint32_t remaining() const
+	{
+		uint32_t passed = elapsed();
+		return (passed < _timeout) ? (_timeout - passed) : 0;
+	}
+
+private:
+	uint32_t _start;
+	uint32_t _timeout;
+};
+
+class SDS011Stopwatch
+{
+public:
+	/**
+		* Constructor, starts stopwatch.
+		*/
+	SDS011Stopwatch() { start(); }
+
+	/**
+		* Restart stopwatch.
+		*/
+	void start() { _start = SDS011Clock::micros(); }
+
+	/**
+		* Time in μs since start, less than ~71 minutes.
+		*/
+	uint32_t elapsedMicros() const { return SDS011Clock::micros() - _start; }
+
+private:
+	uint32_t _start;
+};
@@ -0,0 +1,319 @@
+/**
+ * @file SDS011DeviceCache.cpp
+ * @brief Shadow registers of sds011 configuration.
+ */
+
+#include "SDS011DeviceCache.h"
+
+#define SERIALIZE_VERSION 1
+
+// --------------------------------------------------------
+// SDS011DeviceCache:constructor
+// --------------------------------------------------------
+SDS011DeviceCache::SDS011DeviceCache()
+{
+  clear();
+}
+
+// --------------------------------------------------------
+// SDS011DeviceCache:clear
+// --------------------------------------------------------
+void SDS011DeviceCache::clear()
+{
+  _count = 0;
+  _next = 0;
+}
+
+// --------------------------------------------------------
+// SDS011DeviceCache:find
+// --------------------------------------------------------
+const SDS011DeviceState *SDS011DeviceCache::find(uint16_t key) const
+{
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    if (_entries[i].key == key)
+    {
+      return &_entries[i];
+    }
+  }
+  return NULL;
+}
+
+// --------------------------------------------------------
+// SDS011DeviceCache:entry
+// --------------------------------------------------------
+SDS011DeviceState &SDS011DeviceCache::entry(uint16_t key)
+{
+  const SDS011DeviceState *found = find(key);
+  if (found != NULL)
+  {
+    return _entries[found - _entries];
+  }
+
+  // Table full, reuse entries in round robin order
+  uint8_t index;
+  if (_count < SDS011_MAX_DEVICES)
+  {
+    index = _count++;
+  }
+  else
+  {
+    index = _next;
+    _next = (_next + 1) % SDS011_MAX_DEVICES;
+  }
+
+  SDS011DeviceState &state = _entries[index];
+  state.key = key;
+  state.deviceId = key;
+  state.valid = (key != SDS011_BROADCAST_ID) ? (1 << cache_device_id) : 0;
+  return state;
+}
+
+// --------------------------------------------------------
+// SDS011DeviceCache:get
+// --------------------------------------------------------
+bool SDS011DeviceCache::get(uint16_t key, SDS011CacheField field, uint8_t &value) const
+{
+  const SDS011DeviceState *state = find(key);
+  if ((state == NULL) || (field > cache_duty_cycle) || !state->isValid(field))
+  {
+    return false;
+  }
+  value = state->values[field];
+  return true;
+}
+
+// --------------------------------------------------------
+// SDS011DeviceCache:getVersion
+// --------------------------------------------------------
+bool SDS011DeviceCache::getVersion(uint16_t key, uint8_t version[3]) const
+{
+  const SDS011DeviceState *state = find(key);
+  if ((state == NULL) || !state->isValid(cache_version))
+  {
+    return false;
+  }
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    version[i] = state->version[i];
+  }
+  return true;
+}
+
+// --------------------------------------------------------
+// SDS011DeviceCache:getDeviceId
+// --------------------------------------------------------
+bool SDS011DeviceCache::getDeviceId(uint16_t key, uint16_t &device_id) const
+{
+  const SDS011DeviceState *state = find(key);
+  if ((state == NULL) || !state->isValid(cache_device_id))
+  {
+    return false;
+  }
+  device_id = state->deviceId;
+  return true;
+}
+
+// --------------------------------------------------------
+// SDS011DeviceCache:observe
+// --------------------------------------------------------
+void SDS011DeviceCache::observe(uint16_t key, uint16_t device_id, SDS011CacheField field, uint8_t value)
+{
+  SDS011DeviceState &state = entry(key);
+  state.deviceId = device_id;
+  state.valid |= (1 << cache_device_id) | (1 << field);
+  state.values[field] = value;
+
+  if ((key == SDS011_BROADCAST_ID) && (device_id != SDS011_BROADCAST_ID))
+  {
+    // Device which replied to broadcast has this value as well
+    observe(device_id, device_id, field, value);
+  }
+}
+
+// --------------------------------------------------------
+// SDS011DeviceCache:observeVersion
+// --------------------------------------------------------
+void SDS011DeviceCache::observeVersion(uint16_t key, uint16_t device_id, const uint8_t version[3])
+{
+  SDS011DeviceState &state = entry(key);
+  state.deviceId = device_id;
+  state.valid |= (1 << cache_device_id) | (1 << cache_version);
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    state.version[i] = version[i];
+  }
+
+  if ((key == SDS011_BROADCAST_ID) && (device_id != SDS011_BROADCAST_ID))
+  {
+    observeVersion(device_id, device_id, version);
+  }
+}
+
+// --------------------------------------------------------
+// SDS011DeviceCache:apply
+// --------------------------------------------------------
+void SDS011DeviceCache::apply(uint16_t key, uint16_t device_id, SDS011CacheField field, uint8_t value)
+{
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    // Broadcast reaches every device, unicast may change device seen by broadcast
+    if ((_entries[i].key != key) && (_entries[i].key != device_id) &&
+        ((key == SDS011_BROADCAST_ID) || (_entries[i].key == SDS011_BROADCAST_ID)))
+    {
+      _entries[i].valid &= ~(1 << field);
+    }
+  }
+  observe(key, device_id, field, value);
+}
+
+// --------------------------------------------------------
+// SDS011DeviceCache:remove
+// --------------------------------------------------------
+void SDS011DeviceCache::remove(uint16_t key)
+{
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    if (_entries[i].key == key)
+    {
+      // Keep table compact, move last entry into freed slot
+      _count--;
+      _entries[i] = _entries[_count];
+      if (_next >= _count)
+      {
+        _next = 0;
+      }
+      return;
+    }
+  }
+}
+
+// --------------------------------------------------------
+// SDS011DeviceCache:rename
+// --------------------------------------------------------
+void SDS011DeviceCache::rename(uint16_t key, uint16_t new_device_id)
+{
+  if (key == SDS011_BROADCAST_ID)
+  {
+    clear();
+    return;
+  }
+
+  remove(new_device_id);
+  const SDS011DeviceState *found = find(key);
+  if (found != NULL)
+  {
+    SDS011DeviceState &state = _entries[found - _entries];
+    state.key = new_device_id;
+    state.deviceId = new_device_id;
+  }
+
+  // Device seen by broadcast may be the renamed one
+  found = find(SDS011_BROADCAST_ID);
+  if (found != NULL)
+  {
+    _entries[found - _entries].valid &= ~(1 << cache_device_id);
+  }
+}
+
+// --------------------------------------------------------
+// SDS011DeviceCache:invalidate
+// --------------------------------------------------------
+void SDS011DeviceCache::invalidate(uint16_t key)
+{
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    // Broadcast entry may describe same device
+    if ((key == SDS011_BROADCAST_ID) || (_entries[i].key == key) ||
+        ((_entries[i].key == SDS011_BROADCAST_ID) && (_entries[i].deviceId == key)))
+    {
+      _entries[i].valid &= (_entries[i].key != SDS011_BROADCAST_ID) ? (1 << cache_device_id) : 0;
+    }
+  }
+}
+
+// --------------------------------------------------------
+// SDS011DeviceCache:serialize
+// --------------------------------------------------------
+size_t SDS011DeviceCache::serialize(uint8_t *buffer, size_t size) const
+{
+  size_t needed = 3 + _count * 11;
+  if (size < needed)
+  {
+    return 0;
+  }
+
+  size_t pos = 0;
+  buffer[pos++] = SERIALIZE_VERSION;
+  buffer[pos++] = _count;
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    const SDS011DeviceState &state = _entries[i];
+    buffer[pos++] = state.key & 0xFF;
+    buffer[pos++] = (state.key >> 8) & 0xFF;
+    buffer[pos++] = state.deviceId & 0xFF;
+    buffer[pos++] = (state.deviceId >> 8) & 0xFF;
+    buffer[pos++] = state.valid;
+    for (uint8_t j = 0; j < 3; j++)
+    {
+      buffer[pos++] = state.values[j];
+    }
+    for (uint8_t j = 0; j < 3; j++)
+    {
+      buffer[pos++] = state.version[j];
+    }
+  }
+  buffer[pos] = checksum(buffer, pos);
+  return pos + 1;
+}
+
+// --------------------------------------------------------
+// SDS011DeviceCache:deserialize
+// --------------------------------------------------------
+bool SDS011DeviceCache::deserialize(const uint8_t *buffer, size_t size)
+{
+  clear();
+
+  if ((size < 3) || (buffer[0] != SERIALIZE_VERSION) || (buffer[1] > SDS011_MAX_DEVICES))
+  {
+    return false;
+  }
+  size_t needed = 3 + buffer[1] * 11;
+  if ((size < needed) || (buffer[needed - 1] != checksum(buffer, needed - 1)))
+  {
+    return false;
+  }
+
+  size_t pos = 2;
+  for (uint8_t i = 0; i < buffer[1]; i++)
+  {
+    SDS011DeviceState &state = _entries[i];
+    state.key = buffer[pos] | (buffer[pos + 1] << 8);
+    state.deviceId = buffer[pos + 2] | (buffer[pos + 3] << 8);
+    state.valid = buffer[pos + 4] & ~(1 << cache_working_mode);
+    pos += 5;
+    for (uint8_t j = 0; j < 3; j++)
+    {
+      state.values[j] = buffer[pos++];
+    }
+    for (uint8_t j = 0; j < 3; j++)
+    {
+      state.version[j] = buffer[pos++];
+    }
+  }
+  _count = buffer[1];
+  return true;
+}
+
+// --------------------------------------------------------
+// SDS011DeviceCache:checksum
+// --------------------------------------------------------
+uint8_t SDS011DeviceCache::checksum(const uint8_t *buffer, size_t size)
+{
+  uint8_t sum = 0;
+  for (size_t i = 0; i < size; i++)
+  {
+    sum += buffer[i];
+  }
+  return sum;
+}
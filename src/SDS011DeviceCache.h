@@ -0,0 +1,164 @@
+/**
+ * @file SDS011DeviceCache.h
+ * @brief Shadow registers of sds011 configuration.
+ *
+ * Keeps last confirmed reporting mode, working mode, duty cycle, device id
+ * and firmware version for each device so driver can skip round trips
+ * which would not change anything. Entries are created only from replies,
+ * so table also lists devices present on bus and can be persisted.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef SDS011_MAX_DEVICES
+#define SDS011_MAX_DEVICES 4
+#endif
+#define SDS011_BROADCAST_ID 0xFFFF
+
+enum SDS011CacheField
+{
+	cache_reporting_mode = 0,
+	cache_working_mode = 1,
+	cache_duty_cycle = 2,
+	cache_version = 3,
+	cache_device_id = 4
+};
+
+struct SDS011DeviceState
+{
+	uint16_t key;       // device id used in commands, SDS011_BROADCAST_ID for broadcast
+	uint16_t deviceId;  // device id reported by sensor
+	uint8_t valid;      // bit per SDS011CacheField
+	uint8_t values[3];  // reporting mode, working mode, duty cycle
+	uint8_t version[3]; // year, month, day
+
+	bool isValid(SDS011CacheField field) const { return valid & (1 << field); }
+};
+
+class SDS011DeviceCache
+{
+public:
+	/**
+		* Constructor.
+		*/
+	SDS011DeviceCache();
+
+	/**
+		* Get cached register value.
+		* @param key device id used in command
+		* @param field one of cache_reporting_mode, cache_working_mode, cache_duty_cycle
+		* @param [out] value cached value
+		* @return true if value is valid
+		*/
+	bool get(uint16_t key, SDS011CacheField field, uint8_t &value) const;
+
+	/**
+		* Get cached firmware version.
+		* @param key device id used in command
+		* @param [out] version year, month, day
+		* @return true if version is valid
+		*/
+	bool getVersion(uint16_t key, uint8_t version[3]) const;
+
+	/**
+		* Get cached device id.
+		* @param key device id used in command
+		* @param [out] device_id id reported by sensor
+		* @return true if device id is valid
+		*/
+	bool getDeviceId(uint16_t key, uint16_t &device_id) const;
+
+	/**
+		* Store value read from device.
+		* @param key device id used in command
+		* @param device_id device id from reply
+		* @param field register
+		* @param value register value
+		*/
+	void observe(uint16_t key, uint16_t device_id, SDS011CacheField field, uint8_t value);
+
+	/**
+		* Store firmware version read from device.
+		* @param key device id used in command
+		* @param device_id device id from reply
+		* @param version year, month, day
+		*/
+	void observeVersion(uint16_t key, uint16_t device_id, const uint8_t version[3]);
+
+	/**
+		* Store value confirmed by device after set command.
+		* Broadcast command may change other devices in unknown way,
+		* so same register of all other entries is invalidated.
+		* @param key device id used in command
+		* @param device_id device id from reply
+		* @param field register
+		* @param value register value
+		*/
+	void apply(uint16_t key, uint16_t device_id, SDS011CacheField field, uint8_t value);
+
+	/**
+		* Move entry to new device id after device id change.
+		* @param key old device id
+		* @param new_device_id new device id
+		*/
+	void rename(uint16_t key, uint16_t new_device_id);
+
+	/**
+		* Forget configuration of device, device stays in table.
+		* @param key device id, SDS011_BROADCAST_ID forgets configuration of all devices
+		*/
+	void invalidate(uint16_t key);
+
+	/**
+		* Remove all devices from table.
+		*/
+	void clear();
+
+	/**
+		* Upper bound of serialize() output size.
+		*/
+	static const size_t MAX_SERIALIZED_SIZE = 3 + SDS011_MAX_DEVICES * 11;
+
+	/**
+		* Write table to buffer, e.g. to keep it in EEPROM.
+		* @param [out] buffer output buffer
+		* @param size size of buffer
+		* @return number of bytes written, 0 if buffer is too small
+		*/
+	size_t serialize(uint8_t *buffer, size_t size) const;
+
+	/**
+		* Read table written by serialize().
+		* Working mode is not restored, sensor does not keep it after power off.
+		* @param buffer input buffer
+		* @param size number of bytes in buffer
+		* @return true if buffer was valid, table is empty otherwise
+		*/
+	bool deserialize(const uint8_t *buffer, size_t size);
+
+	/**
+		* Get number of entries.
+		* @return count
+		*/
+	uint8_t count() const { return _count; }
+
+	/**
+		* Get entry by position.
+		* @param index position < count()
+		* @return entry
+		*/
+	const SDS011DeviceState &at(uint8_t index) const { return _entries[index]; }
+
+private:
+	const SDS011DeviceState *find(uint16_t key) const;
+	SDS011DeviceState &entry(uint16_t key);
+	void remove(uint16_t key);
+	static uint8_t checksum(const uint8_t *buffer, size_t size);
+
+	SDS011DeviceState _entries[SDS011_MAX_DEVICES];
+	uint8_t _count;
+	uint8_t _next;
+};
@@ -0,0 +1,64 @@
+/**
+ * @file SDS011EepromStorage.h
+ * @brief EEPROM backend of SDS011Storage.
+ *
+ * On ESP8266/ESP32 EEPROM is emulated in flash, EEPROM.begin() has to be
+ * called by application with size covering all pages.
+ */
+
+#pragma once
+
+#include <EEPROM.h>
+#include "SDS011Storage.h"
+
+class SDS011EepromStorage : public SDS011Storage
+{
+public:
+	/**
+		* Constructor.
+		* @param offset EEPROM address of first page
+		* @param page_size size of page in bytes
+		* @param page_count number of pages
+		*/
+	SDS011EepromStorage(uint16_t offset, uint16_t page_size, uint16_t page_count)
+		: _offset(offset), _pageSize(page_size), _pageCount(page_count)
+	{
+	}
+
+	uint16_t pageSize() const { return _pageSize; }
+	uint16_t pageCount() const { return _pageCount; }
+
+	bool readPage(uint16_t page, uint8_t *data)
+	{
+		int address = _offset + page * _pageSize;
+		for (uint16_t i = 0; i < _pageSize; i++)
+		{
+			data[i] = EEPROM.read(address + i);
+		}
+		return true;
+	}
+
+	bool writePage(uint16_t page, const uint8_t *data)
+	{
+		int address = _offset + page * _pageSize;
+#if defined(ESP8266) || defined(ESP32)
+		for (uint16_t i = 0; i < _pageSize; i++)
+		{
+			EEPROM.write(address + i, data[i]);
+		}
+		return EEPROM.commit();
+#else
+		// Only changed cells are written to save erase cycles
+		for (uint16_t i = 0; i < _pageSize; i++)
+		{
+			EEPROM.update(address + i, data[i]);
+		}
+		return true;
+#endif
+	}
+
+private:
+	uint16_t _offset;
+	uint16_t _pageSize;
+	uint16_t _pageCount;
+};
@@ -0,0 +1,133 @@
+/**
+ * @file SDS011Frame.cpp
+ * @brief Frame definitions and streaming reply decoder.
+ */
+
+#include "SDS011Frame.h"
+
+// --------------------------------------------------------
+// SDS011FrameDecoder:constructor
+// --------------------------------------------------------
+SDS011FrameDecoder::SDS011FrameDecoder()
+    : _pos(0), _checksum(0), _expectCommand(0), _expectSubCommand(0), _frames(0), _checksumErrors(0), _skippedBytes(0)
+{
+  for (uint8_t i = 0; i < sizeof(ReplyType); i++)
+  {
+    _frame[i] = 0;
+  }
+}
+
+// --------------------------------------------------------
+// SDS011FrameDecoder:reset
+// --------------------------------------------------------
+void SDS011FrameDecoder::reset()
+{
+  _skippedBytes += _pos;
+  _pos = 0;
+  _checksum = 0;
+}
+
+// --------------------------------------------------------
+// SDS011FrameDecoder:expect
+// --------------------------------------------------------
+void SDS011FrameDecoder::expect(uint8_t command, uint8_t sub_command)
+{
+  _expectCommand = command;
+  _expectSubCommand = sub_command;
+}
+
+// --------------------------------------------------------
+// SDS011FrameDecoder:push
+// --------------------------------------------------------
+bool SDS011FrameDecoder::push(uint8_t byte)
+{
+  switch (_pos)
+  {
+  case 0:
+    if (byte != SDS011_HEAD)
+    {
+      _skippedBytes++;
+      return false;
+    }
+    _checksum = 0;
+    break;
+
+  case 1:
+    if (((byte != SDS011_REPLY_DATA) && (byte != SDS011_REPLY_COMMAND)) ||
+        ((_expectCommand != 0) && (byte != _expectCommand)))
+    {
+      resync(byte);
+      return false;
+    }
+    break;
+
+  case 2:
+    // Sub-command echo of command reply
+    if ((_expectSubCommand != 0) && (_buffer[1] == SDS011_REPLY_COMMAND) && (byte != _expectSubCommand))
+    {
+      resync(byte);
+      return false;
+    }
+    _checksum += byte;
+    break;
+
+  case 8:
+    if (byte != _checksum)
+    {
+      _checksumErrors++;
+      resync(byte);
+      return false;
+    }
+    break;
+
+  case 9:
+    if (byte != SDS011_TAIL)
+    {
+      resync(byte);
+      return false;
+    }
+    break;
+
+  default:
+    // Data bytes 1-6
+    _checksum += byte;
+    break;
+  }
+
+  _buffer[_pos++] = byte;
+  if (_pos < sizeof(ReplyType))
+  {
+    return false;
+  }
+
+  for (uint8_t i = 0; i < sizeof(ReplyType); i++)
+  {
+    _frame[i] = _buffer[i];
+  }
+  _pos = 0;
+  _frames++;
+  return true;
+}
+
+// --------------------------------------------------------
+// SDS011FrameDecoder:resync
+// --------------------------------------------------------
+void SDS011FrameDecoder::resync(uint8_t byte)
+{
+  // Drop head of broken frame and look for new head in remaining bytes
+  ReplyType pending;
+  uint8_t count = 0;
+
+  for (uint8_t i = 1; i < _pos; i++)
+  {
+    pending[count++] = _buffer[i];
+  }
+  pending[count++] = byte;
+
+  _skippedBytes++;
+  _pos = 0;
+  for (uint8_t i = 0; i < count; i++)
+  {
+    push(pending[i]);
+  }
+}
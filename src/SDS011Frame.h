@@ -0,0 +1,111 @@
+/**
+ * @file SDS011Frame.h
+ * @brief Frame definitions and streaming reply decoder.
+ *
+ * Decoder takes bytes one by one as they arrive from serial bus and
+ * validates head, command id, checksum and tail of every reply. Checksum
+ * is accumulated byte by byte, so frame is accepted or rejected as soon
+ * as its last byte arrives, optionally only reply to expected command.
+ * It has no Arduino dependencies so same code decodes captures on Linux.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SDS011_HEAD 0xAA
+#define SDS011_TAIL 0xAB
+#define SDS011_COMMAND 0xB4
+#define SDS011_REPLY_DATA 0xC0
+#define SDS011_REPLY_COMMAND 0xC5
+
+// Data byte 1 of command and command reply
+#define SDS011_REPORTING_MODE 0x02
+#define SDS011_QUERY_DATA 0x04
+#define SDS011_SET_DEVICE_ID 0x05
+#define SDS011_WORKING_MODE 0x06
+#define SDS011_VERSION 0x07
+#define SDS011_DUTY_CYCLE 0x08
+
+typedef uint8_t CommandType[19];
+typedef uint8_t ReplyType[10];
+
+class SDS011FrameDecoder
+{
+public:
+	/**
+		* Constructor.
+		*/
+	SDS011FrameDecoder();
+
+	/**
+		* Drop partially received frame.
+		*/
+	void reset();
+
+	/**
+		* Accept only replies to given command, others are skipped as soon as
+		* command id or sub-command echo arrives.
+		* @param command SDS011_REPLY_DATA or SDS011_REPLY_COMMAND, 0 accepts any frame
+		* @param sub_command data byte 1 of SDS011_REPLY_COMMAND, 0 accepts any
+		*/
+	void expect(uint8_t command = 0, uint8_t sub_command = 0);
+
+	/**
+		* Feed one received byte.
+		* @param byte received byte
+		* @return true if byte completed valid frame, available via frame()
+		*/
+	bool push(uint8_t byte);
+
+	/**
+		* Last valid frame.
+		* @return frame
+		*/
+	const ReplyType &frame() const { return _frame; }
+
+	/**
+		* Command id of last valid frame (SDS011_REPLY_DATA or SDS011_REPLY_COMMAND).
+		*/
+	uint8_t command() const { return _frame[1]; }
+
+	/**
+		* Data byte 1 of last valid frame, command echo of SDS011_REPLY_COMMAND.
+		*/
+	uint8_t subCommand() const { return _frame[2]; }
+
+	/**
+		* Device id of last valid frame.
+		*/
+	uint16_t deviceId() const { return _frame[6] | (_frame[7] << 8); }
+
+	/**
+		* Number of valid frames.
+		*/
+	uint32_t frames() const { return _frames; }
+
+	/**
+		* Number of frames rejected because of checksum.
+		*/
+	uint32_t checksumErrors() const { return _checksumErrors; }
+
+	/**
+		* Number of bytes skipped to find start of next frame.
+		*/
+	uint32_t skippedBytes() const { return _skippedBytes; }
+
+private:
+	void resync(uint8_t byte);
+
+	ReplyType _frame;
+	ReplyType _buffer;
+	uint8_t _pos;
+	uint8_t _checksum;
+	uint8_t _expectCommand;
+	uint8_t _expectSubCommand;
+
+	uint32_t _frames;
+	uint32_t _checksumErrors;
+	uint32_t _skippedBytes;
+};
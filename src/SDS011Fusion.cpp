@@ -0,0 +1,237 @@
+/**
+ * @file SDS011Fusion.cpp
+ * @brief Consensus reading of redundant sensors on one site.
+ */
+
+#include "SDS011Fusion.h"
+
+// Fresh samples needed to tell which one is outlier
+#define FUSION_MIN_VOTERS 3
+
+// --------------------------------------------------------
+// SDS011FusionConfig:constructor
+// --------------------------------------------------------
+SDS011FusionConfig::SDS011FusionConfig()
+    : method(FusionMethod::fusion_median),
+      maxAge(10000),
+      outlierAbsolute(50),
+      outlierPercent(25),
+      divergeAfter(5)
+{
+}
+
+// --------------------------------------------------------
+// SDS011Fusion:constructor
+// --------------------------------------------------------
+SDS011Fusion::SDS011Fusion(const SDS011FusionConfig &config)
+    : _config(config), _count(0)
+{
+  if (_config.divergeAfter == 0)
+  {
+    _config.divergeAfter = 1;
+  }
+}
+
+// --------------------------------------------------------
+// SDS011Fusion:addSensor
+// --------------------------------------------------------
+bool SDS011Fusion::addSensor(uint16_t device_id, uint8_t weight)
+{
+  if (_count >= SDS011_FUSION_MAX_SENSORS)
+  {
+    return false;
+  }
+
+  Sensor &sensor = _sensors[_count++];
+  sensor.deviceId = device_id;
+  sensor.weight = (weight > 0) ? weight : 1;
+  sensor.hasSample = false;
+  sensor.outliers = 0;
+  sensor.diverging = false;
+  return true;
+}
+
+// --------------------------------------------------------
+// SDS011Fusion:update
+// --------------------------------------------------------
+bool SDS011Fusion::update(uint16_t device_id, uint16_t pm25, uint16_t pm10, uint32_t timestamp)
+{
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    if (_sensors[i].deviceId == device_id)
+    {
+      _sensors[i].hasSample = true;
+      _sensors[i].pm25 = pm25;
+      _sensors[i].pm10 = pm10;
+      _sensors[i].timestamp = timestamp;
+      return true;
+    }
+  }
+  return false;
+}
+
+// --------------------------------------------------------
+// SDS011Fusion:isDiverging
+// --------------------------------------------------------
+bool SDS011Fusion::isDiverging(uint16_t device_id) const
+{
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    if (_sensors[i].deviceId == device_id)
+    {
+      return _sensors[i].diverging;
+    }
+  }
+  return false;
+}
+
+// --------------------------------------------------------
+// SDS011Fusion:isOutlier
+// --------------------------------------------------------
+bool SDS011Fusion::isOutlier(uint16_t value, uint16_t median) const
+{
+  uint16_t deviation = (value > median) ? (value - median) : (median - value);
+  uint32_t relative = ((uint32_t)median * _config.outlierPercent) / 100;
+  return (deviation > _config.outlierAbsolute) && (deviation > relative);
+}
+
+// --------------------------------------------------------
+// SDS011Fusion:median
+// --------------------------------------------------------
+uint16_t SDS011Fusion::median(uint16_t *values, uint8_t count)
+{
+  // Insertion sort, count is small
+  for (uint8_t i = 1; i < count; i++)
+  {
+    uint16_t value = values[i];
+    uint8_t j = i;
+    while ((j > 0) && (values[j - 1] > value))
+    {
+      values[j] = values[j - 1];
+      j--;
+    }
+    values[j] = value;
+  }
+  if (count % 2)
+  {
+    return values[count / 2];
+  }
+  return ((uint32_t)values[count / 2 - 1] + values[count / 2] + 1) / 2;
+}
+
+// --------------------------------------------------------
+// SDS011Fusion:fuse
+// --------------------------------------------------------
+SDS011FusionResult SDS011Fusion::fuse(uint32_t now)
+{
+  SDS011FusionResult result = {false, 0, 0, 0, 0, 0, 0, true};
+  uint8_t fresh[SDS011_FUSION_MAX_SENSORS];
+  uint8_t freshCount = 0;
+  uint8_t trustedCount = 0;
+
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    const Sensor &sensor = _sensors[i];
+    if (sensor.hasSample && ((now - sensor.timestamp) <= _config.maxAge))
+    {
+      fresh[freshCount++] = i;
+      trustedCount += sensor.diverging ? 0 : 1;
+    }
+    else
+    {
+      result.stale++;
+    }
+  }
+  if (freshCount == 0)
+  {
+    return result;
+  }
+
+  // Median of trusted sensors, diverging ones count only if nothing else is left
+  uint16_t pm25[SDS011_FUSION_MAX_SENSORS];
+  uint16_t pm10[SDS011_FUSION_MAX_SENSORS];
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < freshCount; i++)
+  {
+    const Sensor &sensor = _sensors[fresh[i]];
+    if ((trustedCount == 0) || !sensor.diverging)
+    {
+      pm25[count] = sensor.pm25;
+      pm10[count] = sensor.pm10;
+      count++;
+    }
+  }
+  uint16_t median25 = median(pm25, count);
+  uint16_t median10 = median(pm10, count);
+
+  // Classify fresh sensors against median and track persistent divergence
+  bool outlier[SDS011_FUSION_MAX_SENSORS];
+  for (uint8_t i = 0; i < freshCount; i++)
+  {
+    Sensor &sensor = _sensors[fresh[i]];
+    outlier[i] = isOutlier(sensor.pm25, median25) || isOutlier(sensor.pm10, median10);
+    result.agreement &= !outlier[i];
+
+    if (freshCount < FUSION_MIN_VOTERS)
+    {
+      continue;
+    }
+    if (outlier[i])
+    {
+      if (sensor.outliers < _config.divergeAfter)
+      {
+        sensor.outliers++;
+      }
+      if (sensor.outliers >= _config.divergeAfter)
+      {
+        sensor.diverging = true;
+      }
+    }
+    else if (sensor.outliers > 0)
+    {
+      sensor.outliers--;
+      if (sensor.outliers == 0)
+      {
+        sensor.diverging = false;
+      }
+    }
+  }
+
+  // Median uses every trusted sample, weighted mean only those close to median
+  uint32_t sum25 = 0;
+  uint32_t sum10 = 0;
+  uint16_t weights = 0;
+  for (uint8_t i = 0; i < freshCount; i++)
+  {
+    const Sensor &sensor = _sensors[fresh[i]];
+    bool skip = (trustedCount > 0) && sensor.diverging;
+    skip |= (_config.method == FusionMethod::fusion_weighted_mean) &&
+            (freshCount >= FUSION_MIN_VOTERS) && outlier[i];
+    if (skip)
+    {
+      result.excluded++;
+      continue;
+    }
+
+    sum25 += (uint32_t)sensor.pm25 * sensor.weight;
+    sum10 += (uint32_t)sensor.pm10 * sensor.weight;
+    weights += sensor.weight;
+    if ((result.used == 0) || ((int32_t)(sensor.timestamp - result.timestamp) > 0))
+    {
+      result.timestamp = sensor.timestamp;
+    }
+    result.used++;
+  }
+
+  result.valid = true;
+  if ((_config.method == FusionMethod::fusion_median) || (weights == 0))
+  {
+    // Every sample may be outlier of the others, median is best guess then
+    result.pm25 = median25;
+    result.pm10 = median10;
+    return result;
+  }
+  result.pm25 = (sum25 + weights / 2) / weights;
+  result.pm10 = (sum10 + weights / 2) / weights;
+  return result;
+}
@@ -0,0 +1,137 @@
+/**
+ * @file SDS011Fusion.h
+ * @brief Consensus reading of redundant sensors on one site.
+ *
+ * Latest sample of each sensor is kept; fuse() combines samples which are
+ * not older than maxAge, so sleeping or missing sensor simply drops out.
+ * Result is median of fresh samples or weighted mean of samples close to
+ * that median. Sensor which is far from median in divergeAfter fusions in
+ * a row is flagged as diverging and left out until it agrees again.
+ * Outliers can be told apart only with three or more fresh sensors.
+ * Fixed memory and integer arithmetic, runs on AVR and on Linux gateway.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef SDS011_FUSION_MAX_SENSORS
+#define SDS011_FUSION_MAX_SENSORS 4
+#endif
+
+enum FusionMethod
+{
+	fusion_median = 0,
+	fusion_weighted_mean = 1
+};
+
+struct SDS011FusionConfig
+{
+	SDS011FusionConfig();
+
+	/**
+		* How fresh samples are combined.
+		*/
+	FusionMethod method;
+
+	/**
+		* Sample older than this (ms) is not used.
+		*/
+	uint32_t maxAge;
+
+	/**
+		* Deviation from median (tenths of μg/m3) which is always tolerated,
+		* sensor noise is large at low concentrations.
+		*/
+	uint16_t outlierAbsolute;
+
+	/**
+		* Deviation from median in percent which is tolerated.
+		*/
+	uint8_t outlierPercent;
+
+	/**
+		* Consecutive outlier fusions after which sensor is flagged as diverging.
+		*/
+	uint8_t divergeAfter;
+};
+
+struct SDS011FusionResult
+{
+	bool valid;          // at least one fresh sample
+	uint16_t pm25;       // consensus PM2.5 in tenths of μg/m3
+	uint16_t pm10;       // consensus PM10 in tenths of μg/m3
+	uint32_t timestamp;  // newest sample used
+	uint8_t used;        // samples in consensus
+	uint8_t excluded;    // fresh samples left out as outliers or diverging
+	uint8_t stale;       // sensors without fresh sample
+	bool agreement;      // all fresh samples are within tolerance of median
+};
+
+class SDS011Fusion
+{
+public:
+	/**
+		* Constructor.
+		* @param config fusion configuration
+		*/
+	SDS011Fusion(const SDS011FusionConfig &config = SDS011FusionConfig());
+
+	/**
+		* Add sensor.
+		* @param device_id device id
+		* @param weight weight in weighted mean (e.g. by calibration quality)
+		* @return false if SDS011_FUSION_MAX_SENSORS sensors are already added
+		*/
+	bool addSensor(uint16_t device_id, uint8_t weight = 1);
+
+	/**
+		* Store sample of sensor.
+		* @param device_id device id
+		* @param pm25 PM2.5 in tenths of μg/m3
+		* @param pm10 PM10 in tenths of μg/m3
+		* @param timestamp time of sample in ms
+		* @return false if sensor was not added
+		*/
+	bool update(uint16_t device_id, uint16_t pm25, uint16_t pm10, uint32_t timestamp);
+
+	/**
+		* Combine fresh samples.
+		* Updates outlier counters, so call it once per output period.
+		* @param now current time in ms, same clock as sample timestamps
+		* @return SDS011FusionResult
+		*/
+	SDS011FusionResult fuse(uint32_t now);
+
+	/**
+		* Check if sensor disagrees with others persistently.
+		* @param device_id device id
+		*/
+	bool isDiverging(uint16_t device_id) const;
+
+	/**
+		* Get number of added sensors.
+		*/
+	uint8_t count() const { return _count; }
+
+private:
+	struct Sensor
+	{
+		uint16_t deviceId;
+		uint8_t weight;
+		bool hasSample;
+		uint16_t pm25;
+		uint16_t pm10;
+		uint32_t timestamp;
+		uint8_t outliers;   // grows with outlier fusions, shrinks with agreeing ones
+		bool diverging;
+	};
+
+	bool isOutlier(uint16_t value, uint16_t median) const;
+	static uint16_t median(uint16_t *values, uint8_t count);
+
+	SDS011FusionConfig _config;
+	Sensor _sensors[SDS011_FUSION_MAX_SENSORS];
+	uint8_t _count;
+};
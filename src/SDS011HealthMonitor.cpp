@@ -0,0 +1,287 @@
+/**
+ * @file SDS011HealthMonitor.cpp
+ * @brief Stall detection and recovery of sds011 sensors.
+ */
+
+#include "SDS011HealthMonitor.h"
+
+// --------------------------------------------------------
+// SDS011HealthConfig:constructor
+// --------------------------------------------------------
+SDS011HealthConfig::SDS011HealthConfig()
+    : failAfter(3),
+      minBackoff(5000),
+      maxBackoff(120000),
+      reportingMode(DataReportingMode::query)
+{
+}
+
+// --------------------------------------------------------
+// SDS011HealthMonitor:constructor
+// --------------------------------------------------------
+SDS011HealthMonitor::SDS011HealthMonitor(NovaSDS011 &sensor)
+    : _sensor(sensor)
+{
+}
+
+// --------------------------------------------------------
+// SDS011HealthMonitor:begin
+// --------------------------------------------------------
+void SDS011HealthMonitor::begin(const SDS011HealthConfig &config)
+{
+  _config = config;
+  if (_config.failAfter == 0)
+  {
+    _config.failAfter = 1;
+  }
+  if (_config.maxBackoff < _config.minBackoff)
+  {
+    _config.maxBackoff = _config.minBackoff;
+  }
+}
+
+// --------------------------------------------------------
+// SDS011HealthMonitor:addDevice
+// --------------------------------------------------------
+bool SDS011HealthMonitor::addDevice(uint16_t device_id)
+{
+  if (find(device_id) != NULL)
+  {
+    return true;
+  }
+  if (_count >= SDS011_HEALTH_MAX_DEVICES)
+  {
+    return false;
+  }
+
+  Device &device = _devices[_count++];
+  device.deviceId = device_id;
+  device.state = HealthState::health_ok;
+  device.consecutiveFailures = 0;
+  device.firstFailure = 0;
+  device.backoff = 0;
+  device.lastAttempt = 0;
+  device.failures = 0;
+  device.outages = 0;
+  device.recoveryAttempts = 0;
+  device.lastOutage = 0;
+  return true;
+}
+
+// --------------------------------------------------------
+// SDS011HealthMonitor:find
+// --------------------------------------------------------
+SDS011HealthMonitor::Device *SDS011HealthMonitor::find(uint16_t device_id)
+{
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    if (_devices[i].deviceId == device_id)
+    {
+      return &_devices[i];
+    }
+  }
+  return NULL;
+}
+
+const SDS011HealthMonitor::Device *SDS011HealthMonitor::find(uint16_t device_id) const
+{
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    if (_devices[i].deviceId == device_id)
+    {
+      return &_devices[i];
+    }
+  }
+  return NULL;
+}
+
+// --------------------------------------------------------
+// SDS011HealthMonitor:queryData
+// --------------------------------------------------------
+QuerryError SDS011HealthMonitor::queryData(uint16_t &PM25, uint16_t &PM10, uint16_t device_id)
+{
+  Device *device = find(device_id);
+  if ((device != NULL) && (device->state == HealthState::health_failed))
+  {
+    return QuerryError::response_error;
+  }
+
+  QuerryError error = _sensor.queryData(PM25, PM10, device_id);
+  if (device != NULL)
+  {
+    if (error == QuerryError::response_error)
+    {
+      failure(*device, SDS011Clock::millis());
+    }
+    else if (error != QuerryError::call_to_often)
+    {
+      success(*device, SDS011Clock::millis());
+    }
+  }
+  return error;
+}
+
+// --------------------------------------------------------
+// SDS011HealthMonitor:isAvailable
+// --------------------------------------------------------
+bool SDS011HealthMonitor::isAvailable(uint16_t device_id) const
+{
+  return state(device_id) != HealthState::health_failed;
+}
+
+// --------------------------------------------------------
+// SDS011HealthMonitor:reportSuccess
+// --------------------------------------------------------
+void SDS011HealthMonitor::reportSuccess(uint16_t device_id)
+{
+  Device *device = find(device_id);
+  if (device != NULL)
+  {
+    success(*device, SDS011Clock::millis());
+  }
+}
+
+// --------------------------------------------------------
+// SDS011HealthMonitor:reportFailure
+// --------------------------------------------------------
+void SDS011HealthMonitor::reportFailure(uint16_t device_id)
+{
+  Device *device = find(device_id);
+  if (device != NULL)
+  {
+    failure(*device, SDS011Clock::millis());
+  }
+}
+
+// --------------------------------------------------------
+// SDS011HealthMonitor:success
+// --------------------------------------------------------
+void SDS011HealthMonitor::success(Device &device, uint32_t now)
+{
+  if (device.consecutiveFailures > 0)
+  {
+    device.lastOutage = now - device.firstFailure;
+  }
+  device.state = HealthState::health_ok;
+  device.consecutiveFailures = 0;
+  device.backoff = 0;
+}
+
+// --------------------------------------------------------
+// SDS011HealthMonitor:failure
+// --------------------------------------------------------
+void SDS011HealthMonitor::failure(Device &device, uint32_t now)
+{
+  device.failures++;
+  if (device.consecutiveFailures == 0)
+  {
+    device.firstFailure = now;
+  }
+  if (device.consecutiveFailures < 0xFF)
+  {
+    device.consecutiveFailures++;
+  }
+
+  if (device.state == HealthState::health_failed)
+  {
+    return;
+  }
+  if (device.consecutiveFailures < _config.failAfter)
+  {
+    device.state = HealthState::health_degraded;
+    return;
+  }
+
+  device.state = HealthState::health_failed;
+  device.outages++;
+  device.backoff = _config.minBackoff;
+  device.lastAttempt = now;
+}
+
+// --------------------------------------------------------
+// SDS011HealthMonitor:update
+// --------------------------------------------------------
+bool SDS011HealthMonitor::update()
+{
+  uint32_t now = SDS011Clock::millis();
+
+  // Round robin, one recovery per call so loop stays responsive
+  for (uint8_t n = 0; n < _count; n++)
+  {
+    Device &device = _devices[_next];
+    _next = (_next + 1) % _count;
+
+    if ((device.state != HealthState::health_failed) || ((now - device.lastAttempt) < device.backoff))
+    {
+      continue;
+    }
+
+    if (recover(device))
+    {
+      success(device, SDS011Clock::millis());
+      return true;
+    }
+
+    device.failures++;
+    device.lastAttempt = SDS011Clock::millis();
+    device.backoff = (device.backoff < (_config.maxBackoff / 2)) ? (device.backoff * 2) : _config.maxBackoff;
+    return false;
+  }
+  return false;
+}
+
+// --------------------------------------------------------
+// SDS011HealthMonitor:recover
+// --------------------------------------------------------
+bool SDS011HealthMonitor::recover(Device &device)
+{
+  device.recoveryAttempts++;
+
+  // Cached configuration is not trusted, sensor may have been reset
+  _sensor.invalidateCache(device.deviceId);
+
+  // Sleeping sensor answers only to working mode command, so it goes first
+  if (!_sensor.setWorkingMode(WorkingMode::mode_work, device.deviceId))
+  {
+    return false;
+  }
+  if (!_sensor.setDataReportingMode(_config.reportingMode, device.deviceId))
+  {
+    return false;
+  }
+  return _sensor.getVersionDate(device.deviceId).valid;
+}
+
+// --------------------------------------------------------
+// SDS011HealthMonitor:state
+// --------------------------------------------------------
+HealthState SDS011HealthMonitor::state(uint16_t device_id) const
+{
+  const Device *device = find(device_id);
+  return (device != NULL) ? device->state : HealthState::health_failed;
+}
+
+// --------------------------------------------------------
+// SDS011HealthMonitor:stats
+// --------------------------------------------------------
+SDS011HealthStats SDS011HealthMonitor::stats(uint16_t device_id) const
+{
+  SDS011HealthStats stats = {HealthState::health_failed, 0, 0, 0, 0, 0, 0};
+  const Device *device = find(device_id);
+
+  if (device != NULL)
+  {
+    stats.state = device->state;
+    stats.consecutiveFailures = device->consecutiveFailures;
+    stats.failures = device->failures;
+    stats.outages = device->outages;
+    stats.recoveryAttempts = device->recoveryAttempts;
+    stats.lastOutage = device->lastOutage;
+    if (device->state == HealthState::health_failed)
+    {
+      uint32_t waited = SDS011Clock::millis() - device->lastAttempt;
+      stats.nextAttempt = (waited < device->backoff) ? (device->backoff - waited) : 0;
+    }
+  }
+  return stats;
+}
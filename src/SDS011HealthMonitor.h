@@ -0,0 +1,160 @@
+/**
+ * @file SDS011HealthMonitor.h
+ * @brief Stall detection and recovery of sds011 sensors.
+ *
+ * Monitor counts consecutive failed transactions of each device. Device which
+ * fails too often is marked failed and is not queried any more, instead
+ * update() runs recovery script (wake, set reporting mode, read firmware
+ * version) with exponentially growing pause between attempts. So dead sensor
+ * costs one recovery attempt per backoff period instead of timeout per query.
+ */
+
+#pragma once
+
+#include "NovaSDS011.h"
+
+#ifndef SDS011_HEALTH_MAX_DEVICES
+#define SDS011_HEALTH_MAX_DEVICES 4
+#endif
+
+enum HealthState
+{
+	health_ok = 0,
+	health_degraded = 1,
+	health_failed = 2
+};
+
+struct SDS011HealthConfig
+{
+	SDS011HealthConfig();
+
+	/**
+		* Consecutive failures after which device is failed and recovery starts.
+		*/
+	uint8_t failAfter;
+
+	/**
+		* Pause in ms before first recovery attempt.
+		*/
+	uint32_t minBackoff;
+
+	/**
+		* Longest pause in ms between recovery attempts.
+		*/
+	uint32_t maxBackoff;
+
+	/**
+		* Reporting mode set by recovery.
+		*/
+	DataReportingMode reportingMode;
+};
+
+struct SDS011HealthStats
+{
+	HealthState state;
+	uint8_t consecutiveFailures;
+	uint32_t failures;          // failed transactions
+	uint32_t outages;           // times device became failed
+	uint32_t recoveryAttempts;
+	uint32_t lastOutage;        // ms from first failure to recovery of last outage
+	uint32_t nextAttempt;       // ms until next recovery attempt, 0 if not failed
+};
+
+class SDS011HealthMonitor
+{
+public:
+	/**
+		* Constructor.
+		* @param sensor initialized driver
+		*/
+	SDS011HealthMonitor(NovaSDS011 &sensor);
+
+	/**
+		* Set configuration used for all devices.
+		* @param config health configuration
+		*/
+	void begin(const SDS011HealthConfig &config = SDS011HealthConfig());
+
+	/**
+		* Add device to monitor.
+		* @param device_id device id
+		* @return false if SDS011_HEALTH_MAX_DEVICES devices are already monitored
+		*/
+	bool addDevice(uint16_t device_id);
+
+	/**
+		* Query data unless device is failed.
+		* Same as NovaSDS011::queryData, result is recorded.
+		* @param [out] PM25 value of PM2.5 particles in tenths of μg/m3
+		* @param [out] PM10 value of PM10 particles in tenths of μg/m3
+		* @param device_id device id
+		* @return QuerryError, response_error without serial traffic if device is failed
+		*/
+	QuerryError queryData(uint16_t &PM25, uint16_t &PM10, uint16_t device_id);
+
+	/**
+		* Check if device should be used, false while device is failed.
+		* @param device_id device id
+		*/
+	bool isAvailable(uint16_t device_id) const;
+
+	/**
+		* Record successful transaction done outside of monitor (e.g. sample event).
+		* @param device_id device id
+		*/
+	void reportSuccess(uint16_t device_id);
+
+	/**
+		* Record failed transaction done outside of monitor (e.g. error event).
+		* @param device_id device id
+		*/
+	void reportFailure(uint16_t device_id);
+
+	/**
+		* Run recovery of one failed device whose backoff expired, call it from loop().
+		* @return true if device recovered
+		*/
+	bool update();
+
+	/**
+		* Get health state of device.
+		* @param device_id device id
+		* @return HealthState, health_failed if device is not monitored
+		*/
+	HealthState state(uint16_t device_id) const;
+
+	/**
+		* Get statistics of device.
+		* @param device_id device id
+		* @return SDS011HealthStats, all zero if device is not monitored
+		*/
+	SDS011HealthStats stats(uint16_t device_id) const;
+
+private:
+	struct Device
+	{
+		uint16_t deviceId;
+		HealthState state;
+		uint8_t consecutiveFailures;
+		uint32_t firstFailure;
+		uint32_t backoff;
+		uint32_t lastAttempt;
+
+		uint32_t failures;
+		uint32_t outages;
+		uint32_t recoveryAttempts;
+		uint32_t lastOutage;
+	};
+
+	Device *find(uint16_t device_id);
+	const Device *find(uint16_t device_id) const;
+	void success(Device &device, uint32_t now);
+	void failure(Device &device, uint32_t now);
+	bool recover(Device &device);
+
+	NovaSDS011 &_sensor;
+	SDS011HealthConfig _config;
+	Device _devices[SDS011_HEALTH_MAX_DEVICES];
+	uint8_t _count = 0;
+	uint8_t _next = 0;
+};
@@ -0,0 +1,78 @@
+/**
+ * @file SDS011LittleFSStorage.h
+ * @brief LittleFS backend of SDS011Storage (ESP8266/ESP32).
+ *
+ * All pages are kept in one file, LittleFS.begin() has to be called
+ * by application.
+ */
+
+#pragma once
+
+#include <LittleFS.h>
+#include "SDS011Storage.h"
+
+class SDS011LittleFSStorage : public SDS011Storage
+{
+public:
+	/**
+		* Constructor.
+		* @param path file name
+		* @param page_size size of page in bytes, preferably multiple of flash block size
+		* @param page_count number of pages
+		*/
+	SDS011LittleFSStorage(const char *path, uint16_t page_size, uint16_t page_count)
+		: _path(path), _pageSize(page_size), _pageCount(page_count)
+	{
+	}
+
+	uint16_t pageSize() const { return _pageSize; }
+	uint16_t pageCount() const { return _pageCount; }
+
+	bool readPage(uint16_t page, uint8_t *data)
+	{
+		File file = LittleFS.open(_path, "r");
+		if (!file)
+		{
+			return false;
+		}
+		bool ok = file.seek((uint32_t)page * _pageSize) && (file.read(data, _pageSize) == _pageSize);
+		file.close();
+		return ok;
+	}
+
+	bool writePage(uint16_t page, const uint8_t *data)
+	{
+		if (!LittleFS.exists(_path) && !create())
+		{
+			return false;
+		}
+		File file = LittleFS.open(_path, "r+");
+		if (!file)
+		{
+			return false;
+		}
+		bool ok = file.seek((uint32_t)page * _pageSize) && (file.write(data, _pageSize) == _pageSize);
+		file.close();
+		return ok;
+	}
+
+private:
+	bool create()
+	{
+		File file = LittleFS.open(_path, "w");
+		if (!file)
+		{
+			return false;
+		}
+		for (uint32_t i = 0; i < (uint32_t)_pageSize * _pageCount; i++)
+		{
+			file.write((uint8_t)0xFF);
+		}
+		file.close();
+		return true;
+	}
+
+	const char *_path;
+	uint16_t _pageSize;
+	uint16_t _pageCount;
+};
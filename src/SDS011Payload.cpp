@@ -0,0 +1,293 @@
+/**
+ * @file SDS011Payload.cpp
+ * @brief Line protocol and JSON payloads written into fixed buffer.
+ */
+
+#include "SDS011Payload.h"
+
+// --------------------------------------------------------
+// SDS011PayloadEncoder:constructor
+// --------------------------------------------------------
+SDS011PayloadEncoder::SDS011PayloadEncoder(char *buffer, size_t size, PayloadFormat format)
+    : _buffer(buffer), _size(size), _format(format)
+{
+  // Keep room for terminating zero and closing bracket of JSON array
+  size_t reserved = (_format == PayloadFormat::payload_json) ? 2 : 1;
+  _limit = (_size > reserved) ? (_size - reserved) : 0;
+  reset();
+}
+
+// --------------------------------------------------------
+// SDS011PayloadEncoder:reset
+// --------------------------------------------------------
+void SDS011PayloadEncoder::reset()
+{
+  _pos = 0;
+  _recordStart = 0;
+  _count = 0;
+  _fields = 0;
+  _timestamp = 0;
+  _overflow = false;
+  _finished = false;
+  if (_size > 0)
+  {
+    _buffer[0] = 0;
+  }
+}
+
+// --------------------------------------------------------
+// SDS011PayloadEncoder:write
+// --------------------------------------------------------
+void SDS011PayloadEncoder::write(char c)
+{
+  if (_pos < _limit)
+  {
+    _buffer[_pos++] = c;
+  }
+  else
+  {
+    _overflow = true;
+  }
+}
+
+// --------------------------------------------------------
+// SDS011PayloadEncoder:write
+// --------------------------------------------------------
+void SDS011PayloadEncoder::write(const char *text)
+{
+  while (*text)
+  {
+    write(*text++);
+  }
+}
+
+// --------------------------------------------------------
+// SDS011PayloadEncoder:writeEscaped
+// --------------------------------------------------------
+void SDS011PayloadEncoder::writeEscaped(const char *text)
+{
+  // Same escaping for JSON strings and line protocol string fields
+  while (*text)
+  {
+    if ((*text == '"') || (*text == '\\'))
+    {
+      write('\\');
+    }
+    write(*text++);
+  }
+}
+
+// --------------------------------------------------------
+// SDS011PayloadEncoder:writeNumber
+// --------------------------------------------------------
+void SDS011PayloadEncoder::writeNumber(uint32_t value)
+{
+  char digits[10];
+  uint8_t count = 0;
+  do
+  {
+    digits[count++] = '0' + (value % 10);
+    value /= 10;
+  } while (value > 0);
+
+  while (count > 0)
+  {
+    write(digits[--count]);
+  }
+}
+
+// --------------------------------------------------------
+// SDS011PayloadEncoder:writeTenths
+// --------------------------------------------------------
+void SDS011PayloadEncoder::writeTenths(uint16_t tenths)
+{
+  writeNumber(tenths / 10);
+  write('.');
+  write('0' + (tenths % 10));
+}
+
+// --------------------------------------------------------
+// SDS011PayloadEncoder:writeHex
+// --------------------------------------------------------
+void SDS011PayloadEncoder::writeHex(uint16_t value)
+{
+  static const char HEX_DIGITS[] = "0123456789ABCDEF";
+  for (int8_t shift = 12; shift >= 0; shift -= 4)
+  {
+    write(HEX_DIGITS[(value >> shift) & 0x0F]);
+  }
+}
+
+// --------------------------------------------------------
+// SDS011PayloadEncoder:beginRecord
+// --------------------------------------------------------
+void SDS011PayloadEncoder::beginRecord(const char *measurement, uint16_t device_id, uint32_t timestamp)
+{
+  _recordStart = _pos;
+  _overflow = _finished;
+  _fields = 0;
+  _timestamp = timestamp;
+
+  if (_format == PayloadFormat::payload_json)
+  {
+    write((_count > 0) ? ',' : '[');
+    write("{\"measurement\":\"");
+    writeEscaped(measurement);
+    write("\",\"device\":\"");
+    writeHex(device_id);
+    write('"');
+  }
+  else
+  {
+    write(measurement);
+    write(",device=");
+    writeHex(device_id);
+  }
+}
+
+// --------------------------------------------------------
+// SDS011PayloadEncoder:beginField
+// --------------------------------------------------------
+void SDS011PayloadEncoder::beginField(const char *name)
+{
+  if (_format == PayloadFormat::payload_json)
+  {
+    write(",\"");
+    write(name);
+    write("\":");
+  }
+  else
+  {
+    write((_fields == 0) ? ' ' : ',');
+    write(name);
+    write('=');
+  }
+  _fields++;
+}
+
+// --------------------------------------------------------
+// SDS011PayloadEncoder:addField
+// --------------------------------------------------------
+void SDS011PayloadEncoder::addField(const char *name, uint32_t value)
+{
+  beginField(name);
+  writeNumber(value);
+  if (_format == PayloadFormat::payload_line_protocol)
+  {
+    // Integer field type, plain number is float in line protocol
+    write('i');
+  }
+}
+
+// --------------------------------------------------------
+// SDS011PayloadEncoder:addTenths
+// --------------------------------------------------------
+void SDS011PayloadEncoder::addTenths(const char *name, uint16_t tenths)
+{
+  beginField(name);
+  writeTenths(tenths);
+}
+
+// --------------------------------------------------------
+// SDS011PayloadEncoder:addText
+// --------------------------------------------------------
+void SDS011PayloadEncoder::addText(const char *name, const char *value)
+{
+  beginField(name);
+  write('"');
+  writeEscaped(value);
+  write('"');
+}
+
+// --------------------------------------------------------
+// SDS011PayloadEncoder:endRecord
+// --------------------------------------------------------
+bool SDS011PayloadEncoder::endRecord()
+{
+  if (_format == PayloadFormat::payload_json)
+  {
+    if (_timestamp != 0)
+    {
+      write(",\"timestamp\":");
+      writeNumber(_timestamp);
+    }
+    write('}');
+  }
+  else
+  {
+    if (_timestamp != 0)
+    {
+      write(' ');
+      writeNumber(_timestamp);
+    }
+    write('\n');
+  }
+
+  // Line protocol record needs at least one field
+  if (_overflow || (_fields == 0))
+  {
+    _pos = _recordStart;
+    if (_size > 0)
+    {
+      _buffer[_pos] = 0;
+    }
+    return false;
+  }
+
+  _count++;
+  _buffer[_pos] = 0;
+  return true;
+}
+
+// --------------------------------------------------------
+// SDS011PayloadEncoder:addReading
+// --------------------------------------------------------
+bool SDS011PayloadEncoder::addReading(uint16_t device_id, uint16_t pm25, uint16_t pm10, uint32_t timestamp)
+{
+  beginRecord("sds011", device_id, timestamp);
+  addTenths("pm25", pm25);
+  addTenths("pm10", pm10);
+  return endRecord();
+}
+
+// --------------------------------------------------------
+// SDS011PayloadEncoder:addVersion
+// --------------------------------------------------------
+bool SDS011PayloadEncoder::addVersion(uint16_t device_id, uint8_t year, uint8_t month, uint8_t day,
+                                      uint32_t timestamp)
+{
+  // 20YY-MM-DD
+  char version[11] = {'2', '0',
+                      (char)('0' + (year / 10) % 10), (char)('0' + year % 10), '-',
+                      (char)('0' + (month / 10) % 10), (char)('0' + month % 10), '-',
+                      (char)('0' + (day / 10) % 10), (char)('0' + day % 10), 0};
+
+  beginRecord("sds011_info", device_id, timestamp);
+  addText("firmware", version);
+  return endRecord();
+}
+
+// --------------------------------------------------------
+// SDS011PayloadEncoder:finish
+// --------------------------------------------------------
+const char *SDS011PayloadEncoder::finish()
+{
+  if (_size == 0)
+  {
+    return "";
+  }
+
+  // Room for closing bracket is reserved by write(), empty array needs one more byte
+  size_t needed = _pos + ((_count > 0) ? 2 : 3);
+  if ((_format == PayloadFormat::payload_json) && !_finished && (needed <= _size))
+  {
+    if (_count == 0)
+    {
+      _buffer[_pos++] = '[';
+    }
+    _buffer[_pos++] = ']';
+  }
+  _finished = true;
+  _buffer[_pos] = 0;
+  return _buffer;
+}
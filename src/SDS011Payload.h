@@ -0,0 +1,136 @@
+/**
+ * @file SDS011Payload.h
+ * @brief Line protocol and JSON payloads written into fixed buffer.
+ *
+ * Readings, counters and device metadata are formatted straight into
+ * caller's buffer without String, float or heap: PM values stay integer
+ * tenths and are printed as decimal with one digit after point. Several
+ * records can be batched into one payload for MQTT or InfluxDB write API.
+ * Record which does not fit is rolled back, payload stays valid.
+ *
+ * Line protocol: sds011,device=1A2B pm25=12.3,pm10=45.6 1700000000
+ * JSON: [{"measurement":"sds011","device":"1A2B","pm25":12.3,"pm10":45.6,"timestamp":1700000000}]
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+enum PayloadFormat
+{
+	payload_line_protocol = 0,
+	payload_json = 1
+};
+
+class SDS011PayloadEncoder
+{
+public:
+	/**
+		* Constructor.
+		* @param [out] buffer output buffer, payload is zero terminated
+		* @param size size of buffer
+		* @param format payload_line_protocol or payload_json
+		*/
+	SDS011PayloadEncoder(char *buffer, size_t size, PayloadFormat format = PayloadFormat::payload_line_protocol);
+
+	/**
+		* Start new payload in same buffer.
+		*/
+	void reset();
+
+	/**
+		* Add PM reading record.
+		* @param device_id device id
+		* @param pm25 PM2.5 in tenths of μg/m3
+		* @param pm10 PM10 in tenths of μg/m3
+		* @param timestamp time of reading, 0 leaves it to server
+		* @return false if record does not fit into buffer, payload is unchanged then
+		*/
+	bool addReading(uint16_t device_id, uint16_t pm25, uint16_t pm10, uint32_t timestamp = 0);
+
+	/**
+		* Add firmware version record.
+		* @param device_id device id
+		* @param year year - 2000
+		* @param month month
+		* @param day day
+		* @param timestamp time of record, 0 leaves it to server
+		* @return false if record does not fit into buffer, payload is unchanged then
+		*/
+	bool addVersion(uint16_t device_id, uint8_t year, uint8_t month, uint8_t day, uint32_t timestamp = 0);
+
+	/**
+		* Start custom record, e.g. with driver or health statistics.
+		* Fields are added by addField(), addTenths() and addText(), record is closed by endRecord().
+		* @param measurement measurement name
+		* @param device_id device id
+		* @param timestamp time of record, 0 leaves it to server
+		*/
+	void beginRecord(const char *measurement, uint16_t device_id, uint32_t timestamp = 0);
+
+	/**
+		* Add integer field to current record.
+		* @param name field name
+		* @param value value
+		*/
+	void addField(const char *name, uint32_t value);
+
+	/**
+		* Add decimal field with one digit after point to current record.
+		* @param name field name
+		* @param tenths value in tenths
+		*/
+	void addTenths(const char *name, uint16_t tenths);
+
+	/**
+		* Add text field to current record.
+		* @param name field name
+		* @param value zero terminated text
+		*/
+	void addText(const char *name, const char *value);
+
+	/**
+		* Close current record.
+		* @return false if record does not fit into buffer, payload is unchanged then
+		*/
+	bool endRecord();
+
+	/**
+		* Close payload (JSON array), more records can not be added after it.
+		* @return zero terminated payload
+		*/
+	const char *finish();
+
+	/**
+		* Get payload length without terminating zero.
+		*/
+	size_t length() const { return _pos; }
+
+	/**
+		* Get number of records in payload.
+		*/
+	uint16_t count() const { return _count; }
+
+private:
+	void beginField(const char *name);
+	void write(char c);
+	void write(const char *text);
+	void writeEscaped(const char *text);
+	void writeNumber(uint32_t value);
+	void writeTenths(uint16_t tenths);
+	void writeHex(uint16_t value);
+
+	char *_buffer;
+	size_t _size;
+	PayloadFormat _format;
+	size_t _limit;
+
+	size_t _pos;
+	size_t _recordStart;
+	uint16_t _count;
+	uint8_t _fields;
+	uint32_t _timestamp;
+	bool _overflow;
+	bool _finished;
+};
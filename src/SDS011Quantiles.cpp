@@ -0,0 +1,342 @@
+/**
+ * @file SDS011Quantiles.cpp
+ * @brief Streaming quantile sketch for PM readings.
+ */
+
+#include "SDS011Quantiles.h"
+#include "SDS011Varint.h"
+
+#define SUB_BUCKET_BITS 3
+#define SUB_BUCKETS (1 << SUB_BUCKET_BITS)
+#define SERIALIZE_VERSION 1
+
+// --------------------------------------------------------
+// SDS011QuantileSketch:constructor
+// --------------------------------------------------------
+SDS011QuantileSketch::SDS011QuantileSketch()
+{
+  reset();
+}
+
+// --------------------------------------------------------
+// SDS011QuantileSketch:reset
+// --------------------------------------------------------
+void SDS011QuantileSketch::reset()
+{
+  for (uint8_t i = 0; i < BUCKET_COUNT; i++)
+  {
+    _counts[i] = 0;
+  }
+  _total = 0;
+  _min = 0xFFFF;
+  _max = 0;
+  _scale = 0;
+  _random = 2463534242UL;
+}
+
+// --------------------------------------------------------
+// SDS011QuantileSketch:bucketIndex
+// --------------------------------------------------------
+uint8_t SDS011QuantileSketch::bucketIndex(uint16_t value)
+{
+  if (value > MAX_VALUE)
+  {
+    value = MAX_VALUE;
+  }
+  if (value < SUB_BUCKETS)
+  {
+    return value;
+  }
+
+  uint8_t msb = SUB_BUCKET_BITS;
+  while ((value >> (msb + 1)) != 0)
+  {
+    msb++;
+  }
+  uint8_t octave = msb - SUB_BUCKET_BITS + 1;
+  uint8_t sub = (value >> (msb - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+  return octave * SUB_BUCKETS + sub;
+}
+
+// --------------------------------------------------------
+// SDS011QuantileSketch:bucketLow
+// --------------------------------------------------------
+uint16_t SDS011QuantileSketch::bucketLow(uint8_t index)
+{
+  if (index < SUB_BUCKETS)
+  {
+    return index;
+  }
+  uint8_t octave = index / SUB_BUCKETS;
+  uint8_t sub = index % SUB_BUCKETS;
+  return (uint16_t)(SUB_BUCKETS + sub) << (octave - 1);
+}
+
+// --------------------------------------------------------
+// SDS011QuantileSketch:bucketHigh
+// --------------------------------------------------------
+uint16_t SDS011QuantileSketch::bucketHigh(uint8_t index)
+{
+  if (index < SUB_BUCKETS)
+  {
+    return index;
+  }
+  uint8_t octave = index / SUB_BUCKETS;
+  return bucketLow(index) + (1 << (octave - 1)) - 1;
+}
+
+// --------------------------------------------------------
+// SDS011QuantileSketch:halve
+// --------------------------------------------------------
+void SDS011QuantileSketch::halve()
+{
+  _total = 0;
+  for (uint8_t i = 0; i < BUCKET_COUNT; i++)
+  {
+    _counts[i] = (uint16_t)(((uint32_t)_counts[i] + 1) >> 1);
+    _total += _counts[i];
+  }
+  _scale++;
+}
+
+// --------------------------------------------------------
+// SDS011QuantileSketch:random
+// --------------------------------------------------------
+uint32_t SDS011QuantileSketch::random()
+{
+  // xorshift32
+  _random ^= _random << 13;
+  _random ^= _random >> 17;
+  _random ^= _random << 5;
+  return _random;
+}
+
+// --------------------------------------------------------
+// SDS011QuantileSketch:add
+// --------------------------------------------------------
+void SDS011QuantileSketch::add(uint16_t value)
+{
+  uint8_t index = bucketIndex(value);
+
+  if (value > MAX_VALUE)
+  {
+    value = MAX_VALUE;
+  }
+  if (value < _min)
+  {
+    _min = value;
+  }
+  if (value > _max)
+  {
+    _max = value;
+  }
+
+  // With scaled counters sample is counted with probability 2^-_scale,
+  // random choice so periodic input does not alias with fixed pattern.
+  if (_scale > 0)
+  {
+    uint8_t bits = (_scale < 31) ? _scale : 31;
+    if ((random() & ((1UL << bits) - 1)) != 0)
+    {
+      return;
+    }
+  }
+
+  if (_counts[index] == 0xFFFF)
+  {
+    halve();
+  }
+  _counts[index]++;
+  _total++;
+}
+
+// --------------------------------------------------------
+// SDS011QuantileSketch:merge
+// --------------------------------------------------------
+void SDS011QuantileSketch::merge(const SDS011QuantileSketch &other)
+{
+  if (other._total == 0)
+  {
+    return;
+  }
+
+  while (_scale < other._scale)
+  {
+    halve();
+  }
+
+  if (other._min < _min)
+  {
+    _min = other._min;
+  }
+  if (other._max > _max)
+  {
+    _max = other._max;
+  }
+
+  for (uint8_t i = 0; i < BUCKET_COUNT; i++)
+  {
+    uint16_t count = other._counts[i];
+    if (count == 0)
+    {
+      continue;
+    }
+
+    uint8_t shift = _scale - other._scale;
+    uint32_t scaled = (shift < 16) ? (count >> shift) : 0;
+    if (scaled == 0)
+    {
+      scaled = 1;
+    }
+
+    // Halving once is not enough when both counters are near full
+    while (_counts[i] + scaled > 0xFFFF)
+    {
+      halve();
+      scaled = (scaled + 1) >> 1;
+    }
+    _counts[i] += scaled;
+    _total += scaled;
+  }
+}
+
+// --------------------------------------------------------
+// SDS011QuantileSketch:quantile
+// --------------------------------------------------------
+uint16_t SDS011QuantileSketch::quantile(uint16_t permille) const
+{
+  if (_total == 0)
+  {
+    return 0;
+  }
+  if (permille >= 1000)
+  {
+    return _max;
+  }
+
+  // rank = ceil(total * permille / 1000) without overflowing 32 bits
+  uint32_t rank = (_total / 1000) * permille + ((_total % 1000) * permille + 999) / 1000;
+  if (rank == 0)
+  {
+    rank = 1;
+  }
+
+  uint32_t seen = 0;
+  for (uint8_t i = 0; i < BUCKET_COUNT; i++)
+  {
+    seen += _counts[i];
+    if (seen >= rank)
+    {
+      uint16_t low = bucketLow(i);
+      uint16_t high = bucketHigh(i);
+      uint16_t value = low + (high - low) / 2;
+      if (value < _min)
+      {
+        value = _min;
+      }
+      if (value > _max)
+      {
+        value = _max;
+      }
+      return value;
+    }
+  }
+  return _max;
+}
+
+// --------------------------------------------------------
+// SDS011QuantileSketch:count
+// --------------------------------------------------------
+uint32_t SDS011QuantileSketch::count() const
+{
+  if (_scale >= 16)
+  {
+    return 0xFFFFFFFF;
+  }
+  uint32_t limit = 0xFFFFFFFF >> _scale;
+  return (_total > limit) ? 0xFFFFFFFF : (_total << _scale);
+}
+
+// --------------------------------------------------------
+// SDS011QuantileSketch:serialize
+// --------------------------------------------------------
+size_t SDS011QuantileSketch::serialize(uint8_t *buffer, size_t size) const
+{
+  if (size < 6)
+  {
+    return 0;
+  }
+
+  size_t pos = 0;
+  buffer[pos++] = SERIALIZE_VERSION;
+  buffer[pos++] = _scale;
+  buffer[pos++] = _min & 0xFF;
+  buffer[pos++] = (_min >> 8) & 0xFF;
+  buffer[pos++] = _max & 0xFF;
+  buffer[pos++] = (_max >> 8) & 0xFF;
+
+  // Non empty buckets as pairs (gap from previous non empty bucket, count)
+  int16_t previous = -1;
+  for (uint8_t i = 0; i < BUCKET_COUNT; i++)
+  {
+    if (_counts[i] == 0)
+    {
+      continue;
+    }
+    pos = SDS011Varint::write(buffer, size, pos, i - previous - 1);
+    if (pos == 0)
+    {
+      return 0;
+    }
+    pos = SDS011Varint::write(buffer, size, pos, _counts[i]);
+    if (pos == 0)
+    {
+      return 0;
+    }
+    previous = i;
+  }
+  return pos;
+}
+
+// --------------------------------------------------------
+// SDS011QuantileSketch:deserialize
+// --------------------------------------------------------
+bool SDS011QuantileSketch::deserialize(const uint8_t *buffer, size_t size)
+{
+  reset();
+
+  if ((size < 6) || (buffer[0] != SERIALIZE_VERSION))
+  {
+    return false;
+  }
+
+  _scale = buffer[1];
+  _min = buffer[2] | (buffer[3] << 8);
+  _max = buffer[4] | (buffer[5] << 8);
+
+  size_t pos = 6;
+  int16_t previous = -1;
+  while (pos < size)
+  {
+    uint32_t gap;
+    uint32_t count;
+
+    pos = SDS011Varint::read(buffer, size, pos, gap);
+    if (pos != 0)
+    {
+      pos = SDS011Varint::read(buffer, size, pos, count);
+    }
+
+    int32_t index = previous + 1 + (int32_t)gap;
+    if ((pos == 0) || (gap >= BUCKET_COUNT) || (index >= BUCKET_COUNT) || (count == 0) || (count > 0xFFFF))
+    {
+      reset();
+      return false;
+    }
+
+    _counts[index] = count;
+    _total += count;
+    previous = index;
+  }
+  return true;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file SDS011Quantiles.h
+ * @brief Streaming quantile sketch for PM readings.
+ *
+ * Log-bucketed histogram of readings in tenths of μg/m3 (as reported by
+ * sensor). Values below 8 are stored exactly, above that every power of two
+ * is split into 8 buckets, so relative error of reported quantile is at most
+ * 1/16. Memory use is fixed, only integer arithmetic is used, so sketch can
+ * run on AVR and on Linux gateway which merges sketches from many sensors.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+class SDS011QuantileSketch
+{
+public:
+	/**
+		* Number of histogram buckets.
+		*/
+	static const uint8_t BUCKET_COUNT = 96;
+
+	/**
+		* Highest value that can be stored, bigger values are clamped.
+		* Sensor range is 0-999.9 μg/m3 so 9999 tenths.
+		*/
+	static const uint16_t MAX_VALUE = 16383;
+
+	/**
+		* Upper bound of serialize() output size.
+		*/
+	static const size_t MAX_SERIALIZED_SIZE = 6 + BUCKET_COUNT * 4;
+
+	/**
+		* Constructor.
+		*/
+	SDS011QuantileSketch();
+
+	/**
+		* Remove all samples.
+		*/
+	void reset();
+
+	/**
+		* Add one sample.
+		* @param value reading in tenths of μg/m3
+		*/
+	void add(uint16_t value);
+
+	/**
+		* Add all samples from other sketch.
+		* @param other sketch to merge into this one
+		*/
+	void merge(const SDS011QuantileSketch &other);
+
+	/**
+		* Estimate quantile of added samples.
+		* @param permille requested quantile in 1/1000 (500 = median, 950 = P95)
+		* @return value in tenths of μg/m3, 0 if sketch is empty
+		*/
+	uint16_t quantile(uint16_t permille) const;
+
+	/**
+		* Get number of added samples.
+		* Estimate if counters had to be rescaled.
+		* @return number of samples
+		*/
+	uint32_t count() const;
+
+	/**
+		* Get smallest added sample (exact).
+		* @return value in tenths of μg/m3
+		*/
+	uint16_t minimum() const { return _min; }
+
+	/**
+		* Get biggest added sample (exact).
+		* @return value in tenths of μg/m3
+		*/
+	uint16_t maximum() const { return _max; }
+
+	/**
+		* Write compact representation of sketch to buffer.
+		* Only non empty buckets are stored, typically few dozen bytes.
+		* @param [out] buffer output buffer
+		* @param size size of buffer
+		* @return number of bytes written, 0 if buffer is too small
+		*/
+	size_t serialize(uint8_t *buffer, size_t size) const;
+
+	/**
+		* Read sketch written by serialize().
+		* @param buffer input buffer
+		* @param size number of bytes in buffer
+		* @return true if buffer was valid, sketch is empty otherwise
+		*/
+	bool deserialize(const uint8_t *buffer, size_t size);
+
+private:
+	static uint8_t bucketIndex(uint16_t value);
+	static uint16_t bucketLow(uint8_t index);
+	static uint16_t bucketHigh(uint8_t index);
+
+	/**
+		* Halve all counters to make room for new samples.
+		* Non empty bucket stays non empty.
+		*/
+	void halve();
+
+	uint32_t random();
+
+	/**
+		* Sample counters, each count represents 2^_scale samples.
+		*/
+	uint16_t _counts[BUCKET_COUNT];
+
+	/**
+		* Sum of _counts.
+		*/
+	uint32_t _total;
+
+	uint16_t _min;
+	uint16_t _max;
+	uint8_t _scale;
+
+	/**
+		* State of generator deciding which samples are counted after rescale.
+		*/
+	uint32_t _random;
+};
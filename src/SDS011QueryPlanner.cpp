@@ -0,0 +1,492 @@
+/**
+ * @file SDS011QueryPlanner.cpp
+ * @brief Query scheduling aligned to refresh of sensor values.
+ */
+
+#include "SDS011QueryPlanner.h"
+
+// Refresh position is known when bracket is this narrow (ms)
+#define PLANNER_MIN_WIDTH 16
+// Reading is sent this long after end of bracket
+#define PLANNER_GUARD 4
+// Shortest probe to reading time, query and reply take about 35 ms at 9600 baud
+#define PLANNER_MIN_WINDOW 60
+// Queries sent later than this are not used for learning
+#define PLANNER_TOLERANCE 8
+// Most readings between checks of learned phase
+#define PLANNER_CHECK_EVERY 8
+#define PLANNER_MIN_PERIOD 250
+// Learned drift is limited to 1/50 of period
+#define PLANNER_MAX_DRIFT 50
+
+// --------------------------------------------------------
+// SDS011QueryPlanner:constructor
+// --------------------------------------------------------
+SDS011QueryPlanner::SDS011QueryPlanner(NovaSDS011 &sensor)
+    : _sensor(sensor)
+{
+}
+
+// --------------------------------------------------------
+// SDS011QueryPlanner:addDevice
+// --------------------------------------------------------
+bool SDS011QueryPlanner::addDevice(uint16_t device_id, uint32_t interval, uint16_t refresh_period)
+{
+  if (_count >= SDS011_PLANNER_MAX_DEVICES)
+  {
+    return false;
+  }
+
+  Slot &slot = _slots[_count++];
+  slot.deviceId = device_id;
+  slot.period = (refresh_period < PLANNER_MIN_PERIOD) ? PLANNER_MIN_PERIOD : refresh_period;
+  slot.interval = (interval < slot.period) ? slot.period : interval;
+  slot.hi = 0;
+  slot.width = slot.period;
+  slot.sinceCheck = 0;
+  slot.checkEvery = 1;
+  slot.quiet = 0;
+  slot.drift = 0;
+  slot.advancedAt = SDS011Clock::millis();
+  slot.relearning = false;
+  slot.lostHi = 0;
+  slot.lockedAt = 0;
+  slot.hasLast = false;
+  slot.readings = 0;
+  slot.probes = 0;
+  slot.errors = 0;
+  slot.ageSum = 0;
+  slot.ageCount = 0;
+
+  plan(slot, SDS011Clock::millis());
+  return true;
+}
+
+// --------------------------------------------------------
+// SDS011QueryPlanner:setInterval
+// --------------------------------------------------------
+bool SDS011QueryPlanner::setInterval(uint16_t device_id, uint32_t interval)
+{
+  const Slot *found = find(device_id);
+  if (found == NULL)
+  {
+    return false;
+  }
+
+  Slot &slot = _slots[found - _slots];
+  slot.interval = (interval < slot.period) ? slot.period : interval;
+  return true;
+}
+
+// --------------------------------------------------------
+// SDS011QueryPlanner:begin
+// --------------------------------------------------------
+bool SDS011QueryPlanner::begin()
+{
+  _sensor.onSample(sampleHandler, this);
+  _sensor.onError(errorHandler, this);
+  _pending = -1;
+
+  bool ok = _sensor.setDataReportingMode(DataReportingMode::query);
+
+  uint32_t now = SDS011Clock::millis();
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    plan(_slots[i], now);
+  }
+  return ok;
+}
+
+// --------------------------------------------------------
+// SDS011QueryPlanner:onSample
+// --------------------------------------------------------
+void SDS011QueryPlanner::onSample(SDS011SampleHandler handler, void *context)
+{
+  _sampleHandler = handler;
+  _sampleContext = context;
+}
+
+// --------------------------------------------------------
+// SDS011QueryPlanner:onError
+// --------------------------------------------------------
+void SDS011QueryPlanner::onError(SDS011ErrorHandler handler, void *context)
+{
+  _errorHandler = handler;
+  _errorContext = context;
+}
+
+// --------------------------------------------------------
+// SDS011QueryPlanner:update
+// --------------------------------------------------------
+void SDS011QueryPlanner::update()
+{
+  _sensor.service();
+  if (_pending >= 0)
+  {
+    return;
+  }
+
+  uint32_t now = SDS011Clock::millis();
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    Slot &slot = _slots[i];
+    if (!SDS011Clock::reached(now, (slot.stage == SlotStage::stage_probe) ? slot.probeAt : slot.readingAt))
+    {
+      continue;
+    }
+
+    // Driver may still wait for reply of other query
+    if (_sensor.requestData(slot.deviceId))
+    {
+      _pending = i;
+      _sent = now;
+    }
+    return;
+  }
+}
+
+// --------------------------------------------------------
+// SDS011QueryPlanner:plan
+// --------------------------------------------------------
+void SDS011QueryPlanner::plan(Slot &slot, uint32_t base)
+{
+  uint16_t period = slot.period;
+  uint16_t target;
+  uint16_t window;
+
+  // Position of refresh when reading will be sent
+  advance(slot, SDS011Clock::millis());
+  uint16_t hi = wrap(slot, (int32_t)slot.hi + shiftAt(slot, base + period)) >> 8;
+
+  if (slot.width > PLANNER_MIN_WIDTH)
+  {
+    // Learning, probe and reading split bracket (hi - width, hi] in half
+    uint16_t half = slot.width / 2;
+    target = (hi + period - half) % period;
+    window = slot.width - half;
+    slot.test = true;
+  }
+  else
+  {
+    // Locked, check from time to time that refresh is still in front of reading
+    target = (hi + PLANNER_GUARD) % period;
+    window = 0;
+    slot.test = (slot.sinceCheck >= slot.checkEvery);
+  }
+  if (window < PLANNER_MIN_WINDOW)
+  {
+    window = PLANNER_MIN_WINDOW;
+  }
+  if (slot.quiet > 0)
+  {
+    slot.quiet--;
+    slot.test = false;
+  }
+
+  // Refresh nearest to base, so readings keep interval on average
+  base -= period / 2;
+  slot.readingAt = alignAfter(slot, slot.test ? (base + window) : base, target);
+  slot.probeAt = slot.readingAt - window;
+  slot.stage = slot.test ? SlotStage::stage_probe : SlotStage::stage_reading;
+  slot.probeValid = false;
+}
+
+// --------------------------------------------------------
+// SDS011QueryPlanner:evaluateTest
+// --------------------------------------------------------
+void SDS011QueryPlanner::evaluateTest(Slot &slot, uint16_t pm25, uint16_t pm10, uint32_t sent)
+{
+  int32_t probeLate = slot.probeSent - slot.probeAt;
+  int32_t readingLate = sent - slot.readingAt;
+
+  if (!slot.probeValid || (probeLate > PLANNER_TOLERANCE) || (readingLate > PLANNER_TOLERANCE))
+  {
+    return;
+  }
+  // Value same as in previous cycle (at least one refresh ago), air is steady and test tells nothing
+  if (slot.hasLast && (pm25 == slot.lastPM25) && (pm10 == slot.lastPM10))
+  {
+    slot.quiet = PLANNER_CHECK_EVERY;
+    slot.sinceCheck = 0;
+    return;
+  }
+
+  bool refreshed = (pm25 != slot.probePM25) || (pm10 != slot.probePM10);
+  slot.sinceCheck = 0;
+  advance(slot, sent);
+
+  if (slot.width > PLANNER_MIN_WIDTH)
+  {
+    uint16_t half = slot.width / 2;
+    if (refreshed)
+    {
+      // Refresh in (hi - width, hi - half]
+      slot.hi = wrap(slot, (int32_t)slot.hi - ((int32_t)half << 8));
+      slot.width -= half;
+    }
+    else
+    {
+      // Refresh in (hi - half, hi]
+      slot.width = half;
+    }
+    if (slot.width <= PLANNER_MIN_WIDTH)
+    {
+      lock(slot, sent);
+    }
+  }
+  else if (refreshed)
+  {
+    if (slot.checkEvery < PLANNER_CHECK_EVERY)
+    {
+      slot.checkEvery *= 2;
+    }
+  }
+  else
+  {
+    // Refresh drifted out of (reading - window, reading], learn again outside of it
+    slot.relearning = true;
+    slot.lostHi = slot.hi;
+    slot.hi = wrap(slot, ((int32_t)phaseOf(slot, slot.readingAt) - PLANNER_MIN_WINDOW) << 8);
+    slot.width = slot.period - PLANNER_MIN_WINDOW;
+    slot.checkEvery = 1;
+  }
+}
+
+// --------------------------------------------------------
+// SDS011QueryPlanner:lock
+// --------------------------------------------------------
+void SDS011QueryPlanner::lock(Slot &slot, uint32_t now)
+{
+  if (slot.relearning)
+  {
+    // Phase moved since last lock, difference per period is error of drift
+    int32_t full = (int32_t)slot.period << 8;
+    int32_t moved = (int32_t)wrap(slot, (int32_t)slot.hi - (int32_t)slot.lostHi);
+    if (moved > (full / 2))
+    {
+      moved -= full;
+    }
+
+    uint32_t periods = (now - slot.lockedAt) / slot.period;
+    if (periods > 0)
+    {
+      int32_t drift = slot.drift + moved / (int32_t)periods;
+      int32_t limit = full / PLANNER_MAX_DRIFT;
+      slot.drift = (drift > limit) ? limit : ((drift < -limit) ? -limit : drift);
+    }
+    slot.relearning = false;
+  }
+  slot.lockedAt = now;
+}
+
+// --------------------------------------------------------
+// SDS011QueryPlanner:advance
+// --------------------------------------------------------
+void SDS011QueryPlanner::advance(Slot &slot, uint32_t now)
+{
+  if (!SDS011Clock::reached(now, slot.advancedAt))
+  {
+    return;
+  }
+
+  int32_t shift = shiftAt(slot, now);
+  slot.advancedAt += ((now - slot.advancedAt) / slot.period) * slot.period;
+  slot.hi = wrap(slot, (int32_t)slot.hi + shift);
+  slot.lostHi = wrap(slot, (int32_t)slot.lostHi + shift);
+}
+
+// --------------------------------------------------------
+// SDS011QueryPlanner:shiftAt
+// --------------------------------------------------------
+int32_t SDS011QueryPlanner::shiftAt(const Slot &slot, uint32_t time)
+{
+  if (!SDS011Clock::reached(time, slot.advancedAt))
+  {
+    return 0;
+  }
+
+  // Refresh moves by drift every period, product is reduced so it fits 32 bits
+  uint32_t full = (uint32_t)slot.period << 8;
+  uint32_t periods = (time - slot.advancedAt) / slot.period;
+  return ((int32_t)(periods % full) * slot.drift) % (int32_t)full;
+}
+
+// --------------------------------------------------------
+// SDS011QueryPlanner:wrap
+// --------------------------------------------------------
+uint32_t SDS011QueryPlanner::wrap(const Slot &slot, int32_t value)
+{
+  int32_t full = (int32_t)slot.period << 8;
+  value %= full;
+  return (value < 0) ? (value + full) : value;
+}
+
+// --------------------------------------------------------
+// SDS011QueryPlanner:phaseOf
+// --------------------------------------------------------
+uint16_t SDS011QueryPlanner::phaseOf(const Slot &slot, uint32_t time)
+{
+  // advancedAt moves by whole periods, difference stays right when millis() wraps
+  int32_t phase = (int32_t)(time - slot.advancedAt) % (int32_t)slot.period;
+  return (phase < 0) ? (phase + slot.period) : phase;
+}
+
+// --------------------------------------------------------
+// SDS011QueryPlanner:handleReply
+// --------------------------------------------------------
+void SDS011QueryPlanner::handleReply(uint16_t pm25, uint16_t pm10, uint32_t timestamp)
+{
+  Slot &slot = _slots[_pending];
+  _pending = -1;
+
+  if (slot.stage == SlotStage::stage_probe)
+  {
+    slot.probeSent = _sent;
+    slot.probePM25 = pm25;
+    slot.probePM10 = pm10;
+    slot.probeValid = true;
+    slot.probes++;
+    slot.stage = SlotStage::stage_reading;
+    return;
+  }
+
+  if (slot.test)
+  {
+    evaluateTest(slot, pm25, pm10, _sent);
+  }
+  else if (slot.sinceCheck < slot.checkEvery)
+  {
+    slot.sinceCheck++;
+  }
+
+  if (slot.width <= PLANNER_MIN_WIDTH)
+  {
+    // Reading may go out slightly before end of bracket, refresh is somewhere inside it
+    advance(slot, _sent);
+    int32_t age = (phaseOf(slot, _sent) + slot.period - (slot.hi >> 8)) % slot.period;
+    if (age > (slot.period / 2))
+    {
+      age -= slot.period;
+    }
+    age += slot.width / 2;
+    slot.ageSum += (age > 0) ? age : 0;
+    slot.ageCount++;
+  }
+
+  slot.readings++;
+  slot.hasLast = true;
+  slot.lastPM25 = pm25;
+  slot.lastPM10 = pm10;
+
+  uint32_t next = slot.readingAt + slot.interval;
+  plan(slot, SDS011Clock::reached(timestamp, next) ? timestamp : next);
+
+  if (_sampleHandler != NULL)
+  {
+    _sampleHandler(_sampleContext, slot.deviceId, pm25, pm10, timestamp);
+  }
+}
+
+// --------------------------------------------------------
+// SDS011QueryPlanner:handleError
+// --------------------------------------------------------
+void SDS011QueryPlanner::handleError()
+{
+  Slot &slot = _slots[_pending];
+  _pending = -1;
+  slot.errors++;
+
+  if (slot.stage == SlotStage::stage_probe)
+  {
+    // Go on with reading, test is skipped
+    slot.stage = SlotStage::stage_reading;
+  }
+  else
+  {
+    uint32_t now = SDS011Clock::millis();
+    uint32_t next = slot.readingAt + slot.interval;
+    plan(slot, SDS011Clock::reached(now, next) ? now : next);
+  }
+
+  if (_errorHandler != NULL)
+  {
+    _errorHandler(_errorContext, slot.deviceId, QuerryError::response_error);
+  }
+}
+
+// --------------------------------------------------------
+// SDS011QueryPlanner:sampleHandler
+// --------------------------------------------------------
+void SDS011QueryPlanner::sampleHandler(void *context, uint16_t device_id, uint16_t pm25, uint16_t pm10,
+                                       uint32_t timestamp)
+{
+  SDS011QueryPlanner *planner = (SDS011QueryPlanner *)context;
+
+  // Active mode frames and late replies are not planned readings
+  if ((planner->_pending < 0) ||
+      ((planner->_slots[planner->_pending].deviceId != SDS011_BROADCAST_ID) &&
+       (planner->_slots[planner->_pending].deviceId != device_id)))
+  {
+    return;
+  }
+  planner->handleReply(pm25, pm10, timestamp);
+}
+
+// --------------------------------------------------------
+// SDS011QueryPlanner:errorHandler
+// --------------------------------------------------------
+void SDS011QueryPlanner::errorHandler(void *context, uint16_t device_id, QuerryError)
+{
+  SDS011QueryPlanner *planner = (SDS011QueryPlanner *)context;
+
+  // Checksum errors come with broadcast id, driver reports timeout of request later
+  if ((planner->_pending < 0) || (planner->_slots[planner->_pending].deviceId != device_id))
+  {
+    return;
+  }
+  planner->handleError();
+}
+
+// --------------------------------------------------------
+// SDS011QueryPlanner:stats
+// --------------------------------------------------------
+SDS011PlannerStats SDS011QueryPlanner::stats(uint16_t device_id) const
+{
+  SDS011PlannerStats stats = {0, 0, 0, false, 0, 0, 0};
+  const Slot *slot = find(device_id);
+
+  if (slot != NULL)
+  {
+    stats.readings = slot->readings;
+    stats.probes = slot->probes;
+    stats.errors = slot->errors;
+    stats.locked = (slot->width <= PLANNER_MIN_WIDTH);
+    stats.phase = ((slot->hi >> 8) + slot->advancedAt % slot->period) % slot->period;
+    stats.drift = slot->drift;
+    stats.meanAge = slot->ageCount ? (uint16_t)(slot->ageSum / slot->ageCount) : 0;
+  }
+  return stats;
+}
+
+// --------------------------------------------------------
+// SDS011QueryPlanner:find
+// --------------------------------------------------------
+const SDS011QueryPlanner::Slot *SDS011QueryPlanner::find(uint16_t device_id) const
+{
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    if (_slots[i].deviceId == device_id)
+    {
+      return &_slots[i];
+    }
+  }
+  return NULL;
+}
+
+// --------------------------------------------------------
+// SDS011QueryPlanner:alignAfter
+// --------------------------------------------------------
+uint32_t SDS011QueryPlanner::alignAfter(const Slot &slot, uint32_t base, uint16_t phase)
+{
+  return base + (phase + slot.period - phaseOf(slot, base)) % slot.period;
+}
@@ -0,0 +1,165 @@
+/**
+ * @file SDS011QueryPlanner.h
+ * @brief Query scheduling aligned to refresh of sensor values.
+ *
+ * Sensor refreshes its measurement once per refresh period (1 s when working
+ * continuously). Query sent at random time returns value which is on average
+ * half of period old. Planner learns at which point of period each device
+ * refreshes by pairs of queries (probe and reading, value changed between
+ * them = refresh happened in between, bracket is halved) and then sends
+ * every reading just after refresh. Phase is checked again every few readings
+ * so clock drift between board and sensor is followed.
+ *
+ * Planner uses non blocking path of driver (requestData, service) and takes
+ * over its sample and error handlers, register handlers on planner instead.
+ */
+
+#pragma once
+
+#include "NovaSDS011.h"
+
+#ifndef SDS011_PLANNER_MAX_DEVICES
+#define SDS011_PLANNER_MAX_DEVICES 4
+#endif
+
+struct SDS011PlannerStats
+{
+	uint32_t readings;  // readings delivered to sample handler
+	uint32_t probes;    // extra queries spent on learning phase
+	uint32_t errors;    // queries without reply
+	bool locked;        // refresh phase is known
+	uint16_t phase;     // SDS011Clock::millis() % refresh period at which value refreshes
+	int16_t drift;      // learned difference of refresh period from nominal one, 1/256 ms
+	uint16_t meanAge;   // estimated mean age of locked readings in ms
+};
+
+class SDS011QueryPlanner
+{
+public:
+	/**
+		* Constructor.
+		* @param sensor initialized driver
+		*/
+	SDS011QueryPlanner(NovaSDS011 &sensor);
+
+	/**
+		* Add device to schedule.
+		* @param device_id device id, 0xFFFF for single sensor on bus
+		* @param interval time in ms between readings, not less than refresh period
+		* @param refresh_period time in ms between refreshes of sensor value
+		* @return false if SDS011_PLANNER_MAX_DEVICES devices are already planned
+		*/
+	bool addDevice(uint16_t device_id, uint32_t interval = 3000, uint16_t refresh_period = 1000);
+
+	/**
+		* Change time between readings of device.
+		* @param device_id device id
+		* @param interval time in ms between readings
+		* @return false if device is not planned
+		*/
+	bool setInterval(uint16_t device_id, uint32_t interval);
+
+	/**
+		* Register sample handler of driver and set query reporting mode.
+		* @return true if sensors accepted query reporting mode
+		*/
+	bool begin();
+
+	/**
+		* Register handler called for every reading (not for probes).
+		* @param handler function, NULL to unregister
+		* @param context passed to handler
+		*/
+	void onSample(SDS011SampleHandler handler, void *context = NULL);
+
+	/**
+		* Register handler called when planned query is not answered.
+		* @param handler function, NULL to unregister
+		* @param context passed to handler
+		*/
+	void onError(SDS011ErrorHandler handler, void *context = NULL);
+
+	/**
+		* Service driver and send queries which are due, call it from loop().
+		*/
+	void update();
+
+	/**
+		* Get learning state and statistics of device.
+		* @param device_id device id
+		* @return SDS011PlannerStats, all zero if device is not planned
+		*/
+	SDS011PlannerStats stats(uint16_t device_id) const;
+
+private:
+	enum SlotStage
+	{
+		stage_probe = 0,
+		stage_reading = 1
+	};
+
+	struct Slot
+	{
+		uint16_t deviceId;
+		uint32_t interval;
+		uint16_t period;
+
+		uint32_t hi;         // refresh happens in (hi - width, hi] after advancedAt modulo period, 1/256 ms
+		uint16_t width;      // ms
+		uint8_t sinceCheck;  // readings since last phase check
+		uint8_t checkEvery;  // readings between checks, grows while checks pass
+		uint8_t quiet;       // readings without test after steady air was seen
+
+		int16_t drift;       // refresh period minus nominal period, 1/256 ms
+		uint32_t advancedAt; // drift is applied to hi up to this time
+		bool relearning;     // lost phase is kept in lostHi
+		uint32_t lostHi;
+		uint32_t lockedAt;
+
+		SlotStage stage;
+		bool test;           // probe is part of this cycle
+		uint32_t probeAt;
+		uint32_t readingAt;
+		uint32_t probeSent;
+		uint16_t probePM25;
+		uint16_t probePM10;
+		bool probeValid;
+
+		bool hasLast;
+		uint16_t lastPM25;
+		uint16_t lastPM10;
+
+		uint32_t readings;
+		uint32_t probes;
+		uint32_t errors;
+		uint32_t ageSum;
+		uint32_t ageCount;
+	};
+
+	static void sampleHandler(void *context, uint16_t device_id, uint16_t pm25, uint16_t pm10, uint32_t timestamp);
+	static void errorHandler(void *context, uint16_t device_id, QuerryError error);
+
+	void handleReply(uint16_t pm25, uint16_t pm10, uint32_t timestamp);
+	void handleError();
+	void evaluateTest(Slot &slot, uint16_t pm25, uint16_t pm10, uint32_t sent);
+	void plan(Slot &slot, uint32_t base);
+	void lock(Slot &slot, uint32_t now);
+	static void advance(Slot &slot, uint32_t now);
+	static int32_t shiftAt(const Slot &slot, uint32_t time);
+	static uint32_t wrap(const Slot &slot, int32_t value);
+	const Slot *find(uint16_t device_id) const;
+	static uint16_t phaseOf(const Slot &slot, uint32_t time);
+	static uint32_t alignAfter(const Slot &slot, uint32_t base, uint16_t phase);
+
+	NovaSDS011 &_sensor;
+	Slot _slots[SDS011_PLANNER_MAX_DEVICES];
+	uint8_t _count = 0;
+
+	int8_t _pending = -1;
+	uint32_t _sent = 0;
+
+	SDS011SampleHandler _sampleHandler = NULL;
+	void *_sampleContext = NULL;
+	SDS011ErrorHandler _errorHandler = NULL;
+	void *_errorContext = NULL;
+};
@@ -0,0 +1,376 @@
+/**
+ * @file SDS011SampleLog.cpp
+ * @brief Compact binary log of PM readings.
+ */
+
+#include "SDS011SampleLog.h"
+#include "SDS011Varint.h"
+
+#define LOG_MAGIC 0xD5
+#define LOG_VERSION 1
+#define LOG_MAX_RECORD_SIZE 15
+
+// --------------------------------------------------------
+// Little endian helpers
+// --------------------------------------------------------
+static void put16(uint8_t *buffer, uint16_t value)
+{
+  buffer[0] = value & 0xFF;
+  buffer[1] = (value >> 8) & 0xFF;
+}
+
+static void put32(uint8_t *buffer, uint32_t value)
+{
+  put16(buffer, value & 0xFFFF);
+  put16(buffer + 2, value >> 16);
+}
+
+static uint16_t get16(const uint8_t *buffer)
+{
+  return buffer[0] | (buffer[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *buffer)
+{
+  return get16(buffer) | ((uint32_t)get16(buffer + 2) << 16);
+}
+
+// --------------------------------------------------------
+// CRC-16/CCITT (poly 0x1021, init 0xFFFF)
+// --------------------------------------------------------
+static uint16_t crc16(const uint8_t *data, uint16_t size)
+{
+  uint16_t crc = 0xFFFF;
+  for (uint16_t i = 0; i < size; i++)
+  {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+      crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+    }
+  }
+  return crc;
+}
+
+// --------------------------------------------------------
+// Decode one record following previous sample
+// --------------------------------------------------------
+static uint16_t decodeRecord(const uint8_t *page, uint16_t used, uint16_t pos, SDS011LogSample &sample)
+{
+  uint32_t dt, d25, d10;
+
+  pos = SDS011Varint::read(page, used, pos, dt);
+  if (pos != 0)
+  {
+    pos = SDS011Varint::read(page, used, pos, d25);
+  }
+  if (pos != 0)
+  {
+    pos = SDS011Varint::read(page, used, pos, d10);
+  }
+  if (pos != 0)
+  {
+    sample.timestamp += SDS011Varint::unzigzag(dt);
+    sample.pm25 += SDS011Varint::unzigzag(d25);
+    sample.pm10 += SDS011Varint::unzigzag(d10);
+  }
+  return pos;
+}
+
+// --------------------------------------------------------
+// SDS011SampleLog:pageValid
+// --------------------------------------------------------
+bool SDS011SampleLog::pageValid(const uint8_t *page, uint16_t size)
+{
+  if ((page[0] != LOG_MAGIC) || (page[1] != LOG_VERSION))
+  {
+    return false;
+  }
+  uint16_t used = get16(page + 6);
+  if ((used < SDS011_LOG_HEADER_SIZE) || (used > (size - 2)))
+  {
+    return false;
+  }
+  return get16(page + size - 2) == crc16(page, size - 2);
+}
+
+// --------------------------------------------------------
+// SDS011SampleLog:findNewestPage
+// --------------------------------------------------------
+bool SDS011SampleLog::findNewestPage(SDS011Storage &storage, uint8_t *page_buffer, uint16_t &page,
+                                     uint32_t &sequence)
+{
+  bool found = false;
+  for (uint16_t i = 0; i < storage.pageCount(); i++)
+  {
+    if (!storage.readPage(i, page_buffer) || !pageValid(page_buffer, storage.pageSize()))
+    {
+      continue;
+    }
+    uint32_t pageSequence = get32(page_buffer + 2);
+    if (!found || (pageSequence > sequence))
+    {
+      found = true;
+      page = i;
+      sequence = pageSequence;
+    }
+  }
+  return found;
+}
+
+// --------------------------------------------------------
+// SDS011SampleLog:constructor
+// --------------------------------------------------------
+SDS011SampleLog::SDS011SampleLog(SDS011Storage &storage, uint8_t *page_buffer)
+    : _storage(storage), _page(page_buffer), _pageIndex(0), _sequence(0), _used(0), _pageWrites(0)
+{
+  _last = {0, 0, 0};
+}
+
+// --------------------------------------------------------
+// SDS011SampleLog:begin
+// --------------------------------------------------------
+bool SDS011SampleLog::begin()
+{
+  uint16_t size = _storage.pageSize();
+  if ((size < SDS011_LOG_MIN_PAGE_SIZE) || (_storage.pageCount() == 0))
+  {
+    return false;
+  }
+
+  _used = 0;
+  _sequence = 0;
+  _pageIndex = 0;
+  if (!findNewestPage(_storage, _page, _pageIndex, _sequence) || !_storage.readPage(_pageIndex, _page))
+  {
+    return true;
+  }
+
+  // Continue in newest page if it has room left
+  uint16_t used = get16(_page + 6);
+  uint16_t count = get16(_page + 8);
+  if ((used + LOG_MAX_RECORD_SIZE) > (size - 2))
+  {
+    return true;
+  }
+
+  _last = {get32(_page + 10), get16(_page + 14), get16(_page + 16)};
+  uint16_t pos = SDS011_LOG_HEADER_SIZE;
+  for (uint16_t i = 1; (i < count) && (pos != 0); i++)
+  {
+    pos = decodeRecord(_page, used, pos, _last);
+  }
+  if (pos == used)
+  {
+    _used = used;
+  }
+  return true;
+}
+
+// --------------------------------------------------------
+// SDS011SampleLog:pendingSamples
+// --------------------------------------------------------
+uint16_t SDS011SampleLog::pendingSamples() const
+{
+  return (_used == 0) ? 0 : get16(_page + 8);
+}
+
+// --------------------------------------------------------
+// SDS011SampleLog:startPage
+// --------------------------------------------------------
+void SDS011SampleLog::startPage(uint32_t timestamp, uint16_t pm25, uint16_t pm10)
+{
+  if (_sequence != 0)
+  {
+    _pageIndex = (_pageIndex + 1) % _storage.pageCount();
+  }
+  _sequence++;
+
+  _page[0] = LOG_MAGIC;
+  _page[1] = LOG_VERSION;
+  put32(_page + 2, _sequence);
+  put16(_page + 8, 1);
+  put32(_page + 10, timestamp);
+  put16(_page + 14, pm25);
+  put16(_page + 16, pm10);
+  _used = SDS011_LOG_HEADER_SIZE;
+
+  _last = {timestamp, pm25, pm10};
+}
+
+// --------------------------------------------------------
+// SDS011SampleLog:writeCurrentPage
+// --------------------------------------------------------
+bool SDS011SampleLog::writeCurrentPage()
+{
+  uint16_t size = _storage.pageSize();
+
+  put16(_page + 6, _used);
+  for (uint16_t i = _used; i < (size - 2); i++)
+  {
+    _page[i] = 0;
+  }
+  put16(_page + size - 2, crc16(_page, size - 2));
+
+  if (!_storage.writePage(_pageIndex, _page))
+  {
+    return false;
+  }
+  _pageWrites++;
+  return true;
+}
+
+// --------------------------------------------------------
+// SDS011SampleLog:append
+// --------------------------------------------------------
+bool SDS011SampleLog::append(uint32_t timestamp, uint16_t pm25, uint16_t pm10)
+{
+  if (_used == 0)
+  {
+    startPage(timestamp, pm25, pm10);
+    return true;
+  }
+
+  uint8_t record[LOG_MAX_RECORD_SIZE];
+  size_t length = 0;
+  length = SDS011Varint::write(record, sizeof(record), length, SDS011Varint::zigzag(timestamp - _last.timestamp));
+  length = SDS011Varint::write(record, sizeof(record), length, SDS011Varint::zigzag((int32_t)pm25 - _last.pm25));
+  length = SDS011Varint::write(record, sizeof(record), length, SDS011Varint::zigzag((int32_t)pm10 - _last.pm10));
+
+  if ((_used + length) > (uint16_t)(_storage.pageSize() - 2))
+  {
+    if (!writeCurrentPage())
+    {
+      return false;
+    }
+    startPage(timestamp, pm25, pm10);
+    return true;
+  }
+
+  for (size_t i = 0; i < length; i++)
+  {
+    _page[_used++] = record[i];
+  }
+  put16(_page + 8, get16(_page + 8) + 1);
+  _last = {timestamp, pm25, pm10};
+  return true;
+}
+
+// --------------------------------------------------------
+// SDS011SampleLog:flush
+// --------------------------------------------------------
+bool SDS011SampleLog::flush()
+{
+  if (_used == 0)
+  {
+    return true;
+  }
+  return writeCurrentPage();
+}
+
+// --------------------------------------------------------
+// SDS011LogReader:constructor
+// --------------------------------------------------------
+SDS011LogReader::SDS011LogReader(SDS011Storage &storage, uint8_t *page_buffer)
+    : _storage(storage), _page(page_buffer)
+{
+  rewind();
+}
+
+// --------------------------------------------------------
+// SDS011LogReader:rewind
+// --------------------------------------------------------
+void SDS011LogReader::rewind()
+{
+  uint16_t newest;
+  uint32_t sequence;
+
+  _remaining = 0;
+  _corruptPages = 0;
+  _pagesRead = 0;
+  _startPage = 0;
+  _last = {0, 0, 0};
+
+  if (SDS011SampleLog::findNewestPage(_storage, _page, newest, sequence))
+  {
+    // Pages are written in ring order, oldest one follows newest
+    _startPage = (newest + 1) % _storage.pageCount();
+  }
+  else
+  {
+    _pagesRead = _storage.pageCount();
+  }
+}
+
+// --------------------------------------------------------
+// SDS011LogReader:loadPage
+// --------------------------------------------------------
+bool SDS011LogReader::loadPage()
+{
+  uint16_t page = (_startPage + _pagesRead) % _storage.pageCount();
+  _pagesRead++;
+
+  if (!_storage.readPage(page, _page))
+  {
+    return false;
+  }
+  if (!SDS011SampleLog::pageValid(_page, _storage.pageSize()))
+  {
+    // Never written pages do not count as corrupt
+    if (_page[0] == LOG_MAGIC)
+    {
+      _corruptPages++;
+    }
+    return false;
+  }
+
+  _used = get16(_page + 6);
+  _remaining = get16(_page + 8);
+  _pos = SDS011_LOG_HEADER_SIZE;
+  _first = true;
+  return true;
+}
+
+// --------------------------------------------------------
+// SDS011LogReader:nextRecord
+// --------------------------------------------------------
+bool SDS011LogReader::nextRecord(SDS011LogSample &sample)
+{
+  if (_first)
+  {
+    _first = false;
+    _last = {get32(_page + 10), get16(_page + 14), get16(_page + 16)};
+  }
+  else
+  {
+    _pos = decodeRecord(_page, _used, _pos, _last);
+    if (_pos == 0)
+    {
+      _corruptPages++;
+      _remaining = 0;
+      return false;
+    }
+  }
+  _remaining--;
+  sample = _last;
+  return true;
+}
+
+// --------------------------------------------------------
+// SDS011LogReader:next
+// --------------------------------------------------------
+bool SDS011LogReader::next(SDS011LogSample &sample)
+{
+  while (true)
+  {
+    if ((_remaining > 0) && nextRecord(sample))
+    {
+      return true;
+    }
+    if (_pagesRead >= _storage.pageCount())
+    {
+      return false;
+    }
+    loadPage();
+  }
+}
@@ -0,0 +1,153 @@
+/**
+ * @file SDS011SampleLog.h
+ * @brief Compact binary log of PM readings.
+ *
+ * Samples are kept as tenths of μg/m3. First sample of page is stored
+ * as is, following ones as varint time delta and zig-zag varint PM deltas,
+ * typically 3 bytes per sample. Page is written only when it is full
+ * (or on flush()), pages are used as ring buffer and protected by CRC.
+ *
+ * Page layout (little endian):
+ *   0    magic 0xD5
+ *   1    format version
+ *   2-5  sequence number
+ *   6-7  used bytes
+ *   8-9  number of samples
+ *   10-13 timestamp of first sample
+ *   14-15 PM2.5 of first sample
+ *   16-17 PM10 of first sample
+ *   ...  records
+ *   last 2 bytes CRC-16/CCITT of preceding bytes
+ */
+
+#pragma once
+
+#include "SDS011Storage.h"
+
+#define SDS011_LOG_HEADER_SIZE 18
+#define SDS011_LOG_MIN_PAGE_SIZE 32
+
+struct SDS011LogSample
+{
+	uint32_t timestamp; // seconds, any monotonic base
+	uint16_t pm25;      // tenths of μg/m3
+	uint16_t pm10;      // tenths of μg/m3
+};
+
+class SDS011SampleLog
+{
+public:
+	/**
+		* Constructor.
+		* @param storage page storage
+		* @param page_buffer buffer of storage.pageSize() bytes for page being filled
+		*/
+	SDS011SampleLog(SDS011Storage &storage, uint8_t *page_buffer);
+
+	/**
+		* Find newest page in storage and continue after its last sample.
+		* @return false if storage page size is too small
+		*/
+	bool begin();
+
+	/**
+		* Add sample to log.
+		* Samples must come in time order.
+		* @param timestamp time of sample in seconds
+		* @param pm25 PM2.5 in tenths of μg/m3
+		* @param pm10 PM10 in tenths of μg/m3
+		* @return false if page could not be written
+		*/
+	bool append(uint32_t timestamp, uint16_t pm25, uint16_t pm10);
+
+	/**
+		* Write partially filled page to storage.
+		* Following samples are added to same page which is rewritten later.
+		* @return true if operation was sucessful
+		*/
+	bool flush();
+
+	/**
+		* Get number of pages written since begin().
+		*/
+	uint32_t pageWrites() const { return _pageWrites; }
+
+	/**
+		* Get number of samples in page being filled.
+		*/
+	uint16_t pendingSamples() const;
+
+	/**
+		* Find page with highest sequence number.
+		* @param storage page storage
+		* @param page_buffer buffer of storage.pageSize() bytes, overwritten
+		* @param [out] page newest page
+		* @param [out] sequence sequence number of newest page
+		* @return false if storage has no valid page
+		*/
+	static bool findNewestPage(SDS011Storage &storage, uint8_t *page_buffer, uint16_t &page, uint32_t &sequence);
+
+	/**
+		* Check if buffer contains valid log page.
+		* @param page page data
+		* @param size page size
+		* @return true if magic, version, used size and CRC are valid
+		*/
+	static bool pageValid(const uint8_t *page, uint16_t size);
+
+private:
+	void startPage(uint32_t timestamp, uint16_t pm25, uint16_t pm10);
+	bool writeCurrentPage();
+
+	SDS011Storage &_storage;
+	uint8_t *_page;
+	uint16_t _pageIndex;
+	uint32_t _sequence;
+	uint16_t _used;
+	uint32_t _pageWrites;
+	SDS011LogSample _last;
+};
+
+class SDS011LogReader
+{
+public:
+	/**
+		* Constructor.
+		* @param storage page storage written by SDS011SampleLog
+		* @param page_buffer buffer of storage.pageSize() bytes
+		*/
+	SDS011LogReader(SDS011Storage &storage, uint8_t *page_buffer);
+
+	/**
+		* Start reading from oldest sample.
+		*/
+	void rewind();
+
+	/**
+		* Read next sample, from oldest to newest.
+		* Pages with invalid CRC are skipped.
+		* @param [out] sample read sample
+		* @return false if there are no more samples
+		*/
+	bool next(SDS011LogSample &sample);
+
+	/**
+		* Get number of pages skipped because of invalid CRC.
+		*/
+	uint16_t corruptPages() const { return _corruptPages; }
+
+private:
+	bool loadPage();
+	bool nextRecord(SDS011LogSample &sample);
+
+	SDS011Storage &_storage;
+	uint8_t *_page;
+	uint16_t _startPage;
+	uint16_t _pagesRead;
+	uint16_t _pos;
+	uint16_t _used;
+	uint16_t _remaining;
+	bool _first;
+	uint16_t _corruptPages;
+	SDS011LogSample _last;
+};
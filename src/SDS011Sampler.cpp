@@ -0,0 +1,310 @@
+/**
+ * @file SDS011Sampler.cpp
+ * @brief Energy aware sampling orchestrator for sds011 sensor.
+ */
+
+#include "SDS011Sampler.h"
+
+#define SAMPLER_MAX_ERRORS 3
+
+// --------------------------------------------------------
+// SDS011SamplerConfig:constructor
+// --------------------------------------------------------
+SDS011SamplerConfig::SDS011SamplerConfig()
+    : warmupTime(30000),
+      sampleInterval(3000),
+      discardSamples(1),
+      minSamples(3),
+      maxSamples(8),
+      stableDelta(10),
+      minCycleInterval(60000),
+      maxCycleInterval(900000),
+      changeThreshold(50),
+      supplyVoltage(5000),
+      workCurrent(70),
+      sleepCurrent(4)
+{
+}
+
+// --------------------------------------------------------
+// SDS011Sampler:constructor
+// --------------------------------------------------------
+SDS011Sampler::SDS011Sampler(NovaSDS011 &sensor, uint16_t device_id)
+    : _sensor(sensor), _deviceId(device_id)
+{
+}
+
+// --------------------------------------------------------
+// SDS011Sampler:begin
+// --------------------------------------------------------
+bool SDS011Sampler::begin(const SDS011SamplerConfig &config)
+{
+  _config = config;
+  if (_config.maxSamples > SDS011_SAMPLER_MAX_SAMPLES)
+  {
+    _config.maxSamples = SDS011_SAMPLER_MAX_SAMPLES;
+  }
+  if (_config.minSamples > _config.maxSamples)
+  {
+    _config.minSamples = _config.maxSamples;
+  }
+  if (_config.minSamples == 0)
+  {
+    _config.minSamples = 1;
+  }
+
+  _cycleInterval = _config.minCycleInterval;
+  _firstCycle = true;
+
+  bool ok = _sensor.setDataReportingMode(DataReportingMode::query, _deviceId);
+  _sensor.setWorkingMode(WorkingMode::mode_sleep, _deviceId);
+
+  enterState(SamplerState::sampler_idle, SDS011Clock::millis());
+  return ok;
+}
+
+// --------------------------------------------------------
+// SDS011Sampler:enterState
+// --------------------------------------------------------
+void SDS011Sampler::enterState(SamplerState state, uint32_t now)
+{
+  _state = state;
+  _stateSince = now;
+}
+
+// --------------------------------------------------------
+// SDS011Sampler:update
+// --------------------------------------------------------
+bool SDS011Sampler::update()
+{
+  uint32_t now = SDS011Clock::millis();
+
+  switch (_state)
+  {
+  case SamplerState::sampler_idle:
+    if (!_firstCycle && ((now - _cycleStart) < _cycleInterval))
+    {
+      return false;
+    }
+    _firstCycle = false;
+    _cycleStart = now;
+
+    if (!_sensor.setWorkingMode(WorkingMode::mode_work, _deviceId))
+    {
+      // Try again in next cycle
+      _errors++;
+      return false;
+    }
+
+    addDuration(_sleepSeconds, _sleepRest, now - _stateSince);
+    _count = 0;
+    _discarded = 0;
+    _attempts = 0;
+    enterState(SamplerState::sampler_warmup, now);
+    return false;
+
+  case SamplerState::sampler_warmup:
+    if ((now - _stateSince) < _config.warmupTime)
+    {
+      return false;
+    }
+    enterState(SamplerState::sampler_sampling, now);
+    _lastQuery = now - _config.sampleInterval;
+    return false;
+
+  case SamplerState::sampler_sampling:
+  {
+    if ((now - _lastQuery) < _config.sampleInterval)
+    {
+      return false;
+    }
+    _lastQuery = now;
+    _attempts++;
+
+    uint16_t pm25;
+    uint16_t pm10;
+    QuerryError error = _sensor.queryData(pm25, pm10, _deviceId);
+
+    if ((error == QuerryError::no_new_data) && (_count > 0))
+    {
+      // Same value as before, sensor is steady
+      pm25 = _pm25[_count - 1];
+      pm10 = _pm10[_count - 1];
+      error = QuerryError::no_error;
+    }
+
+    if (error == QuerryError::no_error)
+    {
+      if (_discarded < _config.discardSamples)
+      {
+        _discarded++;
+      }
+      else
+      {
+        _pm25[_count] = pm25;
+        _pm10[_count] = pm10;
+        _count++;
+      }
+    }
+    else if (error == QuerryError::response_error)
+    {
+      _errors++;
+    }
+
+    if ((_count >= _config.maxSamples) ||
+        ((_count >= _config.minSamples) && isStable()) ||
+        (_attempts >= (_config.maxSamples + _config.discardSamples + SAMPLER_MAX_ERRORS)))
+    {
+      finishCycle(now);
+      return true;
+    }
+    return false;
+  }
+  }
+  return false;
+}
+
+// --------------------------------------------------------
+// SDS011Sampler:isStable
+// --------------------------------------------------------
+bool SDS011Sampler::isStable() const
+{
+  return (spread(_pm25 + _count - _config.minSamples, _config.minSamples) <= _config.stableDelta) &&
+         (spread(_pm10 + _count - _config.minSamples, _config.minSamples) <= _config.stableDelta);
+}
+
+// --------------------------------------------------------
+// SDS011Sampler:spread
+// --------------------------------------------------------
+uint16_t SDS011Sampler::spread(const uint16_t *values, uint8_t count)
+{
+  uint16_t low = 0xFFFF;
+  uint16_t high = 0;
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    if (values[i] < low)
+    {
+      low = values[i];
+    }
+    if (values[i] > high)
+    {
+      high = values[i];
+    }
+  }
+  return high - low;
+}
+
+// --------------------------------------------------------
+// SDS011Sampler:median
+// --------------------------------------------------------
+uint16_t SDS011Sampler::median(uint16_t *values, uint8_t count)
+{
+  // Insertion sort, count is small
+  for (uint8_t i = 1; i < count; i++)
+  {
+    uint16_t value = values[i];
+    uint8_t j = i;
+    while ((j > 0) && (values[j - 1] > value))
+    {
+      values[j] = values[j - 1];
+      j--;
+    }
+    values[j] = value;
+  }
+  return values[count / 2];
+}
+
+// --------------------------------------------------------
+// SDS011Sampler:finishCycle
+// --------------------------------------------------------
+void SDS011Sampler::finishCycle(uint32_t now)
+{
+  SDS011SamplerResult previous = _result;
+
+  _result.valid = (_count > 0);
+  _result.samples = _count;
+  _result.timestamp = now;
+  if (_result.valid)
+  {
+    _result.pm25 = median(_pm25, _count);
+    _result.pm10 = median(_pm10, _count);
+  }
+
+  _sensor.setWorkingMode(WorkingMode::mode_sleep, _deviceId);
+
+  addDuration(_workSeconds, _workRest, now - _cycleStart);
+  _cycles++;
+  _samples += _count;
+
+  // Sample more often when PM changes fast, back off when it is steady
+  if (_result.valid && previous.valid)
+  {
+    uint16_t change = (_result.pm25 > previous.pm25) ? (_result.pm25 - previous.pm25)
+                                                     : (previous.pm25 - _result.pm25);
+    if (change > _config.changeThreshold)
+    {
+      _cycleInterval = _config.minCycleInterval;
+    }
+    else if (_cycleInterval < (_config.maxCycleInterval / 2))
+    {
+      _cycleInterval *= 2;
+    }
+    else
+    {
+      _cycleInterval = _config.maxCycleInterval;
+    }
+  }
+
+  enterState(SamplerState::sampler_idle, now);
+}
+
+// --------------------------------------------------------
+// SDS011Sampler:addDuration
+// --------------------------------------------------------
+void SDS011Sampler::addDuration(uint32_t &seconds, uint16_t &rest, uint32_t duration)
+{
+  duration += rest;
+  seconds += duration / 1000;
+  rest = duration % 1000;
+}
+
+// --------------------------------------------------------
+// SDS011Sampler:stats
+// --------------------------------------------------------
+SDS011SamplerStats SDS011Sampler::stats() const
+{
+  SDS011SamplerStats stats;
+
+  stats.cycles = _cycles;
+  stats.samples = _samples;
+  stats.errors = _errors;
+  stats.workSeconds = _workSeconds;
+  stats.sleepSeconds = _sleepSeconds;
+
+  uint32_t total = _workSeconds + _sleepSeconds;
+  stats.dutyCyclePermille = total ? (uint16_t)(((uint64_t)_workSeconds * 1000) / total) : 0;
+
+  // s * mA * mV = uJ
+  uint64_t microJoules = ((uint64_t)_workSeconds * _config.workCurrent +
+                          (uint64_t)_sleepSeconds * _config.sleepCurrent) *
+                         _config.supplyVoltage;
+  stats.energyJoules = (uint32_t)(microJoules / 1000000);
+  stats.milliJoulesPerSample = _samples ? (uint32_t)(microJoules / 1000 / _samples) : 0;
+
+  return stats;
+}
+
+// --------------------------------------------------------
+// SDS011Sampler:resetStats
+// --------------------------------------------------------
+void SDS011Sampler::resetStats()
+{
+  _cycles = 0;
+  _samples = 0;
+  _errors = 0;
+  _workSeconds = 0;
+  _workRest = 0;
+  _sleepSeconds = 0;
+  _sleepRest = 0;
+}
@@ -0,0 +1,197 @@
+/**
+ * @file SDS011Sampler.h
+ * @brief Energy aware sampling orchestrator for sds011 sensor.
+ *
+ * Non blocking state machine which wakes sensor, waits for warm-up,
+ * discards first readings, collects samples until they are stable and puts
+ * sensor back to sleep. Interval between cycles adapts to rate of PM change.
+ * Call update() from loop(), every call does at most one serial transaction.
+ */
+
+#pragma once
+
+#include "NovaSDS011.h"
+
+#define SDS011_SAMPLER_MAX_SAMPLES 16
+
+enum SamplerState
+{
+	sampler_idle = 0,
+	sampler_warmup = 1,
+	sampler_sampling = 2
+};
+
+struct SDS011SamplerConfig
+{
+	SDS011SamplerConfig();
+
+	/**
+		* Time in ms to run fan and laser before first sample is taken.
+		*/
+	uint32_t warmupTime;
+
+	/**
+		* Time in ms between queries, not less than 3000.
+		*/
+	uint16_t sampleInterval;
+
+	/**
+		* Number of samples thrown away after warm-up.
+		*/
+	uint8_t discardSamples;
+
+	/**
+		* Minimal number of samples in cycle.
+		*/
+	uint8_t minSamples;
+
+	/**
+		* Maximal number of samples in cycle (up to SDS011_SAMPLER_MAX_SAMPLES).
+		*/
+	uint8_t maxSamples;
+
+	/**
+		* Cycle ends early when last minSamples PM2.5 and PM10 samples
+		* differ by no more than stableDelta (tenths of μg/m3).
+		*/
+	uint16_t stableDelta;
+
+	/**
+		* Shortest time in ms between cycle starts, used when PM changes fast.
+		*/
+	uint32_t minCycleInterval;
+
+	/**
+		* Longest time in ms between cycle starts, used when PM is steady.
+		*/
+	uint32_t maxCycleInterval;
+
+	/**
+		* PM2.5 change between cycles (tenths of μg/m3) treated as fast change.
+		*/
+	uint16_t changeThreshold;
+
+	/**
+		* Supply voltage in mV, used for energy estimate.
+		*/
+	uint16_t supplyVoltage;
+
+	/**
+		* Current in mA when fan and laser are running.
+		*/
+	uint16_t workCurrent;
+
+	/**
+		* Current in mA when sensor is sleeping.
+		*/
+	uint16_t sleepCurrent;
+};
+
+struct SDS011SamplerResult
+{
+	bool valid;
+	uint16_t pm25;      // median PM2.5 in tenths of μg/m3
+	uint16_t pm10;      // median PM10 in tenths of μg/m3
+	uint8_t samples;    // number of samples used
+	uint32_t timestamp; // SDS011Clock::millis() when cycle ended
+};
+
+struct SDS011SamplerStats
+{
+	uint32_t cycles;
+	uint32_t samples;
+	uint32_t errors;
+	uint32_t workSeconds;
+	uint32_t sleepSeconds;
+	uint16_t dutyCyclePermille;  // time with fan running in 1/1000
+	uint32_t energyJoules;       // estimated sensor energy
+	uint32_t milliJoulesPerSample;
+};
+
+class SDS011Sampler
+{
+public:
+	/**
+		* Constructor.
+		* @param sensor initialized driver
+		* @param device_id device id (optional)
+		*/
+	SDS011Sampler(NovaSDS011 &sensor, uint16_t device_id = 0xFFFF);
+
+	/**
+		* Set query reporting mode, put sensor to sleep and start first cycle.
+		* @param config sampling configuration
+		* @return true if sensor accepted query reporting mode
+		*/
+	bool begin(const SDS011SamplerConfig &config = SDS011SamplerConfig());
+
+	/**
+		* Advance state machine, call it from loop().
+		* @return true if cycle ended and new result is available
+		*/
+	bool update();
+
+	/**
+		* Get current state.
+		* @return SamplerState
+		*/
+	SamplerState state() const { return _state; }
+
+	/**
+		* Get result of last finished cycle.
+		* @return SDS011SamplerResult
+		*/
+	SDS011SamplerResult result() const { return _result; }
+
+	/**
+		* Get current time in ms between cycle starts.
+		* @return interval
+		*/
+	uint32_t cycleInterval() const { return _cycleInterval; }
+
+	/**
+		* Get duty cycle and energy statistics of finished cycles.
+		* @return SDS011SamplerStats
+		*/
+	SDS011SamplerStats stats() const;
+
+	/**
+		* Clear statistics.
+		*/
+	void resetStats();
+
+private:
+	void enterState(SamplerState state, uint32_t now);
+	void finishCycle(uint32_t now);
+	bool isStable() const;
+	static uint16_t spread(const uint16_t *values, uint8_t count);
+	static uint16_t median(uint16_t *values, uint8_t count);
+	static void addDuration(uint32_t &seconds, uint16_t &rest, uint32_t duration);
+
+	NovaSDS011 &_sensor;
+	uint16_t _deviceId;
+	SDS011SamplerConfig _config;
+
+	SamplerState _state = SamplerState::sampler_idle;
+	uint32_t _stateSince = 0;
+	uint32_t _cycleStart = 0;
+	uint32_t _cycleInterval = 0;
+	uint32_t _lastQuery = 0;
+	bool _firstCycle = true;
+
+	uint16_t _pm25[SDS011_SAMPLER_MAX_SAMPLES];
+	uint16_t _pm10[SDS011_SAMPLER_MAX_SAMPLES];
+	uint8_t _count = 0;
+	uint8_t _discarded = 0;
+	uint8_t _attempts = 0;
+
+	SDS011SamplerResult _result = {false, 0, 0, 0, 0};
+
+	uint32_t _cycles = 0;
+	uint32_t _samples = 0;
+	uint32_t _errors = 0;
+	uint32_t _workSeconds = 0;
+	uint16_t _workRest = 0;
+	uint32_t _sleepSeconds = 0;
+	uint16_t _sleepRest = 0;
+};
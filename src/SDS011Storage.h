@@ -0,0 +1,45 @@
+/**
+ * @file SDS011Storage.h
+ * @brief Page storage interface used by SDS011SampleLog.
+ *
+ * Storage is array of fixed size pages which are always written whole.
+ * Backends: SDS011EepromStorage, SDS011LittleFSStorage and
+ * SDS011FileStorage (Linux, extras/host).
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+class SDS011Storage
+{
+public:
+	virtual ~SDS011Storage() {}
+
+	/**
+		* Get size of one page in bytes.
+		*/
+	virtual uint16_t pageSize() const = 0;
+
+	/**
+		* Get number of pages.
+		*/
+	virtual uint16_t pageCount() const = 0;
+
+	/**
+		* Read whole page.
+		* @param page page number < pageCount()
+		* @param [out] data pageSize() bytes
+		* @return true if operation was sucessful
+		*/
+	virtual bool readPage(uint16_t page, uint8_t *data) = 0;
+
+	/**
+		* Write whole page.
+		* @param page page number < pageCount()
+		* @param data pageSize() bytes
+		* @return true if operation was sucessful
+		*/
+	virtual bool writePage(uint16_t page, const uint8_t *data) = 0;
+};
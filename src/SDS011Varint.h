@@ -0,0 +1,81 @@
+/**
+ * @file SDS011Varint.h
+ * @brief Variable length integer encoding used by compact formats.
+ *
+ * LEB128 style varint, 7 bits per byte, low bits first. Signed values are
+ * zig-zag mapped first so small negative deltas stay small.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct SDS011Varint
+{
+	/**
+		* Write varint to buffer.
+		* @param [out] buffer output buffer
+		* @param size size of buffer
+		* @param pos write position
+		* @param value value to write
+		* @return position after written value, 0 if buffer is too small
+		*/
+	static size_t write(uint8_t *buffer, size_t size, size_t pos, uint32_t value)
+	{
+		do
+		{
+			if (pos >= size)
+			{
+				return 0;
+			}
+			uint8_t byte = value & 0x7F;
+			value >>= 7;
+			buffer[pos++] = value ? (byte | 0x80) : byte;
+		} while (value);
+		return pos;
+	}
+
+	/**
+		* Read varint from buffer.
+		* @param buffer input buffer
+		* @param size number of bytes in buffer
+		* @param pos read position
+		* @param [out] value read value
+		* @return position after read value, 0 if buffer ends or value is invalid
+		*/
+	static size_t read(const uint8_t *buffer, size_t size, size_t pos, uint32_t &value)
+	{
+		value = 0;
+		for (uint8_t shift = 0; shift < 32; shift += 7)
+		{
+			if (pos >= size)
+			{
+				return 0;
+			}
+			uint8_t byte = buffer[pos++];
+			value |= (uint32_t)(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+			{
+				return pos;
+			}
+		}
+		return 0;
+	}
+
+	/**
+		* Map signed value to unsigned: 0, -1, 1, -2, 2 ... -> 0, 1, 2, 3, 4 ...
+		*/
+	static uint32_t zigzag(int32_t value)
+	{
+		return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+	}
+
+	/**
+		* Inverse of zigzag().
+		*/
+	static int32_t unzigzag(uint32_t value)
+	{
+		return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+	}
+};